@@ -0,0 +1,133 @@
+#include "AABB.h"
+
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QVector>
+
+#include <cstdio>
+
+namespace {
+    using namespace Canavar::Engine;
+
+    constexpr int NUMBER_OF_BOXES = 100000;
+    constexpr int NUMBER_OF_ROUNDS = 20;
+
+    float Random(QRandomGenerator& random, float min, float max)
+    {
+        return min + float(random.generateDouble()) * (max - min);
+    }
+
+    QVector3D RandomVector(QRandomGenerator& random, float min, float max)
+    {
+        return QVector3D(Random(random, min, max), Random(random, min, max), Random(random, min, max));
+    }
+
+    // What AABB::Transform replaced: map the eight corners and take their bounds
+    AABB TransformCorners(const AABB& aabb, const QMatrix4x4& transformation)
+    {
+        const QVector3D& min = aabb.GetMin();
+        const QVector3D& max = aabb.GetMax();
+
+        QVector<QVector3D> corners;
+
+        for (int i = 0; i < 8; ++i)
+            corners << transformation.map(QVector3D(i & 1 ? max.x() : min.x(), i & 2 ? max.y() : min.y(), i & 4 ? max.z() : min.z()));
+
+        QVector3D newMin = corners[0];
+        QVector3D newMax = corners[0];
+
+        for (const auto& corner : qAsConst(corners))
+        {
+            newMin = QVector3D(qMin(newMin.x(), corner.x()), qMin(newMin.y(), corner.y()), qMin(newMin.z(), corner.z()));
+            newMax = QVector3D(qMax(newMax.x(), corner.x()), qMax(newMax.y(), corner.y()), qMax(newMax.z(), corner.z()));
+        }
+
+        AABB result;
+        result.SetMin(newMin);
+        result.SetMax(newMax);
+        return result;
+    }
+
+    double Nanoseconds(const QElapsedTimer& timer)
+    {
+        return double(timer.nsecsElapsed()) / (double(NUMBER_OF_BOXES) * NUMBER_OF_ROUNDS);
+    }
+} // namespace
+
+int main()
+{
+    QRandomGenerator random(NUMBER_OF_BOXES);
+
+    QVector<AABB> boxes(NUMBER_OF_BOXES);
+
+    for (auto& box : boxes)
+    {
+        const QVector3D center = RandomVector(random, -100.0f, 100.0f);
+        const QVector3D extent = RandomVector(random, 0.5f, 5.0f);
+        box.SetMin(center - extent);
+        box.SetMax(center + extent);
+    }
+
+    QMatrix4x4 transformation;
+    transformation.translate(RandomVector(random, -1000.0f, 1000.0f));
+    transformation.rotate(Random(random, 0.0f, 360.0f), RandomVector(random, -1.0f, 1.0f).normalized());
+    transformation.scale(RandomVector(random, 0.5f, 2.0f));
+
+    QVector<AABB> corners(NUMBER_OF_BOXES);
+    QVector<AABB> single(NUMBER_OF_BOXES);
+    QVector<AABB> batch(NUMBER_OF_BOXES);
+    QElapsedTimer timer;
+
+    timer.start();
+
+    for (int round = 0; round < NUMBER_OF_ROUNDS; ++round)
+        for (int i = 0; i < NUMBER_OF_BOXES; ++i)
+            corners[i] = TransformCorners(boxes[i], transformation);
+
+    const double cornersTime = Nanoseconds(timer);
+
+    timer.restart();
+
+    for (int round = 0; round < NUMBER_OF_ROUNDS; ++round)
+        for (int i = 0; i < NUMBER_OF_BOXES; ++i)
+            single[i] = boxes[i].Transform(transformation);
+
+    const double singleTime = Nanoseconds(timer);
+
+    timer.restart();
+
+    for (int round = 0; round < NUMBER_OF_ROUNDS; ++round)
+        AABB::Transform(boxes.constData(), batch.data(), NUMBER_OF_BOXES, transformation);
+
+    const double batchTime = Nanoseconds(timer);
+
+    // All three give the tight bounds of the transformed box, up to rounding
+    float maxDifference = 0.0f;
+
+    for (int i = 0; i < NUMBER_OF_BOXES; ++i)
+    {
+        for (const auto& other : { single[i], batch[i] })
+        {
+            const QVector3D min = other.GetMin() - corners[i].GetMin();
+            const QVector3D max = other.GetMax() - corners[i].GetMax();
+
+            for (int axis = 0; axis < 3; ++axis)
+                maxDifference = qMax(maxDifference, qMax(qAbs(min[axis]), qAbs(max[axis])));
+        }
+    }
+
+    // Same condition as in AABB.cpp
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    const char* path = "SSE";
+#else
+    const char* path = "scalar";
+#endif
+
+    std::printf("%d boxes x %d rounds, %s path\n", NUMBER_OF_BOXES, NUMBER_OF_ROUNDS, path);
+    std::printf("8 corners:           %7.2f ns/box\n", cornersTime);
+    std::printf("AABB::Transform:     %7.2f ns/box\n", singleTime);
+    std::printf("AABB::Transform (n): %7.2f ns/box\n", batchTime);
+    std::printf("Largest difference to 8 corners: %g\n", maxDifference);
+
+    return 0;
+}
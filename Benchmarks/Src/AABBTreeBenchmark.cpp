@@ -0,0 +1,264 @@
+#include "DynamicAABBTree.h"
+#include "Frustum.h"
+
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+    using namespace Canavar::Engine;
+
+    constexpr int NUMBER_OF_QUERIES = 100;
+
+    // World units per node along each axis, keeps the density the same for every scene size
+    constexpr float NODE_SPACING = 20.0f;
+
+    float Random(QRandomGenerator& random, float min, float max)
+    {
+        return min + float(random.generateDouble()) * (max - min);
+    }
+
+    QVector3D RandomVector(QRandomGenerator& random, float min, float max)
+    {
+        return QVector3D(Random(random, min, max), Random(random, min, max), Random(random, min, max));
+    }
+
+    AABB MakeAABB(const QVector3D& center, const QVector3D& extent)
+    {
+        AABB aabb;
+        aabb.SetMin(center - extent);
+        aabb.SetMax(center + extent);
+        return aabb;
+    }
+
+    double Milliseconds(const QElapsedTimer& timer)
+    {
+        return timer.nsecsElapsed() / 1e6;
+    }
+
+    // Brute-force counterparts of the tree queries, same tests as in DynamicAABBTree.cpp
+    bool Overlaps(const AABB& a, const AABB& b)
+    {
+        for (int i = 0; i < 3; ++i)
+            if (a.GetMax()[i] < b.GetMin()[i] || b.GetMax()[i] < a.GetMin()[i])
+                return false;
+
+        return true;
+    }
+
+    bool OverlapsSphere(const AABB& aabb, const QVector3D& center, float radius)
+    {
+        float distanceSquared = 0.0f;
+
+        for (int i = 0; i < 3; ++i)
+        {
+            const float d = qMax(aabb.GetMin()[i] - center[i], 0.0f) + qMax(center[i] - aabb.GetMax()[i], 0.0f);
+            distanceSquared += d * d;
+        }
+
+        return distanceSquared <= radius * radius;
+    }
+
+    float IntersectRay(const AABB& aabb, const QVector3D& origin, const QVector3D& direction, float maxDistance)
+    {
+        float tMin = 0.0f;
+        float tMax = maxDistance;
+
+        for (int i = 0; i < 3; ++i)
+        {
+            if (direction[i] == 0.0f)
+            {
+                if (origin[i] < aabb.GetMin()[i] || origin[i] > aabb.GetMax()[i])
+                    return -1.0f;
+
+                continue;
+            }
+
+            const float t1 = (aabb.GetMin()[i] - origin[i]) / direction[i];
+            const float t2 = (aabb.GetMax()[i] - origin[i]) / direction[i];
+
+            tMin = qMax(tMin, qMin(t1, t2));
+            tMax = qMin(tMax, qMax(t1, t2));
+        }
+
+        return tMin <= tMax ? tMin : -1.0f;
+    }
+
+    struct Ray {
+        QVector3D origin;
+        QVector3D direction;
+    };
+
+    // Times NUMBER_OF_QUERIES runs of the tree query and of the linear scan it replaces
+    template<typename TreeQuery, typename LinearQuery>
+    void Compare(const char* name, TreeQuery treeQuery, LinearQuery linearQuery)
+    {
+        QList<Node*> result;
+        qint64 treeHits = 0;
+        QElapsedTimer timer;
+        timer.start();
+
+        for (int i = 0; i < NUMBER_OF_QUERIES; ++i)
+        {
+            result.clear();
+            treeQuery(i, result);
+            treeHits += result.size();
+        }
+
+        const double treeTime = Milliseconds(timer) / NUMBER_OF_QUERIES;
+
+        qint64 linearHits = 0;
+        timer.restart();
+
+        for (int i = 0; i < NUMBER_OF_QUERIES; ++i)
+            linearHits += linearQuery(i);
+
+        const double linearTime = Milliseconds(timer) / NUMBER_OF_QUERIES;
+
+        std::printf("        %-8s | tree %8.4f ms | linear %8.4f ms | hits %lld / %lld\n", //
+                    name,
+                    treeTime,
+                    linearTime,
+                    treeHits / NUMBER_OF_QUERIES,
+                    linearHits / NUMBER_OF_QUERIES);
+    }
+
+    void Run(int numberOfNodes)
+    {
+        QRandomGenerator random(numberOfNodes);
+        const float worldSize = NODE_SPACING * std::cbrt(float(numberOfNodes));
+
+        QVector<AABB> boxes(numberOfNodes);
+
+        for (auto& box : boxes)
+            box = MakeAABB(RandomVector(random, 0.0f, worldSize), RandomVector(random, 0.5f, 5.0f));
+
+        // Cameras inside the scene looking at random points, far plane at half the scene size
+        QVector<Frustum> frustums(NUMBER_OF_QUERIES);
+
+        for (auto& frustum : frustums)
+        {
+            QMatrix4x4 projection;
+            projection.perspective(60.0f, 16.0f / 9.0f, 1.0f, 0.5f * worldSize);
+
+            QMatrix4x4 view;
+            view.lookAt(RandomVector(random, 0.0f, worldSize), RandomVector(random, 0.0f, worldSize), QVector3D(0, 1, 0));
+
+            frustum.Update(projection * view);
+        }
+
+        // Spheres and boxes a tenth of the scene across, rays crossing the whole scene
+        const float queryRadius = 0.1f * worldSize;
+
+        QVector<QVector3D> centers(NUMBER_OF_QUERIES);
+        QVector<AABB> queryBoxes(NUMBER_OF_QUERIES);
+        QVector<Ray> rays(NUMBER_OF_QUERIES);
+
+        for (int i = 0; i < NUMBER_OF_QUERIES; ++i)
+        {
+            centers[i] = RandomVector(random, 0.0f, worldSize);
+            queryBoxes[i] = MakeAABB(RandomVector(random, 0.0f, worldSize), QVector3D(queryRadius, queryRadius, queryRadius));
+            rays[i] = Ray{ RandomVector(random, 0.0f, worldSize), RandomVector(random, -1.0f, 1.0f).normalized() };
+        }
+
+        DynamicAABBTree tree;
+        QVector<int> proxies(numberOfNodes);
+        QElapsedTimer timer;
+
+        timer.start();
+
+        for (int i = 0; i < numberOfNodes; ++i)
+            proxies[i] = tree.CreateProxy(boxes[i], nullptr);
+
+        const double build = Milliseconds(timer);
+
+        // Every node takes a small step, as in a frame where the whole scene moves
+        for (auto& box : boxes)
+        {
+            const QVector3D step = RandomVector(random, -1.0f, 1.0f);
+            box = MakeAABB(box.GetCenter() + step, 0.5f * (box.GetMax() - box.GetMin()));
+        }
+
+        int reinserted = 0;
+        timer.restart();
+
+        for (int i = 0; i < numberOfNodes; ++i)
+            reinserted += tree.MoveProxy(proxies[i], boxes[i]) ? 1 : 0;
+
+        const double move = Milliseconds(timer);
+
+        std::printf("%7d nodes | height %3d | build %9.3f ms | move all %9.3f ms (%d reinserted)\n", //
+                    numberOfNodes,
+                    tree.GetHeight(),
+                    build,
+                    move,
+                    reinserted);
+
+        // The linear frustum scan is the one the tree replaced in RendererManager
+        Compare(
+            "frustum",
+            [&](int i, QList<Node*>& result) { tree.QueryFrustum(frustums[i], result); },
+            [&](int i) {
+                int hits = 0;
+
+                for (const auto& box : qAsConst(boxes))
+                    hits += frustums[i].Intersects(box) ? 1 : 0;
+
+                return hits;
+            });
+
+        Compare(
+            "sphere",
+            [&](int i, QList<Node*>& result) { tree.QuerySphere(centers[i], queryRadius, result); },
+            [&](int i) {
+                int hits = 0;
+
+                for (const auto& box : qAsConst(boxes))
+                    hits += OverlapsSphere(box, centers[i], queryRadius) ? 1 : 0;
+
+                return hits;
+            });
+
+        Compare(
+            "box",
+            [&](int i, QList<Node*>& result) { tree.QueryBox(queryBoxes[i], result); },
+            [&](int i) {
+                int hits = 0;
+
+                for (const auto& box : qAsConst(boxes))
+                    hits += Overlaps(box, queryBoxes[i]) ? 1 : 0;
+
+                return hits;
+            });
+
+        // Sorted by entry distance like the tree query
+        QVector<float> distances;
+
+        Compare(
+            "ray",
+            [&](int i, QList<Node*>& result) { tree.QueryRay(rays[i].origin, rays[i].direction, worldSize, result); },
+            [&](int i) {
+                distances.clear();
+
+                for (const auto& box : qAsConst(boxes))
+                    if (const float t = IntersectRay(box, rays[i].origin, rays[i].direction, worldSize); t >= 0.0f)
+                        distances << t;
+
+                std::sort(distances.begin(), distances.end());
+
+                return int(distances.size());
+            });
+    }
+} // namespace
+
+int main()
+{
+    for (const int numberOfNodes : { 1000, 10000, 100000 })
+        Run(numberOfNodes);
+
+    return 0;
+}
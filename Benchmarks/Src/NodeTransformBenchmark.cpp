@@ -0,0 +1,142 @@
+#include "Node.h"
+
+#include <QElapsedTimer>
+#include <QVector>
+
+#include <cstdio>
+
+namespace {
+    using namespace Canavar::Engine;
+
+    constexpr int NUMBER_OF_QUERIES = 1000000;
+
+    // Nodes are normally created through NodeManager, the benchmark keeps them out of its indices
+    class BenchmarkNode : public Node
+    {
+    public:
+        BenchmarkNode() = default;
+        ~BenchmarkNode() = default;
+    };
+
+    // What Node::WorldTransformation() did before the cache: walk the whole parent chain on every call
+    QQuaternion RecursiveWorldRotation(const Node* node)
+    {
+        if (const Node* parent = node->GetParent())
+            return RecursiveWorldRotation(parent) * node->Rotation();
+        else
+            return node->Rotation();
+    }
+
+    QVector3D RecursiveWorldPosition(const Node* node)
+    {
+        if (const Node* parent = node->GetParent())
+            return RecursiveWorldPosition(parent) + RecursiveWorldRotation(parent) * node->Position();
+        else
+            return node->Position();
+    }
+
+    QMatrix4x4 RecursiveWorldTransformation(const Node* node)
+    {
+        if (const Node* parent = node->GetParent())
+        {
+            QMatrix4x4 tr;
+            tr.rotate(RecursiveWorldRotation(parent));
+            tr.setColumn(3, QVector4D(RecursiveWorldPosition(parent), 1.0f));
+
+            return tr * node->Transformation();
+        }
+        else
+            return node->Transformation();
+    }
+
+    double Nanoseconds(const QElapsedTimer& timer)
+    {
+        return double(timer.nsecsElapsed()) / NUMBER_OF_QUERIES;
+    }
+
+    void Run(int depth)
+    {
+        QVector<BenchmarkNode*> chain;
+
+        for (int i = 0; i < depth; ++i)
+        {
+            auto node = new BenchmarkNode;
+            node->SetPosition(QVector3D(1.0f, 2.0f, 3.0f));
+            node->SetRotation(QQuaternion::fromAxisAndAngle(QVector3D(0, 1, 0), 10.0f));
+
+            if (!chain.isEmpty())
+                chain.last()->AddChild(node);
+
+            chain << node;
+        }
+
+        Node* root = chain.first();
+        Node* leaf = chain.last();
+
+        // Accumulated so that the queries are not optimized away
+        float checksum = 0.0f;
+        QElapsedTimer timer;
+
+        // Nothing moves between the queries
+        timer.start();
+
+        for (int i = 0; i < NUMBER_OF_QUERIES; ++i)
+            checksum += leaf->WorldTransformation()(0, 3);
+
+        const double cachedStatic = Nanoseconds(timer);
+
+        timer.restart();
+
+        for (int i = 0; i < NUMBER_OF_QUERIES; ++i)
+            checksum += RecursiveWorldTransformation(leaf)(0, 3);
+
+        const double recursiveStatic = Nanoseconds(timer);
+
+        // The root moves before every query, the cache is rebuilt along the whole chain each time
+        timer.restart();
+
+        for (int i = 0; i < NUMBER_OF_QUERIES; ++i)
+        {
+            root->SetPosition(QVector3D(float(i & 1), 0.0f, 0.0f));
+            checksum += leaf->WorldTransformation()(0, 3);
+        }
+
+        const double cachedMoving = Nanoseconds(timer);
+
+        timer.restart();
+
+        for (int i = 0; i < NUMBER_OF_QUERIES; ++i)
+        {
+            root->SetPosition(QVector3D(float(i & 1), 0.0f, 0.0f));
+            checksum += RecursiveWorldTransformation(leaf)(0, 3);
+        }
+
+        const double recursiveMoving = Nanoseconds(timer);
+
+        // Both must give the same transformation
+        const QMatrix4x4 difference = leaf->WorldTransformation() - RecursiveWorldTransformation(leaf);
+        float maxDifference = 0.0f;
+
+        for (int i = 0; i < 16; ++i)
+            maxDifference = qMax(maxDifference, qAbs(difference.constData()[i]));
+
+        std::printf("depth %2d | static: cached %7.2f ns, recursive %7.2f ns | moving root: cached %7.2f ns, recursive %7.2f ns | largest difference %g (checksum %g)\n",
+                    depth,
+                    cachedStatic,
+                    recursiveStatic,
+                    cachedMoving,
+                    recursiveMoving,
+                    maxDifference,
+                    checksum);
+
+        qDeleteAll(chain);
+    }
+} // namespace
+
+int main()
+{
+    for (const int depth : { 1, 4, 16 })
+        Run(depth);
+
+    return 0;
+}
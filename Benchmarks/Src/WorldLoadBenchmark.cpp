@@ -0,0 +1,187 @@
+#include "Config.h"
+#include "NodeManager.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QUuid>
+#include <QVector>
+
+#include <cstdio>
+
+namespace {
+    using namespace Canavar::Engine;
+
+    // Parent lookups timed with the linear scan, a full load with it would take minutes at 100k nodes
+    constexpr int NUMBER_OF_SAMPLES = 1000;
+
+    // One node in ROOT_EVERY has no parent, the others hang below a random earlier node
+    constexpr int ROOT_EVERY = 16;
+
+    QJsonObject MakeVector(float x, float y, float z)
+    {
+        QJsonObject object;
+        object.insert("x", x);
+        object.insert("y", y);
+        object.insert("z", z);
+        return object;
+    }
+
+    // Same layout as Node::ToJson writes, dummy nodes only so that no GL context or model is needed
+    QJsonDocument MakeWorld(int numberOfNodes, QRandomGenerator& random, QStringList& uuids, QStringList& parents)
+    {
+        QJsonArray nodes;
+
+        for (int i = 0; i < numberOfNodes; ++i)
+        {
+            const QString uuid = QUuid::createUuid().toString(QUuid::StringFormat::WithoutBraces);
+            const QString parent = i % ROOT_EVERY == 0 ? QString() : uuids[random.bounded(i)];
+
+            QJsonObject rotation = MakeVector(0.0f, 0.0f, 0.0f);
+            rotation.insert("w", 1.0f);
+
+            QJsonObject node;
+            node.insert("type", int(Node::NodeType::DummyNode));
+            node.insert("name", QString("Node %1").arg(i));
+            node.insert("uuid", uuid);
+            node.insert("position", MakeVector(float(random.bounded(1000)), 0.0f, float(random.bounded(1000))));
+            node.insert("rotation", rotation);
+            node.insert("scale", MakeVector(1.0f, 1.0f, 1.0f));
+            node.insert("visible", true);
+            node.insert("selectable", true);
+
+            if (!parent.isEmpty())
+                node.insert("parent", parent);
+
+            nodes << node;
+            uuids << uuid;
+            parents << parent;
+        }
+
+        QJsonObject world;
+        world.insert("nodes", nodes);
+        return QJsonDocument(world);
+    }
+
+    bool Write(const QString& path, const QJsonDocument& document)
+    {
+        QFile file(path);
+
+        if (!file.open(QIODevice::WriteOnly))
+            return false;
+
+        file.write(document.toJson(QJsonDocument::Compact));
+        return true;
+    }
+
+    // What NodeManager::GetNodeByUUID did before the indices
+    Node* FindLinear(const QList<Node*>& nodes, const QString& uuid)
+    {
+        for (const auto& node : nodes)
+            if (node->GetUUID() == uuid)
+                return node;
+
+        return nullptr;
+    }
+
+    double Milliseconds(const QElapsedTimer& timer)
+    {
+        return timer.nsecsElapsed() / 1e6;
+    }
+
+    void Run(int numberOfNodes, const QTemporaryDir& directory)
+    {
+        QRandomGenerator random(numberOfNodes);
+        QStringList uuids;
+        QStringList parents;
+
+        const QString worldPath = directory.filePath(QString("World%1.json").arg(numberOfNodes));
+        const QString configPath = directory.filePath(QString("Config%1.json").arg(numberOfNodes));
+
+        QJsonObject config;
+        config.insert("world_file_path", worldPath);
+
+        if (!Write(worldPath, MakeWorld(numberOfNodes, random, uuids, parents)) || !Write(configPath, QJsonDocument(config)))
+        {
+            std::printf("Could not write the synthetic world to %s\n", qPrintable(directory.path()));
+            return;
+        }
+
+        Config::Instance()->Load(configPath);
+
+        auto nodeManager = NodeManager::Instance();
+
+        // Parsing, creation, registration and parenting, as at startup
+        QElapsedTimer timer;
+        timer.start();
+
+        nodeManager->PostInit();
+
+        const double load = Milliseconds(timer);
+
+        // The parent phase does two UUID lookups per child, time them on a sample with both lookups
+        int numberOfChildren = 0;
+
+        for (const auto& parent : qAsConst(parents))
+            numberOfChildren += parent.isEmpty() ? 0 : 1;
+
+        QVector<int> samples;
+
+        while (samples.size() < NUMBER_OF_SAMPLES)
+            if (const int index = random.bounded(numberOfNodes); !parents[index].isEmpty())
+                samples << index;
+
+        const auto& nodes = nodeManager->GetNodes();
+        int found = 0;
+
+        timer.restart();
+
+        for (const int index : qAsConst(samples))
+            found += FindLinear(nodes, uuids[index]) && FindLinear(nodes, parents[index]) ? 1 : 0;
+
+        const double linearLookups = Milliseconds(timer) / NUMBER_OF_SAMPLES * numberOfChildren;
+
+        timer.restart();
+
+        for (const int index : qAsConst(samples))
+            found += nodeManager->GetNodeByUUID(uuids[index]) && nodeManager->GetNodeByUUID(parents[index]) ? 1 : 0;
+
+        const double indexedLookups = Milliseconds(timer) / NUMBER_OF_SAMPLES * numberOfChildren;
+
+        std::printf("%7d nodes (%d parented) | load %9.2f ms | parent lookups: indexed %9.3f ms, linear %11.2f ms (estimated) | load before indices %11.2f ms (estimated) | found %d / %d\n",
+                    numberOfNodes,
+                    numberOfChildren,
+                    load,
+                    indexedLookups,
+                    linearLookups,
+                    load - indexedLookups + linearLookups,
+                    found,
+                    2 * NUMBER_OF_SAMPLES);
+
+        // Leaves NodeManager empty for the next size, deleteLater never runs without an event loop
+        const QList<Node*> loaded = nodes;
+
+        for (const auto& node : loaded)
+            nodeManager->RemoveNode(node);
+    }
+} // namespace
+
+int main()
+{
+    QTemporaryDir directory;
+
+    if (!directory.isValid())
+    {
+        std::printf("Could not create a temporary directory\n");
+        return 1;
+    }
+
+    for (const int numberOfNodes : { 10000, 100000 })
+        Run(numberOfNodes, directory);
+
+    return 0;
+}
@@ -17,8 +17,16 @@ namespace Canavar {
             QVector3D GetCenter() const { return (mMin + mMax) / 2.0f; }
 
             QMatrix4x4 GetTransformation() const;
+
+            // Transforms the center and the extents (Arvo), transformation must be affine
             AABB Transform(const QMatrix4x4& transformation) const;
 
+            // Same as Transform() for count boxes, output may alias input
+            static void Transform(const AABB* input, AABB* output, int count, const QMatrix4x4& transformation);
+
+            // Grows this box to enclose other
+            void Merge(const AABB& other);
+
             void ToJson(QJsonObject& object);
             void FromJson(const QJsonObject& object);
 
@@ -42,7 +42,14 @@ namespace Canavar {
             MeshVertexRendererShader,
             VertexInfoShader,
             LineStripShader,
-            RaycasterShader
+            RaycasterShader,
+            ModelColoredInstancedShader,
+            ModelTexturedInstancedShader,
+            GPUCullingShader,
+            HiZShader,
+            HiZDebugShader,
+            ImpostorBakeShader,
+            ImpostorShader
         };
 
         enum class RenderMode { //
@@ -54,9 +61,24 @@ namespace Canavar {
 
         Q_DECLARE_FLAGS(RenderModes, RenderMode);
 
+        // What a Mesh keeps in RAM after its buffers are uploaded
+        enum class MeshDataPolicy { //
+            Keep,
+            PositionsOnly,
+            Release
+        };
+
         extern const QVector3D CUBE[36];
         extern const QVector2D QUAD[12];
         extern const QVector3D CUBE_STRIP[17];
+
+        // Pre-resolved uniform name, see ShaderManager::GetUniformHandle
+        struct UniformHandle {
+            int id = -1;
+        };
+
+        // Binding point of the FrameData uniform block declared in Common.glsl
+        constexpr unsigned int FRAME_DATA_BINDING_POINT = 0;
     } // namespace Engine
 } // namespace Canavar
 
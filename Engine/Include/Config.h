@@ -2,6 +2,7 @@
 
 #include "Common.h"
 
+#include <QMap>
 #include <QObject>
 
 namespace Canavar {
@@ -16,10 +17,21 @@ namespace Canavar {
 
             void Load(const QString& configFile);
 
+            MeshDataPolicy GetMeshDataPolicy(const QString& modelName) const;
+
             DEFINE_MEMBER_CONST(QString, ModelsRootFolder);
             DEFINE_MEMBER_CONST(QString, WorldFilePath);
             DEFINE_MEMBER_CONST(QStringList, SupportedModelFormats);
             DEFINE_MEMBER_CONST(bool, NodeSelectionEnabled);
+            DEFINE_MEMBER_CONST(bool, CompactVertexFormat);
+            DEFINE_MEMBER_CONST(QString, ModelCacheFolder);  // Empty disables the cache
+            DEFINE_MEMBER_CONST(bool, LazyModelLoading);     // Models are loaded on first request
+            DEFINE_MEMBER_CONST(int, GPUMemoryBudget);       // In MB, unused models are evicted above it. 0 disables eviction.
+            DEFINE_MEMBER_CONST(bool, GeometryArenaEnabled); // Meshes share large buffers and are drawn with multi-draw indirect
+
+        private:
+            MeshDataPolicy mMeshDataPolicy;
+            QMap<QString, MeshDataPolicy> mMeshDataPolicies; // Per model overrides
         };
     } // namespace Engine
 } // namespace Canavar
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "AABB.h"
+
+#include <QList>
+#include <QVector>
+
+namespace Canavar {
+    namespace Engine {
+        class Frustum;
+        class Node;
+
+        // Incrementally updated bounding volume hierarchy over world-space node bounds.
+        // Leaves keep a fattened AABB so that small movements do not restructure the tree.
+        class DynamicAABBTree
+        {
+        public:
+            DynamicAABBTree();
+
+            int CreateProxy(const AABB& aabb, Node* node);
+            void DestroyProxy(int proxyID);
+
+            // Returns true if the proxy left its fat AABB and had to be reinserted
+            bool MoveProxy(int proxyID, const AABB& aabb);
+
+            Node* GetNode(int proxyID) const;
+            const AABB& GetFatAABB(int proxyID) const;
+
+            void QueryFrustum(const Frustum& frustum, QList<Node*>& result) const;
+            void QuerySphere(const QVector3D& center, float radius, QList<Node*>& result) const;
+            void QueryBox(const AABB& aabb, QList<Node*>& result) const;
+
+            // Hits are sorted by the distance along the ray at which their AABB is entered
+            void QueryRay(const QVector3D& origin, const QVector3D& direction, float maxDistance, QList<Node*>& result) const;
+
+            int GetHeight() const;
+            int GetNumberOfProxies() const;
+
+        private:
+            struct TreeNode {
+                AABB fatAABB;
+                AABB aabb; // Tight bounds, leaves only
+                Node* node;
+                int parent; // Next free node if this one is in the free list
+                int child1;
+                int child2;
+                int height; // 0 for leaves, -1 for free nodes
+
+                bool IsLeaf() const { return child1 == -1; }
+            };
+
+            int AllocateNode();
+            void FreeNode(int index);
+
+            void InsertLeaf(int leaf);
+            void RemoveLeaf(int leaf);
+            int Balance(int index);
+
+            AABB Fatten(const AABB& aabb) const;
+
+        private:
+            QVector<TreeNode> mNodes;
+            int mRoot;
+            int mFreeList;
+            int mNumberOfProxies;
+        };
+    } // namespace Engine
+} // namespace Canavar
@@ -31,12 +31,17 @@ namespace Canavar {
             Particle GenerateParticle();
 
         public:
-            void Render(float ifps);
+            void Update(float ifps);
+            void Render();
 
         private:
             ShaderManager* mShaderManager;
             CameraManager* mCameraManager;
 
+            UniformHandle mMVPUniform;
+            UniformHandle mScaleUniform;
+            UniformHandle mMaxLifeUniform;
+
             QVector<Particle> mParticles;
             int mNumberOfParticles;
 
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "AABB.h"
+
+#include <QMatrix4x4>
+#include <QVector4D>
+
+namespace Canavar {
+    namespace Engine {
+        class Frustum
+        {
+        public:
+            Frustum();
+
+            // Extracts the six clip planes from a view-projection matrix (Gribb-Hartmann)
+            void Update(const QMatrix4x4& viewProjection);
+
+            bool Intersects(const AABB& worldAABB) const;
+            bool Intersects(const AABB& localAABB, const QMatrix4x4& transformation) const;
+
+            enum Plane { Left, Right, Bottom, Top, Near, Far, NumberOfPlanes };
+
+            const QVector4D& GetPlane(Plane plane) const;
+
+        private:
+            QVector4D mPlanes[NumberOfPlanes]; // xyz: normal pointing inside, w: distance
+        };
+    } // namespace Engine
+} // namespace Canavar
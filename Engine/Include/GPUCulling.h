@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Common.h"
+
+#include <QOpenGLExtraFunctions>
+#include <QVector4D>
+#include <QVector>
+
+namespace Canavar {
+    namespace Engine {
+        class Frustum;
+        class OcclusionCulling;
+        class RenderQueue;
+        class ShaderManager;
+
+        // Frustum culls the instances of the indirect commands of a RenderQueue on the GPU. The instances of a command are
+        // candidates[baseInstance, baseInstance + instanceCount), indices into the Instances storage block. Every command
+        // is reduced to its visible candidates, which are compacted into the arena's instance index buffer.
+        class GPUCulling : protected QOpenGLExtraFunctions
+        {
+        public:
+            GPUCulling();
+
+            void Init();
+
+            // The Instances storage block must be bound and the queue prepared, see RenderQueue::Prepare().
+            // Instances hidden behind the pyramid of occlusionCulling are dropped as well if it is given and valid.
+            void Cull(const Frustum& frustum, RenderQueue& queue, GLuint instanceBuffer, int instanceStride, const QVector<GLuint>& candidates, const OcclusionCulling* occlusionCulling = nullptr);
+
+        private:
+            // Layout of CullCommand in GPUCulling.comp (std430)
+            struct CullCommand {
+                QVector4D center;
+                QVector4D extent;
+                GLuint firstInstance; // In candidates and in the instance index buffer
+                GLuint numberOfInstances;
+                GLuint padding[2];
+            };
+
+            // Reads the results back and compares them with Frustum::Intersects, stalls the pipeline.
+            // With occlusion culling the visible instances only have to be a subset of the expected ones.
+            void Validate(const Frustum& frustum, RenderQueue& queue, GLuint instanceBuffer, int instanceStride, const QVector<GLuint>& candidates, bool occlusion);
+
+        private:
+            ShaderManager* mShaderManager;
+
+            QVector<CullCommand> mCullCommands;
+            GLuint mCullCommandBuffer;
+            GLuint mCandidateBuffer;
+
+            UniformHandle mPlaneUniforms[6];
+            UniformHandle mOcclusionCullingUniform;
+            UniformHandle mPyramidUniform;
+            UniformHandle mPyramidViewProjectionUniform;
+
+            DEFINE_MEMBER(bool, ValidationEnabled);
+            DEFINE_MEMBER_CONST(int, NumberOfTestedInstances);
+            DEFINE_MEMBER_CONST(int, NumberOfVisibleInstances); // Only counted if validation is enabled
+            DEFINE_MEMBER_CONST(int, NumberOfMismatches);       // Only counted if validation is enabled
+        };
+    } // namespace Engine
+} // namespace Canavar
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <QHash>
+#include <QJsonObject>
+#include <QMap>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLTexture>
+#include <QString>
+
+namespace Canavar {
+    namespace Engine {
+        // Book keeping of GPU memory. Every buffer, texture and render target allocation
+        // is reported here right after the GL call, and every deletion right before it.
+        class GPUMemoryTracker
+        {
+        private:
+            GPUMemoryTracker();
+
+        public:
+            static GPUMemoryTracker* Instance();
+
+            enum class Resource { //
+                Buffer,
+                Texture,
+                Renderbuffer,
+                Framebuffer
+            };
+
+            enum class Category { //
+                VertexBuffer,
+                IndexBuffer,
+                UniformBuffer,
+                StorageBuffer,
+                Texture,
+                RenderTarget
+            };
+
+            struct Allocation {
+                Category category;
+                QString owner;
+                qint64 bytes;
+            };
+
+            // Allocating the same object again replaces its previous record, e.g. on glBufferData
+            void Allocate(Resource resource, GLuint id, Category category, const QString& owner, qint64 bytes);
+            void Free(Resource resource, GLuint id);
+
+            qint64 GetTotalBytes() const;
+            const QMap<Category, qint64>& GetBytesByCategory() const;
+            const QMap<QString, qint64>& GetBytesByOwner() const;
+            int GetNumberOfAllocations() const;
+
+            QJsonObject ToJson() const;
+            bool Dump(const QString& path) const;
+
+            static QString ToString(Category category);
+            static int GetBytesPerPixel(GLenum internalFormat);
+            static qint64 CalculateTextureSize(QOpenGLTexture* texture);
+            static qint64 CalculateFramebufferSize(QOpenGLFramebufferObject* framebuffer);
+
+        private:
+            static quint64 MakeKey(Resource resource, GLuint id);
+            void Remove(const Allocation& allocation);
+
+        private:
+            QHash<quint64, Allocation> mAllocations;
+            QMap<Category, qint64> mBytesByCategory;
+            QMap<QString, qint64> mBytesByOwner;
+            qint64 mTotalBytes;
+        };
+    } // namespace Engine
+} // namespace Canavar
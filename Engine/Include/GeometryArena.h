@@ -0,0 +1,72 @@
+#pragma once
+
+#include <QMap>
+#include <QOpenGLExtraFunctions>
+#include <QVector>
+
+namespace Canavar {
+    namespace Engine {
+        // Large vertex and index buffers shared by meshes. A page holds meshes of one vertex format
+        // only, so every page can be drawn with one glMultiDrawElementsIndirect per material.
+        class GeometryArena : protected QOpenGLExtraFunctions
+        {
+        private:
+            GeometryArena();
+
+        public:
+            static GeometryArena* Instance();
+
+            struct Allocation {
+                int page = -1;
+                int baseVertex = 0; // In vertices from the start of the page
+                int firstIndex = 0; // In indices from the start of the page
+                int numberOfVertices = 0;
+                int numberOfIndices = 0;
+            };
+
+            // Indices are relative to the first vertex of the mesh, they are stored as 32-bit
+            bool Allocate(bool compact, const void* vertices, int numberOfVertices, const unsigned int* indices, int numberOfIndices, Allocation& allocation);
+            void Free(const Allocation& allocation);
+
+            // The instance index attribute of every page VAO reads [0, count), must be called before drawing count instances.
+            // Without identity the content is left as it is, for GPUCulling which writes every index it draws.
+            void ReserveInstances(int count, bool identity = true);
+
+            // GPUCulling writes compacted instance indices into the buffer, the identity is restored on the next ReserveInstances()
+            GLuint GetInstanceIndexBuffer() const;
+            void InvalidateInstanceIndices();
+
+            int GetNumberOfPages() const;
+            GLuint GetVAO(int page) const;
+            GLuint GetVertexBuffer(int page) const;
+            GLuint GetIndexBuffer(int page) const;
+            bool IsCompact(int page) const;
+
+            // Per-instance attribute, unlike gl_InstanceID it honours the baseInstance of indirect commands
+            static constexpr GLuint INSTANCE_INDEX_LOCATION = 10;
+
+            static constexpr qint64 VERTEX_PAGE_SIZE = 64 * 1024 * 1024; // In bytes
+            static constexpr qint64 INDEX_PAGE_SIZE = 16 * 1024 * 1024;  // In bytes
+
+        private:
+            struct Page {
+                GLuint vao;
+                GLuint vbo;
+                GLuint ebo;
+                bool compact;
+                QMap<qint64, qint64> freeVertices; // Offset -> count, in vertices
+                QMap<qint64, qint64> freeIndices;  // Offset -> count, in indices
+            };
+
+            void Init();
+            int CreatePage(bool compact, qint64 numberOfVertices, qint64 numberOfIndices);
+
+        private:
+            QVector<Page> mPages;
+            GLuint mInstanceIndexBuffer;
+            int mInstanceCapacity;
+            bool mInstanceIndicesDirty;
+            bool mInitialized;
+        };
+    } // namespace Engine
+} // namespace Canavar
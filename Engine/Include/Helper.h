@@ -1,9 +1,11 @@
 #pragma once
 
+#include "MeshOptimizer.h"
 #include "ModelData.h"
 
 #include <PointLight.h>
 #include <QByteArray>
+#include <QImage>
 #include <QQuaternion>
 #include <QRandomGenerator>
 
@@ -19,6 +21,14 @@ namespace Canavar {
             Helper();
 
         public:
+            // Post-processing applied to every imported model, part of the ModelCache key
+            static constexpr unsigned int IMPORTER_FLAGS = //
+                aiProcess_Triangulate |                    //
+                aiProcess_GenSmoothNormals |               //
+                aiProcess_FlipUVs |                        //
+                aiProcess_CalcTangentSpace |               //
+                aiProcess_GenBoundingBoxes;
+
             static QByteArray GetBytes(QString path);
             static float CalculateHorizontalFovForGivenVerticalFov(float verticalFov, float width, float height);
             static float CalculateVerticalFovForGivenHorizontalFov(float horizontalFov, float width, float height);
@@ -34,16 +44,19 @@ namespace Canavar {
             static float GenerateFloat(float bound);
             static float GenerateBetween(float lower, float upper);
             static QVector3D GenerateVec3(float x, float y, float z);
-            static QOpenGLTexture* CreateTexture(const QString& path);
+            static QOpenGLTexture* CreateTexture(const QString& path, const QString& owner);
+            static QOpenGLTexture* CreateTexture(const QImage& image, const QString& owner);
+            static QImage DecodeImage(const QString& path); // Safe to call from any thread
 
             static QVector<PointLight*> GetClosePointLights(const QList<PointLight*>& nodes, const QVector3D& position, int maxCount);
             static QJsonDocument LoadJson(const QString& path);
             static bool WriteTextToFile(const QString& path, const QByteArray& content);
             static bool WriteDataToFile(const QString& path, const QByteArray& content);
             static QByteArray ReadDataFromFile(const QString& path);
+            static qint64 GetResidentSetSize(); // Of this process in bytes, 0 if it is not available
 
         private:
-            static Mesh* ProcessMesh(aiMesh* aiMesh);
+            static Mesh* ProcessMesh(aiMesh* aiMesh, MeshOptimizer::Statistics& statistics);
             static ModelDataNode* ProcessNode(ModelData* data, aiNode* aiParentNode);
             static Material* ProcessMaterial(aiMaterial* aiMaterial, const QString& directory);
             static bool ProcessTexture(Material* material, aiMaterial* aiMaterial, aiTextureType aiType, Material::TextureType type, const QString& directory);
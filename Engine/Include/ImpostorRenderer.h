@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Common.h"
+
+#include <QHash>
+#include <QOpenGLExtraFunctions>
+#include <QVector3D>
+#include <QVector4D>
+#include <QVector>
+
+namespace Canavar {
+    namespace Engine {
+        class Model;
+        class ModelData;
+        class ShaderManager;
+
+        // Octahedral impostors of far-away models. Every ModelData gets an atlas of views baked from directions spread
+        // over the sphere, a model added here is drawn as a quad showing the view nearest to the camera. The atlas shows
+        // the data at rest, mesh overrides and non-uniform scale of the models are not reflected.
+        class ImpostorRenderer : protected QOpenGLExtraFunctions
+        {
+        public:
+            ImpostorRenderer();
+            ~ImpostorRenderer();
+
+            void Init();
+
+            // Clears the impostors of the previous frame
+            void Clear();
+
+            // False if the data of model has no atlas yet, it is baked in one of the next frames then
+            bool Add(Model* model);
+
+            // Bakes at most one of the requested atlases. framebuffer and the viewport are restored afterwards.
+            void Bake(GLuint framebuffer, int width, int height);
+
+            // One instanced draw per atlas, quadVAO is the screen quad of RendererManager
+            void Render(GLuint quadVAO);
+
+            // Frees the atlas of data, it is baked again if the data is drawn as an impostor later
+            void Release(ModelData* data);
+
+            int GetNumberOfImpostors() const;
+            int GetNumberOfAtlases() const;
+
+        private:
+            struct Atlas {
+                GLuint albedo = 0;
+                GLuint normalDepth = 0;
+                QVector3D center; // Bounding sphere in model space
+                float radius = 0.0f;
+                qint64 size = 0; // Of both textures, in bytes
+            };
+
+            // Layout of Impostor in Impostor.vert (std430)
+            struct ImpostorData {
+                float rotation[16];
+                QVector4D sphere;
+                QVector4D color;
+                QVector4D overlayColor;
+                float overlayColorFactor;
+                float ambient;
+                float diffuse;
+                float specular;
+                float shininess;
+                float padding[3];
+            };
+
+            GLuint CreateAtlasTexture(const QString& owner);
+            void DeleteAtlas(const Atlas& atlas);
+
+        private:
+            ShaderManager* mShaderManager;
+
+            QHash<ModelData*, Atlas> mAtlases; // Without textures if the data has nothing to show
+            QVector<ModelData*> mBakeQueue;
+
+            QHash<ModelData*, QVector<ImpostorData>> mImpostors;
+            QVector<ImpostorData> mInstanceData;
+            GLuint mInstanceBuffer;
+            int mNumberOfImpostors;
+
+            GLuint mFramebuffer;
+            GLuint mDepthRenderbuffer;
+
+            UniformHandle mMVPUniform;
+            UniformHandle mNUniform;
+            UniformHandle mUseTextureAmbientUniform;
+            UniformHandle mTextureAmbientUniform;
+            UniformHandle mTintUniform;
+            UniformHandle mInstanceOffsetUniform;
+            UniformHandle mGridSizeUniform;
+            UniformHandle mTextureAlbedoUniform;
+            UniformHandle mTextureNormalDepthUniform;
+        };
+    } // namespace Engine
+} // namespace Canavar
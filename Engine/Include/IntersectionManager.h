@@ -31,6 +31,7 @@ namespace Canavar {
         private:
             NodeManager* mNodeManager;
             ShaderManager* mShaderManager;
+            UniformHandle mVPUniform;
 
             QOpenGLFramebufferObjectFormat mFBOFormat;
             QOpenGLFramebufferObject* mFBO;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QImage>
 #include <QMap>
 #include <QObject>
 #include <QOpenGLTexture>
@@ -20,12 +21,33 @@ namespace Canavar {
                 Normal
             };
 
-            void Insert(TextureType type, QOpenGLTexture* texture);
+            void Insert(TextureType type, QOpenGLTexture* texture, const QString& path = QString());
+
+            // Decoded images are kept until CreateTextures() is called on the thread owning the context
+            void InsertImage(TextureType type, const QImage& image, const QString& path);
+            void CreateTextures(const QString& owner);
+
+            // Textures can be destroyed and decoded again from their paths later
+            void DestroyTextures();
+            void DecodeImages();
+
+            // Moves the decoded images of source, a new import of the same material
+            void TakeImages(Material* source);
+
+            qint64 GetGPUMemorySize() const;
+
             QOpenGLTexture* Get(TextureType type);
+            QString GetPath(TextureType type) const;
             int GetNumberOfTextures();
 
+            // Unique for the lifetime of the process, unlike the address of the material
+            quint32 GetID() const;
+
         private:
+            const quint32 mID;
             QMap<TextureType, QOpenGLTexture*> mTextures;
+            QMap<TextureType, QString> mPaths; // Image files the textures are created from
+            QMap<TextureType, QImage> mImages;
         };
     } // namespace Engine
 } // namespace Canavar
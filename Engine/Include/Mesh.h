@@ -2,8 +2,10 @@
 
 #include "AABB.h"
 #include "Common.h"
+#include "GeometryArena.h"
 #include "Material.h"
 
+#include <QFloat16>
 #include <QObject>
 #include <QOpenGLExtraFunctions>
 #include <QOpenGLVertexArrayObject>
@@ -28,8 +30,23 @@ namespace Canavar {
                 QVector2D texture;
                 QVector3D tangent;
                 QVector3D bitangent;
-                int boneIDs[4];
-                float weights[4];
+                int boneIDs[4] = { 0, 0, 0, 0 };
+                float weights[4] = { 0, 0, 0, 0 };
+            };
+
+            // GPU layout used when CompactVertices is set, 28 bytes instead of 88
+            struct CompactVertex {
+                QVector3D position;
+                qint16 normal[2];  // Octahedral, snorm
+                qint16 tangent[4]; // Octahedral in xy, handedness in z, snorm
+                qfloat16 texture[2];
+            };
+
+            // Coarser level of the index buffer, see MeshOptimizer::GenerateLods
+            struct Lod {
+                quint32 firstIndex;      // Into the LOD indices
+                quint32 numberOfIndices; //
+                float error;             // Geometric deviation from the full detail mesh, in mesh space
             };
 
             Mesh();
@@ -37,27 +54,93 @@ namespace Canavar {
 
             void AddVertex(const Vertex& vertex);
             void AddIndex(unsigned int index);
+            void SetVertices(const Vertex* vertices, int count);
+            void SetIndices(const unsigned int* indices, int count);
+            // Levels 1, 2, ... referencing the vertices of this mesh, must be set before Create()
+            void SetLods(const QVector<unsigned int>& lodIndices, const QVector<Lod>& lods);
             void SetMaterial(Material* material);
-            void Create();
-            void Render(RenderModes modes, Model* model);
+            void SetName(const QString& name);
+            void Create(const QString& owner);
+            // nodeTransformation is the baked node transformation, see ModelData::DrawEntry
+            void Render(RenderModes modes, Model* model, const QMatrix4x4& nodeTransformation);
+
+            // Transformation and Model struct uniforms, one of the Model* shaders must be bound
+            void SetModelUniforms(Model* model, const QMatrix4x4& nodeTransformation);
+            void SetVertexFormatUniforms();
 
-            Vertex GetVertex(int index) const;
+            // Only the position is valid if the CPU data is released with MeshDataPolicy::PositionsOnly
+            Vertex GetVertex(int index);
             int GetNumberOfVertices();
+            const QVector<Vertex>& GetVertices();
+            const QVector<unsigned int>& GetIndices();
+            int GetNumberOfIndices() const;
+            GLenum GetIndexType() const;
+            // Byte offset of the first index, to be passed to glDrawElements*
+            const void* GetIndexOffset() const;
+
+            // Level 0 is the full detail mesh, lod is clamped to the available levels
+            int GetNumberOfLods() const;
+            int GetNumberOfIndices(int lod) const;
+            const void* GetIndexOffset(int lod) const;
+            int GetFirstIndex(int lod) const; // In indices, relative to the first index of level 0
+            float GetLodError(int lod) const;
+            const QVector<unsigned int>& GetLodIndices();
+            const QVector<Lod>& GetLods() const;
 
+            // Set if the mesh is suballocated in GeometryArena, see Config::GeometryArenaEnabled
+            bool IsInArena() const;
+            const GeometryArena::Allocation& GetArenaAllocation() const;
+
+            // Attribute layout shared by the mesh VAOs and the arena page VAOs, offset is in bytes
+            static void SetVertexAttributes(QOpenGLExtraFunctions* functions, bool compact, qintptr offset);
+
+            // Releases the buffers and VAOs, Create() can be called again afterwards
+            void Destroy();
+            bool IsCreated() const;
+            qint64 GetGPUMemorySize() const;
+
+            // Frees the CPU copies after Create(), they are read back from the buffers when needed again.
+            // Destroy() does not read them back, evicted meshes take them from a new import instead.
+            void ReleaseCPUData(MeshDataPolicy policy);
+            void RestoreCPUData();
+            void TakeCPUData(Mesh* source);
+            bool HasCPUData() const;
+            qint64 GetCPUMemorySize() const;
+
+            Material* GetMaterial() const;
+            QOpenGLVertexArrayObject* GetVAO() const;
             QOpenGLVertexArrayObject* GetVerticesVAO() const;
 
+        private:
+            void SetTextureUniforms();
+            QVector<Vertex> ReadVertices(int first, int count);
+            QVector<unsigned int> ReadIndices(int first, int count);
+
         private:
             QOpenGLVertexArrayObject* mVAO;
             unsigned int mEBO;
             unsigned int mVBO;
+            GeometryArena::Allocation mArenaAllocation;
+            qintptr mVertexOffset; // In bytes, non-zero in the arena
+            qintptr mIndexOffset;  // In bytes, non-zero in the arena
 
             QVector<Vertex> mVertices;
             QVector<unsigned int> mIndices;
+            QVector<unsigned int> mLodIndices; // Follow mIndices in the index buffer
+            QVector<Lod> mLods;
+            QVector<QVector3D> mPositions; // Kept for MeshDataPolicy::PositionsOnly
+            int mNumberOfVertices;
+            int mNumberOfIndices;
+            int mNumberOfLodIndices;
+            MeshDataPolicy mDataPolicy;
+            GLenum mIndexType;
             Material* mMaterial;
 
             DEFINE_MEMBER(AABB, AABB);
-            DEFINE_MEMBER(QString, Name);
+            DEFINE_MEMBER_CONST(QString, Name);
+            DEFINE_MEMBER_CONST(int, NameID); // Interned Name, see NameRegistry
             DEFINE_MEMBER(unsigned int, ID);
+            DEFINE_MEMBER(bool, CompactVertices); // Must be set before Create()
 
             // For rendering
             ShaderManager* mShaderManager;
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <QVector>
+
+namespace Canavar {
+    namespace Engine {
+        class MeshOptimizer
+        {
+        private:
+            MeshOptimizer();
+
+        public:
+            struct Statistics {
+                int numberOfVerticesBefore = 0;
+                int numberOfVerticesAfter = 0;
+                float acmrBefore = 0.0f;
+                float acmrAfter = 0.0f;
+                qint64 bytesBefore = 0;
+                qint64 bytesAfter = 0;
+
+                Statistics& operator+=(const Statistics& other);
+            };
+
+            // Runs all passes below in order. Indices must form a triangle list.
+            // vertexSize is the size of one vertex on the GPU, used for the byte statistics only.
+            static Statistics Optimize(QVector<Mesh::Vertex>& vertices, QVector<unsigned int>& indices, int vertexSize);
+
+            // Merges bitwise identical vertices
+            static void Weld(QVector<Mesh::Vertex>& vertices, QVector<unsigned int>& indices);
+
+            // Reorders triangles for post-transform vertex cache locality (Forsyth)
+            static void OptimizeVertexCache(QVector<unsigned int>& indices, int numberOfVertices);
+
+            // Reorders clusters of the cache optimized triangles so that outer facing ones come first
+            static void OptimizeOverdraw(const QVector<Mesh::Vertex>& vertices, QVector<unsigned int>& indices);
+
+            // Reorders vertices by first use in the index buffer, unused vertices are dropped
+            static void OptimizeVertexFetch(QVector<Mesh::Vertex>& vertices, QVector<unsigned int>& indices);
+
+            // Edge-collapse simplification with quadric error metrics into up to three coarser levels, halving
+            // the triangles each time. The levels index the same vertices, lodIndices holds them back to back.
+            // Open borders slide along themselves, attribute seams and non-manifold edges are kept in place.
+            static void GenerateLods(const QVector<Mesh::Vertex>& vertices, const QVector<unsigned int>& indices, QVector<unsigned int>& lodIndices, QVector<Mesh::Lod>& lods);
+
+            // Average cache miss ratio: transformed vertices per triangle for a FIFO cache
+            static float CalculateACMR(const QVector<unsigned int>& indices, int numberOfVertices, int cacheSize = 16);
+
+            static qint64 CalculateSize(int numberOfVertices, int vertexSize, int numberOfIndices, int indexSize);
+        };
+    } // namespace Engine
+} // namespace Canavar
@@ -2,40 +2,78 @@
 
 #include "Node.h"
 
+#include <QHash>
+
 namespace Canavar {
     namespace Engine {
         class ModelData;
+        class Mesh;
 
         class Model : public Node
         {
         protected:
             friend class NodeManager;
             Model(const QString& modelName);
+            virtual ~Model();
 
             virtual void ToJson(QJsonObject& object) override;
             virtual void FromJson(const QJsonObject& object) override;
 
         public:
-            QMatrix4x4 GetMeshTransformation(const QString& meshName);
+            struct MeshOverride {
+                QMatrix4x4 transformation;
+                QVector4D overlayColor = QVector4D(0, 0, 0, 0);
+                float overlayColorFactor = 0.0f;
+            };
+
+            // Indexed by Mesh::GetID(), for the render loops. Defaults until the data is loaded.
+            const MeshOverride& GetMeshOverride(unsigned int meshID) const;
+
+            // By interned mesh name, see NameRegistry. Values set before the data is loaded are kept.
+            QMatrix4x4 GetMeshTransformation(int nameID) const;
+            void SetMeshTransformation(int nameID, const QMatrix4x4& transformation);
+
+            QVector4D GetMeshOverlayColor(int nameID) const;
+            void SetMeshOverlayColor(int nameID, const QVector4D& color);
+
+            float GetMeshOverlayColorFactor(int nameID) const;
+            void SetMeshOverlayColorFactor(int nameID, float factor);
+
+            // Wrappers interning meshName
+            QMatrix4x4 GetMeshTransformation(const QString& meshName) const;
             void SetMeshTransformation(const QString& meshName, const QMatrix4x4& transformation);
 
-            QVector4D GetMeshOverlayColor(const QString& meshName);
+            QVector4D GetMeshOverlayColor(const QString& meshName) const;
             void SetMeshOverlayColor(const QString& meshName, const QVector4D& color);
 
-            float GetMeshOverlayColorFactor(const QString& meshName);
+            float GetMeshOverlayColorFactor(const QString& meshName) const;
             void SetMeshOverlayColorFactor(const QString& meshName, float factor);
 
+            // Model, node and mesh transformations combined
+            QMatrix4x4 GetMeshWorldTransformation(Mesh* mesh);
+
             const QString& GetModelName() const { return mModelName; }
+            ModelData* GetData() const { return mData; }
 
             void Render(RenderMode renderMode);
 
         private:
+            // Recomputes the bounds of every draw list entry
             void UpdateAABB();
 
+            // Recomputes only the entries drawing meshID and merges the cached bounds
+            void UpdateMeshBounds(int meshID);
+            void MergeMeshBounds();
+            void OnModelDataLoaded(ModelData* data);
+
+            const MeshOverride* FindMeshOverride(int nameID) const;
+            MeshOverride& GetMeshOverride_Ref(int nameID);
+            void ResolvePendingMeshOverrides();
+
         protected:
-            QMap<QString, QMatrix4x4> mMeshTransformations;
-            QMap<QString, QVector4D> mMeshOverlayColors;
-            QMap<QString, float> mMeshOverlayColorFactors;
+            QVector<MeshOverride> mMeshOverrides;           // By mesh ID, sized when the data is loaded
+            QHash<int, MeshOverride> mPendingMeshOverrides; // By name ID, waiting for the data
+            QVector<AABB> mMeshBounds;                      // Model space bounds, by draw list entry
             QString mModelName;
             ModelData* mData;
 
@@ -46,6 +84,8 @@ namespace Canavar {
             DEFINE_MEMBER(float, Diffuse);
             DEFINE_MEMBER(float, Specular);
             DEFINE_MEMBER(float, Shininess);
+            DEFINE_MEMBER(float, LodBias); // Positive values switch to coarser levels earlier, see RendererManager::SelectLod
+            DEFINE_MEMBER(int, Lod);       // Selected every frame by RendererManager, 0 is full detail
         };
     } // namespace Engine
 } // namespace Canavar
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "ModelData.h"
+
+#include <QByteArray>
+#include <QString>
+
+namespace Canavar {
+    namespace Engine {
+        // Binary cache of imported and optimized models.
+        // A cache file is valid only for the same source file contents, importer flags, vertex format and VERSION.
+        class ModelCache
+        {
+        private:
+            ModelCache();
+
+        public:
+            // Returns nullptr on a cache miss
+            static ModelData* Load(const QString& name, const QString& sourcePath);
+            static bool Save(ModelData* data, const QString& sourcePath);
+
+            static QString GetCachePath(const QString& name, const QString& sourcePath);
+
+        private:
+            static QByteArray CalculateSourceHash(const QString& sourcePath);
+
+            // Bump whenever the file layout or the processing in Helper::LoadModel changes
+            static constexpr quint32 VERSION = 3;
+        };
+    } // namespace Engine
+} // namespace Canavar
@@ -3,7 +3,9 @@
 #include "Mesh.h"
 #include "ModelDataNode.h"
 
+#include <QHash>
 #include <QObject>
+#include <QThread>
 
 namespace Canavar {
     namespace Engine {
@@ -11,6 +13,13 @@ namespace Canavar {
         {
             Q_OBJECT
         public:
+            // One entry for every mesh referenced by a node of the tree
+            struct DrawEntry {
+                int meshIndex;
+                Mesh* mesh;
+                QMatrix4x4 transformation; // Node to model space, parent transformations are baked in
+            };
+
             ModelData(const QString& name);
             ~ModelData();
 
@@ -21,18 +30,64 @@ namespace Canavar {
             Material* GetMaterial(int index);
             Mesh* GetMeshByID(unsigned int id);
 
+            // Mesh::GetID() of the mesh whose interned name is nameID, -1 if there is none
+            int GetMeshID(int nameID) const;
+
             const QString& GetName() const;
             const QVector<Mesh*>& GetMeshes() const;
+            const QVector<Material*>& GetMaterials() const;
+            ModelDataNode* GetRootNode() const;
+
+            // Flattens the node tree, must be called once the root node and the meshes are set
+            void BuildDrawList();
+            const QVector<DrawEntry>& GetDrawList() const;
+
+            // Levels of the meshes, see Mesh::GetNumberOfLods(). Built with the draw list.
+            int GetNumberOfLods() const;
+            // Largest error of the meshes drawn at lod, in model space
+            float GetLodError(int lod) const;
+
+            // Of the first entry drawing mesh, identity if there is none
+            QMatrix4x4 GetNodeTransformation(Mesh* mesh) const;
 
             void Render(RenderModes modes, Model* model);
 
+            // Moves this, the meshes, the materials and the nodes to thread.
+            // Must be called from the thread they live in.
+            void MoveToThread(QThread* thread);
+
+            // Buffers and textures, the CPU side data is kept when they are destroyed
+            void CreateGPUResources();
+            void DestroyGPUResources();
+            bool IsResident() const;
+            qint64 GetGPUMemorySize() const;
+
+            // Every mesh is drawn from GeometryArena
+            bool IsInArena() const;
+
+            // Must be called after CreateGPUResources(), see Mesh::ReleaseCPUData
+            void ReleaseCPUData(MeshDataPolicy policy);
+            bool HasCPUData() const;
+            qint64 GetCPUMemorySize() const;
+
+            // Number of live Models using this data
+            void AddReference();
+            void RemoveReference();
+            int GetReferenceCount() const;
+
         private:
             QString mName;
             QVector<Mesh*> mMeshes;
             QVector<Material*> mMaterials;
+            QHash<int, int> mMeshIDs; // Name ID -> Mesh ID
             ModelDataNode* mRootNode;
+            QVector<DrawEntry> mDrawList;
+            QVector<float> mLodErrors; // By level, level 0 is always there
+            int mReferenceCount;
+            bool mResident;
 
             DEFINE_MEMBER(AABB, AABB);
+            DEFINE_MEMBER(qint64, LastRenderedFrame);
         };
     } // namespace Engine
 } // namespace Canavar
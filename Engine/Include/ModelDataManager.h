@@ -3,29 +3,105 @@
 #include "Manager.h"
 #include "ModelData.h"
 
+#include <QFuture>
 #include <QMap>
+#include <QMutex>
+#include <QQueue>
+#include <QSet>
+#include <QWaitCondition>
 
 namespace Canavar {
     namespace Engine {
         class ModelDataManager : public Manager
         {
+            Q_OBJECT
         private:
             ModelDataManager();
 
         public:
+            ~ModelDataManager();
+
             static ModelDataManager* Instance();
 
-            bool Init();
+            bool Init() override;
+            void Update(float ifps) override;
 
+            // Returns nullptr until the model is loaded. In lazy mode the first call starts loading it.
             ModelData* GetModelData(const QString& modelName);
+
+            // Starts loading in the background, ModelDataLoaded is emitted when the model is ready
+            void RequestModelData(const QString& modelName);
+
+            // Every model found under the models root folder, loaded or not
             const QStringList& GetModelNames() const;
 
+            // Marks data as used in this frame for the eviction order
+            void MarkRendered(ModelData* data);
+
+            // Vertices and indices kept in RAM by every loaded model
+            qint64 GetCPUMeshMemory() const;
+
+            // GPU memory built from resident data elsewhere, e.g. impostor atlases. It must be
+            // given back (negative bytes) when it is freed on ModelDataEvicted at the latest.
+            void AddResidentGPUMemory(qint64 bytes);
+
+        signals:
+            void ModelDataLoaded(Canavar::Engine::ModelData* data);
+
+            // Emitted after the buffers and textures of data are destroyed
+            void ModelDataEvicted(Canavar::Engine::ModelData* data);
+
         private:
-            void LoadModels(const QString& path, const QStringList& formats);
+            struct ImportResult {
+                QString name;
+                QString path;
+                ModelData* data;
+                bool fromCache;
+                bool reload; // Data was evicted, only the images were decoded again
+            };
+
+            void ScanModels(const QString& path, const QStringList& formats);
+            void LoadModels();
+
+            // Runs on a worker thread, everything but the GL objects
+            ImportResult Import(const QString& name, const QString& path);
+
+            // Runs on a worker thread, gives evicted data back what Upload() needs. False if the model could not be imported again.
+            bool Reload(ModelData* data, const QString& name, const QString& path);
+
+            // Runs on the context thread
+            void ProcessUploadQueue(bool wait);
+            void Upload(const ImportResult& result);
+            void EvictUnusedModels();
 
         private:
             QMap<QString, ModelData*> mModelsData;
+            QMap<QString, QString> mModelPaths;
             QStringList mModelNames;
+            QSet<QString> mRequestedModels;
+            bool mLazyModelLoading;
+            int mNumberOfPendingModels;
+            int mNumberOfCacheHits;
+            int mNumberOfCacheMisses;
+            qint64 mFrameIndex;
+
+            // Imports that may still be running, pruned as new ones are started
+            QList<QFuture<void>> mImportTasks;
+
+            // Imported models waiting for their buffers and textures
+            QQueue<ImportResult> mUploadQueue;
+            QMutex mUploadMutex;
+            QWaitCondition mUploadCondition;
+
+            // Residency
+            DEFINE_MEMBER_CONST(qint64, GPUMemoryBudget); // In bytes
+            DEFINE_MEMBER_CONST(qint64, ResidentGPUMemory);
+            DEFINE_MEMBER_CONST(int, NumberOfResidentModels);
+            DEFINE_MEMBER_CONST(int, NumberOfEvictions);
+            DEFINE_MEMBER_CONST(int, NumberOfReloads);
+
+            // CPU copies of the meshes freed after upload
+            DEFINE_MEMBER_CONST(qint64, ReleasedCPUMemory); // In bytes
         };
     } // namespace Engine
-} // namespace Canavar
\ No newline at end of file
+} // namespace Canavar
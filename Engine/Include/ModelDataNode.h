@@ -14,8 +14,7 @@ namespace Canavar {
             ModelDataNode(ModelData* data);
 
             void AddMeshIndex(int index);
-
-            void Render(RenderModes modes, Model* model);
+            const QVector<int>& GetMeshIndices() const;
 
         private:
             ModelData* mModelData;
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+
+namespace Canavar {
+    namespace Engine {
+        // Interns names into stable integer IDs so that hot paths compare and index by int.
+        // IDs are never reused. Safe to call from any thread.
+        class NameRegistry
+        {
+        private:
+            NameRegistry();
+
+        public:
+            static NameRegistry* Instance();
+
+            static constexpr int INVALID_ID = -1;
+
+            // Returns the ID of name, registering it on first use
+            int Intern(const QString& name);
+
+            // Returns INVALID_ID if name has never been interned
+            int Find(const QString& name) const;
+
+            QString GetName(int id) const;
+
+        private:
+            mutable QReadWriteLock mLock;
+            QHash<QString, int> mIDs;
+            QVector<QString> mNames;
+        };
+    } // namespace Engine
+} // namespace Canavar
@@ -40,19 +40,19 @@ namespace Canavar {
                 PersecutorCamera
             };
 
-            const QMatrix4x4 WorldTransformation() const;
+            const QMatrix4x4& WorldTransformation() const;
             void SetWorldTransformation(const QMatrix4x4& newTransformation);
 
             const QMatrix4x4& Transformation() const;
             void SetTransformation(const QMatrix4x4& newTransformation);
 
-            QQuaternion WorldRotation() const;
+            const QQuaternion& WorldRotation() const;
             void SetWorldRotation(const QQuaternion& newWorldRotation);
 
             const QQuaternion& Rotation() const;
             void SetRotation(const QQuaternion& newRotation);
 
-            QVector3D WorldPosition() const;
+            const QVector3D& WorldPosition() const;
             void SetWorldPosition(const QVector3D& newWorldPosition);
 
             const QVector3D& Position() const;
@@ -74,9 +74,23 @@ namespace Canavar {
 
             const QList<Node*>& GetChildren() const;
 
+            const QString& GetName() const;
+            void SetName(const QString& newName);
+
+        signals:
+            void NameChanged(const QString& oldName);
+
         private:
             virtual void UpdateTransformation();
 
+            // Marks this node and its whole subtree so that world transforms are rebuilt on next query
+            void MarkWorldTransformationDirty();
+            void UpdateWorldTransformation() const;
+
+        protected:
+            // Call after changing mAABB so that NodeManager's spatial index picks it up
+            void MarkBoundsDirty();
+
         protected:
             QMatrix4x4 mTransformation;
             QQuaternion mRotation;
@@ -86,8 +100,15 @@ namespace Canavar {
             Node* mParent;
             QList<Node*> mChildren;
 
+            // World transform cache
+            mutable QMatrix4x4 mWorldTransformation;
+            mutable QQuaternion mWorldRotation;
+            mutable QVector3D mWorldPosition;
+            mutable bool mWorldTransformationDirty;
+
+            QString mName;
+
             DEFINE_MEMBER(bool, Visible);
-            DEFINE_MEMBER(QString, Name);
             DEFINE_MEMBER(AABB, AABB);
             DEFINE_MEMBER(bool, Selectable);
 
@@ -96,6 +117,12 @@ namespace Canavar {
             DEFINE_MEMBER_CONST(NodeType, Type);
 
             DEFINE_MEMBER(bool, ExcludeFromExport);
+
+        private:
+            int mRegistryIndex; // Position in NodeManager's node list
+            int mBucketIndex;   // Position in NodeManager's per-type list
+            int mProxyID;       // Leaf in NodeManager's AABB tree, -1 if not indexed
+            int mBoundsDirtyIndex; // Position in NodeManager's dirty bounds list, -1 if the bounds are up to date
         };
     } // namespace Engine
 } // namespace Canavar
@@ -1,15 +1,26 @@
 #pragma once
 
+#include "DynamicAABBTree.h"
 #include "Manager.h"
 #include "Node.h"
 
+#include <QHash>
+#include <QMultiHash>
 #include <QObject>
+#include <QSet>
+
+#include <limits>
 
 namespace Canavar {
     namespace Engine {
+        class Camera;
         class CameraManager;
+        class FirecrackerEffect;
+        class Frustum;
+        class Light;
         class LightManager;
         class ModelDataManager;
+        class NozzleEffect;
 
         class NodeManager : public Manager
         {
@@ -22,6 +33,7 @@ namespace Canavar {
 
             bool Init() override;
             void PostInit() override;
+            void Update(float ifps) override;
 
             Node* CreateNode(Node::NodeType type, const QString& name = QString());
             Model* CreateModel(const QString& modelName, const QString& name = QString());
@@ -35,18 +47,63 @@ namespace Canavar {
 
             const QList<Node*>& GetNodes() const;
 
+            // Per-type views of GetNodes(), no RTTI needed to iterate them
+            const QList<Model*>& GetModels() const;
+            const QList<NozzleEffect*>& GetNozzleEffects() const;
+            const QList<FirecrackerEffect*>& GetFirecrackerEffects() const;
+            const QList<Light*>& GetLights() const;
+            const QList<Camera*>& GetCameras() const;
+
+            // Spatial queries over world-space node bounds. Sun, Sky, Haze and Terrain are not indexed.
+            QList<Node*> QueryFrustum(const Frustum& frustum);
+            QList<Node*> QuerySphere(const QVector3D& center, float radius);
+            QList<Node*> QueryBox(const AABB& aabb);
+            QList<Node*> QueryRay(const QVector3D& origin, const QVector3D& direction, float maxDistance = std::numeric_limits<float>::infinity());
+
+            const DynamicAABBTree& GetTree() const;
+
+            // Models whose bounds were updated since the last call, by way of the dirty bounds list
+            QSet<Model*> TakeMovedModels();
+
             void ToJson(QJsonObject& object);
 
         signals:
             void NodeCreated(Canavar::Engine::Node* node);
 
         private:
+            friend class Node;
+
             void AssignName(Node* node, const QString& name);
+            void UpdateBounds();
+            void RegisterNode(Node* node);
+            void UnregisterNode(Node* node);
+
+            template<typename T>
+            void AddToBucket(QList<T*>& bucket, T* node);
+
+            template<typename T>
+            void RemoveFromBucket(QList<T*>& bucket, T* node);
 
         private:
             QList<Node*> mNodes;
             int mNumberOfNodes;
 
+            // Lookup indices, kept in sync with mNodes
+            QHash<int, Node*> mNodesByID;
+            QHash<QString, Node*> mNodesByUUID;
+            QMultiHash<QString, Node*> mNodesByName;
+
+            // Per-type buckets, kept in sync with mNodes
+            QList<Model*> mModels;
+            QList<NozzleEffect*> mNozzleEffects;
+            QList<FirecrackerEffect*> mFirecrackerEffects;
+            QList<Light*> mLights;
+            QList<Camera*> mCameras;
+
+            DynamicAABBTree mTree;
+            QList<Node*> mBoundsDirtyNodes; // Appended by Node::MarkBoundsDirty
+            QSet<Model*> mMovedModels;      // Filled by UpdateBounds, drained by TakeMovedModels
+
             CameraManager* mCameraManager;
             LightManager* mLightManager;
             ModelDataManager* mModelDataManager;
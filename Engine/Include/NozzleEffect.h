@@ -20,7 +20,8 @@ namespace Canavar {
             void Create();
 
         public:
-            void Render(float ifps);
+            void Update(float ifps);
+            void Render();
 
         private:
             struct Particle {
@@ -36,6 +37,12 @@ namespace Canavar {
             ShaderManager* mShaderManager;
             CameraManager* mCameraManager;
 
+            UniformHandle mMVPUniform;
+            UniformHandle mScaleUniform;
+            UniformHandle mMaxRadiusUniform;
+            UniformHandle mMaxDistanceUniform;
+            UniformHandle mSpeedUniform;
+
             QVector<Particle> mParticles;
             int mNumberOfParticles;
 
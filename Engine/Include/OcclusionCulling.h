@@ -0,0 +1,93 @@
+#pragma once
+
+#include "AABB.h"
+#include "Common.h"
+
+#include <QMatrix4x4>
+#include <QQuaternion>
+#include <QOpenGLExtraFunctions>
+#include <QSize>
+#include <QVector>
+
+namespace Canavar {
+    namespace Engine {
+        class ShaderManager;
+
+        // Hierarchical-Z occlusion culling against the depth of the previous frame. The pyramid is built on the GPU
+        // after the models are drawn, a coarse level of it is read back asynchronously for the CPU test.
+        class OcclusionCulling : protected QOpenGLExtraFunctions
+        {
+        public:
+            OcclusionCulling();
+
+            void Init();
+            void Resize(int width, int height);
+
+            // The depth attachment of framebuffer becomes the base of the pyramid, framebuffer is bound again afterwards
+            void Build(GLuint framebuffer, const QMatrix4x4& viewProjection);
+
+            // Picks up the last read back level if the GPU is done with it, call once per frame before IsOccluded().
+            // The pyramid is dropped if the camera jumped since the last call, its depth would not match the view.
+            void Update(const QVector3D& cameraPosition, const QQuaternion& cameraRotation);
+
+            // Drops the pyramid and the pending read back, IsOccluded() is false until the next one arrives
+            void Invalidate();
+
+            // Conservative, false if there is no pyramid yet or the box reaches behind the camera of the pyramid
+            bool IsOccluded(const AABB& localAABB, const QMatrix4x4& transformation) const;
+
+            // For GPU tests, valid if IsPyramidValid()
+            bool IsPyramidValid() const;
+            GLuint GetPyramidTexture() const;
+            const QMatrix4x4& GetPyramidViewProjection() const;
+
+            // Shows the pyramid level DebugLevel in the lower left corner of the bound framebuffer
+            void RenderDebug(GLuint quadVAO, float zNear, float zFar);
+
+            int GetNumberOfLevels() const;
+
+        private:
+            void DeleteResources();
+
+        private:
+            ShaderManager* mShaderManager;
+
+            int mWidth;
+            int mHeight;
+            int mNumberOfLevels;
+
+            GLuint mDepthFramebuffer;
+            GLuint mDepthTexture;
+            GLenum mDepthFormat;
+            GLuint mPyramidTexture;
+            QMatrix4x4 mPyramidViewProjection; // Of the frame the pyramid is built from
+            bool mPyramidValid;
+
+            // Asynchronous read back of one coarse level
+            GLuint mReadbackFramebuffer;
+            GLuint mReadbackBuffer;
+            GLsync mReadbackFence;
+            int mReadbackLevel;
+            QMatrix4x4 mReadbackViewProjection;
+
+            // CPU copy, mLevels[0] is mReadbackLevel of the GPU pyramid
+            QVector<QVector<float>> mLevels;
+            QVector<QSize> mLevelSizes;
+            QMatrix4x4 mViewProjection;
+
+            // Camera of the previous Update()
+            QVector3D mCameraPosition;
+            QQuaternion mCameraRotation;
+
+            UniformHandle mSourceUniform;
+            UniformHandle mSourceLevelUniform;
+            UniformHandle mCopyUniform;
+            UniformHandle mPyramidUniform;
+            UniformHandle mLevelUniform;
+            UniformHandle mZNearUniform;
+            UniformHandle mZFarUniform;
+
+            DEFINE_MEMBER(int, DebugLevel); // -1 disables the debug view
+        };
+    } // namespace Engine
+} // namespace Canavar
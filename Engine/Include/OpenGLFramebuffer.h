@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QOpenGLExtraFunctions>
+#include <QString>
 
 namespace Canavar {
     namespace Engine {
@@ -9,7 +10,7 @@ namespace Canavar {
         public:
             OpenGLFramebuffer();
 
-            void Init();
+            void Init(const QString& owner); // Name in GPUMemoryTracker
             void Create(int width, int height);
             void Destroy();
 
@@ -17,6 +18,7 @@ namespace Canavar {
             void Release();
 
         private:
+            QString mOwner;
             bool mCreated;
             unsigned int mFBO;
             unsigned int mRBO;
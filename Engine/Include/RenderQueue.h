@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Common.h"
+
+#include <QMatrix4x4>
+#include <QOpenGLExtraFunctions>
+#include <QVector>
+
+class QOpenGLFunctions_4_3_Core;
+
+namespace Canavar {
+    namespace Engine {
+        class Mesh;
+        class Material;
+        class ShaderManager;
+
+        class RenderQueue : protected QOpenGLExtraFunctions
+        {
+        public:
+            RenderQueue();
+
+            enum class Pass { //
+                Opaque = 0
+            };
+
+            void Init();
+            void Clear();
+
+            // Depth is the view distance, quantized against MaxDepth for the sort key.
+            // nodeTransformation must stay valid until Submit(). The level of detail is the one of model.
+            void AddMesh(Mesh* mesh, Model* model, const QMatrix4x4* nodeTransformation, float depth);
+
+            // Instances [firstInstance, firstInstance + count) must already be in the Instances storage block
+            void AddInstancedMesh(Mesh* mesh, int lod, int firstInstance, int count, float depth);
+
+            // Same as AddInstancedMesh() for meshes in GeometryArena. Consecutive packets sharing
+            // the shader, the arena page and the material are drawn with one glMultiDrawElementsIndirect.
+            void AddIndirectMesh(Mesh* mesh, int lod, int firstInstance, int count, float depth);
+
+            // Sorts the packets and uploads the indirect commands, called by Submit() if not called before
+            void Prepare();
+
+            // Sorts the packets and draws them, skipping redundant shader, texture and VAO binds
+            void Submit();
+
+            // Layout consumed by glMultiDrawElementsIndirect
+            struct DrawElementsIndirectCommand {
+                GLuint count;
+                GLuint instanceCount;
+                GLuint firstIndex;
+                GLint baseVertex;
+                GLuint baseInstance;
+            };
+
+            // Valid after Prepare(), one command per indirect packet, in draw order
+            const QVector<DrawElementsIndirectCommand>& GetIndirectCommands() const;
+            const QVector<Mesh*>& GetIndirectMeshes() const;
+            GLuint GetIndirectBuffer() const;
+
+            // glMultiDrawElementsIndirect needs a 4.3 core context, valid after Init()
+            bool IsIndirectDrawingSupported() const;
+
+        private:
+            struct DrawPacket {
+                quint64 key;
+                Mesh* mesh;
+                Model* model; // nullptr for instanced packets
+                const QMatrix4x4* nodeTransformation;
+                int firstInstance;
+                int instanceCount;
+                int lod;
+                bool indirect;
+            };
+
+            quint64 MakeKey(Pass pass, ShaderType shader, Mesh* mesh, GLuint vao, float depth);
+            GLuint GetVAO(const DrawPacket& packet) const;
+            void UploadIndirectCommands();
+            int SubmitIndirect(int first);
+            ShaderType GetShaderType(Mesh* mesh, bool instanced) const;
+            void BindShader(ShaderType shader);
+            void BindMaterial(Material* material);
+            void BindTexture(int unit, GLuint id);
+            void BindVAO(GLuint vao);
+
+        private:
+            ShaderManager* mShaderManager;
+            QOpenGLFunctions_4_3_Core* mFunctions43;
+
+            QVector<DrawPacket> mPackets;
+            QVector<DrawElementsIndirectCommand> mCommands;
+            QVector<Mesh*> mCommandMeshes;
+            bool mPrepared;
+            GLuint mIndirectBuffer;
+            int mNextCommand; // First command of the next indirect run
+
+            ShaderType mCurrentShader;
+            Material* mCurrentMaterial;
+            GLuint mCurrentVAO;
+            GLuint mBoundTextures[4];
+
+            UniformHandle mInstanceOffsetUniform;
+            UniformHandle mIndirectUniform;
+            UniformHandle mUseTextureUniforms[4];
+            UniformHandle mTextureUniforms[4];
+
+            // When disabled packets are drawn in submission order and every packet restores its full state
+            DEFINE_MEMBER(bool, SortingEnabled);
+            DEFINE_MEMBER(float, MaxDepth);
+            DEFINE_MEMBER_CONST(int, NumberOfDrawCalls);
+            DEFINE_MEMBER_CONST(int, NumberOfShaderSwitches);
+            DEFINE_MEMBER_CONST(int, NumberOfTextureBinds);
+            DEFINE_MEMBER_CONST(int, NumberOfVAOBinds);
+            DEFINE_MEMBER_CONST(int, NumberOfIndirectCommands);
+        };
+    } // namespace Engine
+} // namespace Canavar
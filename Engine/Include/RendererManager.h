@@ -1,11 +1,17 @@
 #pragma once
 
 #include "Camera.h"
+#include "Frustum.h"
+#include "GPUCulling.h"
+#include "ImpostorRenderer.h"
 #include "LineStrip.h"
 #include "Manager.h"
+#include "OcclusionCulling.h"
 #include "OpenGLVertexArrayObject.h"
+#include "RenderQueue.h"
 #include "SelectedMeshParameters.h"
 
+#include <QHash>
 #include <QOpenGLExtraFunctions>
 #include <QOpenGLFramebufferObjectFormat>
 
@@ -16,12 +22,17 @@ namespace Canavar {
         class LightManager;
         class ShaderManager;
         class ModelDataManager;
+        class ModelData;
         class Haze;
         class Sky;
         class Terrain;
         class PointLight;
         class Sun;
         class Config;
+        class NozzleEffect;
+        class FirecrackerEffect;
+        class Mesh;
+        class GPUMemoryTracker;
 
         class RendererManager : public Manager, protected QOpenGLExtraFunctions
         {
@@ -34,6 +45,7 @@ namespace Canavar {
             bool Init() override;
             void Resize(int width, int height) override;
 
+            void Update(float ifps) override;
             void Render(float ifps) override;
 
             void AddSelectableNode(Node* node, QVector4D color = QVector4D(1, 1, 1, 1));
@@ -50,6 +62,22 @@ namespace Canavar {
 
             const QMap<Model*, SelectedMeshParameters>& GetSelectedMeshes() const;
 
+            // Result of the culling stage, valid after Update(). While GPU culling is active the models drawn
+            // entirely from GeometryArena are not occlusion tested on the CPU, the compute pass tests their meshes.
+            const Frustum& GetFrustum() const;
+            const QList<Model*>& GetVisibleModels() const;
+
+            RenderQueue& GetRenderQueue();
+            GPUCulling& GetGPUCulling();
+            OcclusionCulling& GetOcclusionCulling();
+            ImpostorRenderer& GetImpostorRenderer();
+
+            // Of the models drawn last frame, by level of detail
+            const QVector<int>& GetNumberOfModelsPerLod() const;
+
+            // GPU culling tests the arena meshes of the visible models per instance, it needs frustum culling and indirect drawing enabled
+            bool IsGPUCullingActive() const;
+
         private:
             enum class FramebufferType { //
                 Default,
@@ -58,13 +86,85 @@ namespace Canavar {
                 Pong,
             };
 
-            void SetCommonUniforms();
+            static constexpr const char* FRAMEBUFFER_OWNERS[] = { "Pass: Default", "Pass: Temporary", "Pass: Ping", "Pass: Pong" };
+
+            // Ratio between the errors that make a model switch to a finer and to a coarser level, against popping
+            static constexpr float LOD_HYSTERESIS = 1.25f;
+
+            // Layout of Instance in Model*Instanced shaders (std430)
+            struct InstanceData {
+                float M[16];
+                float N[16]; // Upper 3x3 is the normal matrix
+                QVector4D color;
+                QVector4D overlayColor;
+                QVector4D meshOverlayColor;
+                float overlayColorFactor;
+                float meshOverlayColorFactor;
+                float ambient;
+                float diffuse;
+                float specular;
+                float shininess;
+                float padding[2];
+            };
+
+            // Layout of the FrameData uniform block in Common.glsl (std140)
+            struct FrameData {
+                float VP[16];
+                float cameraPos[3];
+                int numberOfPointLights;
+
+                struct {
+                    float direction[3];
+                    float padding0;
+                    float color[4];
+                    float ambient;
+                    float diffuse;
+                    float specular;
+                    float padding1;
+                } sun;
+
+                struct {
+                    int enabled;
+                    float padding0[3];
+                    float color[3];
+                    float density;
+                    float gradient;
+                    float padding1[3];
+                } haze;
+
+                struct {
+                    float color[4];
+                    float position[3];
+                    float ambient;
+                    float diffuse;
+                    float specular;
+                    float constant;
+                    float linear;
+                    float quadratic;
+                    float padding[3];
+                } pointLights[8];
+            };
+
+            void UpdateFrameData();
+            void Cull();
+            void RenderModels();
+            bool IsOccluded(Model* model); // Counts the test, false if occlusion culling is disabled
+            void SelectLod(Model* model, float pixelsPerUnit);
+            void FillInstanceData(InstanceData& data, Model* model, Mesh* mesh, const QMatrix4x4& nodeTransformation);
+            void FillInstanceMaterial(InstanceData& data, Model* model, Mesh* mesh);
+
+            // Persistent instances of the models drawn with GPU culling, one slot per draw list entry
+            int GetInstanceSlots(Model* model);
+            void UpdateInstanceSlots(Model* model, int firstSlot, bool transformation); // Only the material if not transformation
+            void UploadInstances();
             void DeleteFramebuffers();
             void CreateFramebuffers(int width, int height);
 
             void OnSelectedNodeDestroyed(QObject* node);
             void OnSelectedModelDestroyed(QObject* model);
             void OnLineStripDestroyed(QObject* lineStrip);
+            void OnModelDataEvicted(ModelData* data);
+            void OnInstancedModelDestroyed(QObject* model);
 
         private:
             NodeManager* mNodeManager;
@@ -72,6 +172,7 @@ namespace Canavar {
             LightManager* mLightManager;
             ShaderManager* mShaderManager;
             ModelDataManager* mModelDataManager;
+            GPUMemoryTracker* mTracker;
 
             Camera* mCamera;
             Sun* mSun;
@@ -87,15 +188,69 @@ namespace Canavar {
 
             QList<LineStrip*> mLineStrips;
 
+            Frustum mFrustum;
+            QList<Model*> mVisibleModels;
+            QList<NozzleEffect*> mVisibleNozzleEffects;
+            QList<FirecrackerEffect*> mVisibleFirecrackerEffects;
+
+            RenderQueue mRenderQueue;
+            GPUCulling mGPUCulling;
+            OcclusionCulling mOcclusionCulling;
+            ImpostorRenderer mImpostorRenderer;
+
+            QVector<int> mNumberOfModelsPerLod;
+
+            // The Instances storage block holds the slots first, then the instances built every frame
+            QVector<InstanceData> mInstanceSlots;         // Same content as the start of mInstanceBuffer
+            QHash<Model*, QPair<int, int>> mSlotsByModel; // First slot and number of slots
+            QMultiHash<int, int> mFreeSlots;              // First slots of released ranges, by number of slots
+            QVector<int> mDirtySlots;                     // Uploaded by UploadInstances()
+            QVector<GLuint> mInstanceCandidates;          // Slots tested by GPUCulling, by indirect command
+            QVector<InstanceData> mInstanceData;
+            GLuint mInstanceBuffer;
+            int mInstanceBufferCapacity;
+
+            FrameData mFrameData;
+            GLuint mFrameDataBuffer;
+
             QMap<FramebufferType, QOpenGLFramebufferObject*> mFBOs;
             QMap<FramebufferType, QOpenGLFramebufferObjectFormat*> mFBOFormats;
 
             int mWidth;
             int mHeight;
 
+            // Placeholders, selectables, line strips and post processing
+            UniformHandle mMVPUniform;
+            UniformHandle mVPUniform;
+            UniformHandle mColorUniform;
+            UniformHandle mScaleUniform;
+            UniformHandle mSelectedVertexIDUniform;
+            UniformHandle mVertexColorUniform;
+            UniformHandle mSelectedVertexColorUniform;
+            UniformHandle mHorizontalUniform;
+            UniformHandle mScreenTextureUniform;
+            UniformHandle mSceneTextureUniform;
+            UniformHandle mBloomBlurTextureUniform;
+            UniformHandle mExposureUniform;
+            UniformHandle mGammaUniform;
+
             DEFINE_MEMBER(int, BlurPass);
             DEFINE_MEMBER(float, Exposure);
             DEFINE_MEMBER(float, Gamma);
+            DEFINE_MEMBER(bool, FrustumCullingEnabled);
+            DEFINE_MEMBER_CONST(int, NumberOfDrawnNodes);
+            DEFINE_MEMBER_CONST(int, NumberOfCulledNodes);
+            DEFINE_MEMBER(bool, InstancingEnabled);
+            DEFINE_MEMBER_CONST(int, NumberOfInstancedDrawCalls);
+            DEFINE_MEMBER(bool, IndirectDrawingEnabled); // Only affects meshes in GeometryArena
+            DEFINE_MEMBER(bool, GPUCullingEnabled);
+            DEFINE_MEMBER(bool, OcclusionCullingEnabled);
+            DEFINE_MEMBER_CONST(int, NumberOfOcclusionTestedNodes); // Only counted by the CPU test
+            DEFINE_MEMBER_CONST(int, NumberOfOccludedNodes);
+            DEFINE_MEMBER(bool, LodEnabled);
+            DEFINE_MEMBER(float, LodPixelError); // Largest screen space error of the selected levels, before Model::LodBias
+            DEFINE_MEMBER(bool, ImpostorsEnabled);
+            DEFINE_MEMBER(float, ImpostorDistance); // Models farther away from the camera are drawn as impostors
 
             OpenGLVertexArrayObject mQuad;
             OpenGLVertexArrayObject mCube;
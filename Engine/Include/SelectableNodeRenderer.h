@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Common.h"
 #include "Manager.h"
 #include "OpenGLFramebuffer.h"
 #include "OpenGLVertexArrayObject.h"
@@ -46,6 +47,12 @@ namespace Canavar {
 
             OpenGLVertexArrayObject mCube;
 
+            UniformHandle mMVPUniform;
+            UniformHandle mScaleUniform;
+            UniformHandle mNodeIDUniform;
+            UniformHandle mMeshIDUniform;
+            UniformHandle mFillVertexInfoUniform;
+
             OpenGLFramebuffer mNodeInfoFBO;
             int mWidth;
             int mHeight;
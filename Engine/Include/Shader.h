@@ -2,13 +2,14 @@
 
 #include "Common.h"
 
+#include <QHash>
 #include <QObject>
-#include <QOpenGLFunctions>
+#include <QOpenGLExtraFunctions>
 #include <QOpenGLShader>
 
 namespace Canavar {
     namespace Engine {
-        class Shader : public QObject, protected QOpenGLFunctions
+        class Shader : public QObject, protected QOpenGLExtraFunctions
         {
         public:
             Shader(ShaderType type);
@@ -29,10 +30,27 @@ namespace Canavar {
             void SetUniformValueArray(const QString& name, const QVector<QVector3D>& values);
             void SetSampler(const QString& name, unsigned int unit, unsigned int id, GLenum target = GL_TEXTURE_2D);
 
+            void SetUniformValue(UniformHandle handle, int value);
+            void SetUniformValue(UniformHandle handle, unsigned int value);
+            void SetUniformValue(UniformHandle handle, float value);
+            void SetUniformValue(UniformHandle handle, const QVector3D& value);
+            void SetUniformValue(UniformHandle handle, const QVector4D& value);
+            void SetUniformValue(UniformHandle handle, const QMatrix4x4& value);
+            void SetUniformValue(UniformHandle handle, const QMatrix3x3& value);
+            void SetSampler(UniformHandle handle, unsigned int unit, unsigned int id, GLenum target = GL_TEXTURE_2D);
+
+            // Stores the location of "name" under the given handle id
+            void ResolveHandle(int id, const QString& name);
+
+            int GetUniformLocation(const QString& name) const;
+            int GetUniformLocation(UniformHandle handle) const;
+
             ShaderType GetType() const;
 
         private:
             QString GetShaderTypeString(QOpenGLShader::ShaderTypeBit type);
+            QByteArray GetSource(const QString& path, int depth = 0);
+            void ReflectUniforms();
 
         private:
             QOpenGLShaderProgram* mProgram;
@@ -42,6 +60,9 @@ namespace Canavar {
             QString mShaderName;
 
             QStringList mAttributes;
+
+            QHash<QString, int> mUniformLocations;
+            QVector<int> mHandleLocations;
         };
     } // namespace Engine
 } // namespace Canavar
@@ -23,6 +23,7 @@ namespace Canavar {
             Shader* GetShader(ShaderType shader);
 
             bool Init() override;
+            void Update(float ifps) override;
 
             bool Bind(ShaderType shader);
             void Release();
@@ -37,9 +38,29 @@ namespace Canavar {
             void SetUniformValueArray(const QString& name, const QVector<QVector3D>& values);
             void SetSampler(const QString& name, unsigned int unit, unsigned int id, GLenum target = GL_TEXTURE_2D);
 
+            // Resolves "name" once for all shaders. Handles stay valid for the lifetime of the manager.
+            UniformHandle GetUniformHandle(const QString& name);
+
+            void SetUniformValue(UniformHandle handle, int value);
+            void SetUniformValue(UniformHandle handle, unsigned int value);
+            void SetUniformValue(UniformHandle handle, float value);
+            void SetUniformValue(UniformHandle handle, const QVector3D& value);
+            void SetUniformValue(UniformHandle handle, const QVector4D& value);
+            void SetUniformValue(UniformHandle handle, const QMatrix4x4& value);
+            void SetUniformValue(UniformHandle handle, const QMatrix3x3& value);
+            void SetSampler(UniformHandle handle, unsigned int unit, unsigned int id, GLenum target = GL_TEXTURE_2D);
+
         private:
-            ShaderType mActiveShader;
+            Shader* mActiveShader;
             QMap<ShaderType, Shader*> mShaders;
+
+            QHash<QString, int> mUniformHandles;
+            QStringList mUniformNames;
+
+            // Uniforms set by name during the current frame
+            int mUniformLookups;
+
+            DEFINE_MEMBER_CONST(int, NumberOfUniformLookups);
         };
     } // namespace Engine
 } // namespace Canavar
@@ -47,6 +47,20 @@ namespace Canavar {
             CameraManager* mCameraManager;
             LightManager* mLightManager;
 
+            UniformHandle mIVPUniform;
+            UniformHandle mSkyYOffsetUniform;
+            UniformHandle mSunDirUniform;
+            UniformHandle mAUniform;
+            UniformHandle mBUniform;
+            UniformHandle mCUniform;
+            UniformHandle mDUniform;
+            UniformHandle mEUniform;
+            UniformHandle mFUniform;
+            UniformHandle mGUniform;
+            UniformHandle mHUniform;
+            UniformHandle mIUniform;
+            UniformHandle mZUniform;
+
             // OpenGL Stuff
             unsigned int mVAO;
             unsigned int mVBO;
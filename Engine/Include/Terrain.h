@@ -41,10 +41,41 @@ namespace Canavar {
 
             TileGenerator* mTileGenerator;
 
-            QMap<QString, QOpenGLTexture*> mTextures;
+            enum TextureType { //
+                Sand,
+                Grass,
+                Snow,
+                RockDiffuse,
+                RockNormal,
+                TerrainTexture,
+                NumberOfTextures
+            };
+
+            QOpenGLTexture* mTextures[NumberOfTextures];
 
             QVector2D mPreviousTilePosition;
 
+            // TerrainShader
+            UniformHandle mMUniform;
+            UniformHandle mAmplitudeUniform;
+            UniformHandle mSeedUniform;
+            UniformHandle mOctavesUniform;
+            UniformHandle mFrequencyUniform;
+            UniformHandle mTessellationMultiplierUniform;
+            UniformHandle mPowerUniform;
+            UniformHandle mGrassCoverageUniform;
+            UniformHandle mAmbientUniform;
+            UniformHandle mDiffuseUniform;
+            UniformHandle mShininessUniform;
+            UniformHandle mSpecularUniform;
+            UniformHandle mWaterHeightUniform;
+            UniformHandle mSandUniform;
+            UniformHandle mGrassUniform;
+            UniformHandle mTerrainTextureUniform;
+            UniformHandle mSnowUniform;
+            UniformHandle mRockUniform;
+            UniformHandle mRockNormalUniform;
+
             DEFINE_MEMBER(float, Amplitude);
             DEFINE_MEMBER(float, Frequency);
             DEFINE_MEMBER(int, Octaves);
@@ -1,10 +1,5 @@
-struct Model
-{
-    float ambient;
-    float diffuse;
-    float specular;
-    float shininess;
-};
+// Per-frame data shared by all lit shaders. Filled once per frame by RendererManager.
+// Keep in sync with RendererManager::FrameData (std140).
 
 struct Sun
 {
@@ -15,6 +10,14 @@ struct Sun
     float specular;
 };
 
+struct Haze
+{
+    bool enabled;
+    vec3 color;
+    float density;
+    float gradient;
+};
+
 struct PointLight
 {
     vec4 color;
@@ -27,79 +30,34 @@ struct PointLight
     float quadratic;
 };
 
-struct Haze
+layout(std140) uniform FrameData
 {
-    bool enabled;
-    vec3 color;
-    float density;
-    float gradient;
+    mat4 VP; // View-Projection matrix
+    vec3 cameraPos;
+    int numberOfPointLights;
+    Sun sun;
+    Haze haze;
+    PointLight pointLights[8];
 };
 
-uniform Haze haze;
-uniform Sun sun;
-uniform Model model;
-
-uniform PointLight pointLights[8];
-uniform int numberOfPointLights;
-
-vec4 processSun(vec4 ambientColor, vec4 diffuseColor, vec4 specularColor, vec3 normal, vec3 viewDir)
+// Inverse of the octahedral encoding in Mesh::Create (compact vertex format)
+vec3 DecodeOctahedral(vec2 e)
 {
-    // Ambient
-    vec4 ambient = ambientColor * model.ambient * sun.ambient;
-
-    // Diffuse
-    vec4 diffuse = diffuseColor * max(dot(normal, sun.direction), 0.0) * sun.diffuse * model.diffuse;
-
-    // Specular
-    vec3 reflectDir = reflect(-sun.direction, normal);
-    vec3 halfwayDir = normalize(sun.direction + viewDir);
-    vec4 specular = specularColor * pow(max(dot(normal, halfwayDir), 0.0), model.shininess) * model.specular * sun.specular;
-
-    return (ambient + diffuse + specular) * sun.color;
-}
-
-vec4 processPointLights(vec4 ambientColor, vec4 diffuseColor, vec4 specularColor, vec3 normal, vec3 viewDir, vec3 fragWorldPos)
-{
-    vec4 result = vec4(0);
-
-    for (int i = 0; i < numberOfPointLights; i++)
-    {
-        // Ambient
-        vec4 ambient = ambientColor * pointLights[i].ambient * pointLights[i].ambient;
-
-        // Diffuse
-        vec3 lightDir = normalize(pointLights[i].position - fragWorldPos);
-        vec4 diffuse =  diffuseColor * max(dot(normal, lightDir), 0.0) * pointLights[i].diffuse * model.diffuse;
-
-        // Specular
-        vec3 reflectDir = reflect(-lightDir, normal);
-        vec3 halfwayDir = normalize(lightDir + viewDir);
-        vec4 specular = specularColor * pow(max(dot(normal, halfwayDir), 0.0), model.shininess) * pointLights[i].specular * model.specular;
-
-        // Attenuation
-        float distance = length(pointLights[i].position - fragWorldPos);
-        float attenuation = 1.0f / (pointLights[i].constant + pointLights[i].linear * distance + pointLights[i].quadratic * (distance * distance));
-
-        ambient *= attenuation;
-        diffuse *= attenuation;
-        specular *= attenuation;
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
 
-        result += (ambient + diffuse + specular) * pointLights[i].color;
-    }
+    if (v.z < 0.0)
+        v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
 
-    return result;
+    return normalize(v);
 }
 
-vec4 processHaze(float distance, vec3 fragWorldPos, vec4 subjectColor)
+// Inverse of DecodeOctahedral
+vec2 EncodeOctahedral(vec3 v)
 {
-    vec4 result = subjectColor;
+    vec2 e = v.xy / (abs(v.x) + abs(v.y) + abs(v.z));
 
-    if(haze.enabled)
-    {
-        float factor = exp(-pow(distance * 0.00005f * haze.density, haze.gradient));
-        factor = clamp(factor, 0.0f, 1.0f);
-        result =  mix(vec4(haze.color, 1) * clamp(sun.direction.y, 0.0f, 1.0f), subjectColor, factor);
-    }
+    if (v.z < 0.0)
+        e = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
 
-    return result;
+    return e;
 }
@@ -0,0 +1,21 @@
+#version 330 core
+
+uniform sampler2D pyramid;
+uniform int level;
+uniform float zNear;
+uniform float zFar;
+
+in vec2 fsTextureCoords;
+
+out vec4 outColor;
+
+void main()
+{
+    ivec2 size = textureSize(pyramid, level);
+    float depth = texelFetch(pyramid, min(ivec2(fsTextureCoords * size), size - 1), level).r;
+
+    // Linear eye depth on a log scale, near is black and far is white
+    float z = zNear * zFar / (zFar - depth * (zFar - zNear));
+
+    outColor = vec4(vec3(log(z / zNear) / log(zFar / zNear)), 1.0);
+}
@@ -0,0 +1,101 @@
+#version 430 core
+
+#include "Common.glsl"
+
+struct Impostor
+{
+    mat4 rotation;
+    vec4 sphere;
+    vec4 color;
+    vec4 overlayColor;
+    float overlayColorFactor;
+    float ambient;
+    float diffuse;
+    float specular;
+    float shininess;
+};
+
+layout(std430, binding = 0) readonly buffer Impostors
+{
+    Impostor impostors[];
+};
+
+uniform sampler2D textureAlbedo;      // Premultiplied by the coverage in a
+uniform sampler2D textureNormalDepth; // Octahedral model space normal in xy, depth in z, tint in w, premultiplied
+
+in vec3 fsPosition;
+in vec2 fsTextureCoords;
+flat in vec3 fsViewDir;
+flat in int fsInstanceID;
+
+layout (location = 0) out vec4 fragColor;
+layout (location = 1) out vec4 brightColor;
+
+Impostor impostor;
+
+vec4 processSun(vec4 color, vec3 normal, vec3 viewDir)
+{
+    // Ambient
+    float ambient = impostor.ambient * sun.ambient;
+
+    // Diffuse
+    float diffuse = max(dot(normal, sun.direction), 0.0) * impostor.diffuse * sun.diffuse;
+
+    // Specular
+    vec3 halfwayDir = normalize(sun.direction + viewDir);
+    float specular = pow(max(dot(normal, halfwayDir), 0.0), impostor.shininess) * impostor.specular * sun.specular;
+
+    return clamp(ambient + diffuse + specular, 0.0f, 1.0f) * color * sun.color;
+}
+
+vec4 processHaze(float distance, vec3 fragWorldPos, vec4 subjectColor)
+{
+    vec4 result = subjectColor;
+
+    if(haze.enabled)
+    {
+        float factor = exp(-pow(distance * 0.00005f * haze.density, haze.gradient));
+        factor = clamp(factor, 0.0f, 1.0f);
+        result =  mix(vec4(haze.color * clamp(sun.direction.y, 0.0f, 1.0f), 1) , subjectColor, factor);
+    }
+
+    return result;
+}
+
+void main()
+{
+    impostor = impostors[fsInstanceID];
+
+    vec4 albedo = texture(textureAlbedo, fsTextureCoords);
+
+    if (albedo.a < 0.5)
+        discard;
+
+    vec4 surface = texture(textureNormalDepth, fsTextureCoords) / albedo.a;
+    vec4 color = vec4(albedo.rgb / albedo.a, 1.0) * mix(vec4(1.0), impostor.color, surface.w);
+    vec3 normal = mat3(impostor.rotation) * DecodeOctahedral(2.0 * surface.xy - 1.0);
+
+    // Back from the quad to the baked surface, depth 0 is on the sphere on the side of the camera
+    vec3 position = fsPosition + fsViewDir * impostor.sphere.w * (1.0 - 2.0 * surface.z);
+    vec4 clipPosition = VP * vec4(position, 1.0);
+    gl_FragDepth = 0.5 * clipPosition.z / clipPosition.w + 0.5;
+
+    // Common
+    vec3 viewDir = normalize(cameraPos - position);
+    float distance = length(cameraPos - position);
+
+    // Point lights are left out, they do not reach this far
+    vec4 result = processSun(color, normal, viewDir);
+
+    // Final
+    result = processHaze(distance, position, result);
+    result = mix(result, impostor.overlayColor, impostor.overlayColorFactor);
+
+    fragColor = vec4(result.xyz, 1);
+
+    float brightness = dot(result.rgb, vec3(0.2126f, 0.7152f, 0.0722f));
+    if(brightness > 1.0f)
+        brightColor = vec4(result.rgb, 1.0f);
+    else
+        brightColor = vec4(0.0f);
+}
@@ -0,0 +1,56 @@
+#version 430 core
+
+#include "Common.glsl"
+
+layout(location = 0) in vec2 position; // Corner of the screen quad, in [-1, 1]
+
+struct Impostor
+{
+    mat4 rotation; // Of the model, without scale
+    vec4 sphere;   // World space bounding sphere, radius in w
+    vec4 color;
+    vec4 overlayColor;
+    float overlayColorFactor;
+    float ambient;
+    float diffuse;
+    float specular;
+    float shininess;
+};
+
+layout(std430, binding = 0) readonly buffer Impostors
+{
+    Impostor impostors[];
+};
+
+uniform int instanceOffset; // First instance of this draw in the storage block
+uniform int gridSize;       // Views per side of the atlas
+
+out vec3 fsPosition;      // On the quad
+out vec2 fsTextureCoords; // Into the atlas
+flat out vec3 fsViewDir;  // Towards the camera of the baked view
+flat out int fsInstanceID;
+
+void main()
+{
+    int instanceID = instanceOffset + gl_InstanceID;
+    mat3 R = mat3(impostors[instanceID].rotation);
+    vec3 center = impostors[instanceID].sphere.xyz;
+    float radius = impostors[instanceID].sphere.w;
+
+    // The atlas is an octahedral map of the view directions in model space, pick the cell the camera is in
+    vec3 toCamera = transpose(R) * normalize(cameraPos - center);
+    ivec2 cell = clamp(ivec2((0.5 * EncodeOctahedral(toCamera) + 0.5) * gridSize), ivec2(0), ivec2(gridSize - 1));
+    vec3 viewDir = DecodeOctahedral(2.0 * (vec2(cell) + 0.5) / gridSize - 1.0);
+
+    // Same basis as the camera of the cell, see ImpostorRenderer::Bake
+    vec3 up = abs(viewDir.y) > 0.999 ? vec3(0, 0, 1) : vec3(0, 1, 0);
+    vec3 right = normalize(cross(up, viewDir));
+    up = cross(viewDir, right);
+
+    fsPosition = center + radius * (R * (position.x * right + position.y * up));
+    fsTextureCoords = (vec2(cell) + 0.5 * position + 0.5) / gridSize;
+    fsViewDir = R * viewDir;
+    fsInstanceID = instanceID;
+
+    gl_Position = VP * vec4(fsPosition, 1.0);
+}
@@ -0,0 +1,20 @@
+#version 430 core
+
+#include "Common.glsl"
+
+uniform bool useTextureAmbient; // Ambient or diffuse texture, as in the textured model shaders
+uniform sampler2D textureAmbient;
+uniform float tint; // 1 if Model::Color applies to the mesh, see the colored model shaders
+
+in vec3 fsNormal;
+in vec2 fsTextureCoords;
+
+// Texels that are not covered stay 0, so that the mip levels are premultiplied by the coverage in albedo.a
+layout (location = 0) out vec4 albedo;
+layout (location = 1) out vec4 normalDepth; // Octahedral normal in xy, depth in z, tint in w
+
+void main()
+{
+    albedo = vec4(useTextureAmbient ? texture(textureAmbient, fsTextureCoords).rgb : vec3(1.0), 1.0);
+    normalDepth = vec4(0.5 * EncodeOctahedral(normalize(fsNormal)) + 0.5, gl_FragCoord.z, tint);
+}
@@ -0,0 +1,23 @@
+#version 430 core
+
+#include "Common.glsl"
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal; // Octahedral in xy if compactVertices
+layout(location = 2) in vec2 textureCoords;
+
+uniform mat4 MVP; // View of the cell being baked times the node transformation
+uniform mat3 N;   // Normal matrix of the node transformation, normals stay in model space
+
+uniform bool compactVertices;
+
+out vec3 fsNormal;
+out vec2 fsTextureCoords;
+
+void main()
+{
+    fsNormal = N * (compactVertices ? DecodeOctahedral(normal.xy) : normal);
+    fsTextureCoords = textureCoords;
+
+    gl_Position = MVP * vec4(position, 1.0);
+}
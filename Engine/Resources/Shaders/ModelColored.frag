@@ -1,13 +1,6 @@
 #version 330 core
 
-struct Sun
-{
-    vec3 direction;
-    vec4 color;
-    float ambient;
-    float diffuse;
-    float specular;
-};
+#include "Common.glsl"
 
 struct Model
 {
@@ -23,35 +16,8 @@ struct Model
 
 };
 
-struct Haze
-{
-    bool enabled;
-    vec3 color;
-    float density;
-    float gradient;
-};
-
-struct PointLight
-{
-    vec4 color;
-    vec3 position;
-    float ambient;
-    float diffuse;
-    float specular;
-    float constant;
-    float linear;
-    float quadratic;
-};
-
-uniform Haze haze;
-uniform Sun sun;
 uniform Model model;
 
-uniform PointLight pointLights[8];
-uniform int numberOfPointLights;
-
-uniform vec3 cameraPos;
-
 in vec4 fsPosition;
 in vec3 fsNormal;
 
@@ -74,7 +40,6 @@ vec4 processSun(vec3 normal, vec3 viewDir)
     return clamp(ambient + diffuse + specular, 0.0f, 1.0f) * model.color * sun.color;
 }
 
-
 vec4 processPointLights(vec3 fragWorldPos, vec3 normal, vec3 viewDir)
 {
     vec4 result = vec4(0);
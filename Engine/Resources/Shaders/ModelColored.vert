@@ -1,22 +1,28 @@
 #version 330 core
+
+#include "Common.glsl"
+
 layout(location = 0) in vec3 position;
-layout(location = 1) in vec3 normal;
+layout(location = 1) in vec3 normal;   // Octahedral in xy if compactVertices
 layout(location = 2) in vec2 textureCoords;
-layout(location = 3) in vec3 tangent;
-layout(location = 4) in vec3 bitangent;
+layout(location = 3) in vec3 tangent;  // Octahedral in xy, handedness in z if compactVertices
+layout(location = 4) in vec3 bitangent; // Not provided if compactVertices
 layout(location = 5) in int[4] ids;
 layout(location = 6) in float[4] weights;
 
-
 uniform mat4 M; // Model matrix
-uniform mat4 VP; // View-Projection matrix
+uniform mat3 N; // Normal matrix
+
+uniform bool compactVertices;
 
 out vec4 fsPosition;
 out vec3 fsNormal;
 
 void main()
 {
+    vec3 vertexNormal = compactVertices ? DecodeOctahedral(normal.xy) : normal;
+
     fsPosition = M * vec4(position, 1.0);
-    fsNormal = normal;
+    fsNormal = N * vertexNormal;
     gl_Position = VP * fsPosition;
 }
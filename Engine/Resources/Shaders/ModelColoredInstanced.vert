@@ -0,0 +1,58 @@
+#version 430 core
+
+#include "Common.glsl"
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;   // Octahedral in xy if compactVertices
+layout(location = 2) in vec2 textureCoords;
+layout(location = 3) in vec3 tangent;  // Octahedral in xy, handedness in z if compactVertices
+layout(location = 4) in vec3 bitangent; // Not provided if compactVertices
+layout(location = 5) in int[4] ids;
+layout(location = 6) in float[4] weights;
+layout(location = 10) in uint instanceIndex; // baseInstance + gl_InstanceID, only bound for GeometryArena pages
+
+struct Model
+{
+    vec4 color;
+    vec4 overlayColor;
+    vec4 meshOverlayColor;
+    float overlayColorFactor;
+    float meshOverlayColorFactor;
+    float ambient;
+    float diffuse;
+    float specular;
+    float shininess;
+};
+
+struct Instance
+{
+    mat4 M; // Model matrix
+    mat4 N; // Normal matrix, upper 3x3 is used
+    Model model;
+};
+
+layout(std430, binding = 0) readonly buffer Instances
+{
+    Instance instances[];
+};
+
+uniform int instanceOffset; // First instance of this draw in the storage block
+uniform bool indirect;      // Drawn with glMultiDrawElementsIndirect, instanceOffset is not used
+
+uniform bool compactVertices;
+
+out vec4 fsPosition;
+out vec3 fsNormal;
+flat out int fsInstanceID;
+
+void main()
+{
+    int instanceID = indirect ? int(instanceIndex) : instanceOffset + gl_InstanceID;
+
+    vec3 vertexNormal = compactVertices ? DecodeOctahedral(normal.xy) : normal;
+
+    fsPosition = instances[instanceID].M * vec4(position, 1.0);
+    fsNormal = normalize(mat3(instances[instanceID].N) * vertexNormal);
+    fsInstanceID = instanceID;
+    gl_Position = VP * fsPosition;
+}
@@ -1,5 +1,7 @@
 #version 330 core
 
+#include "Common.glsl"
+
 struct Model
 {
     vec4 overlayColor;
@@ -12,44 +14,8 @@ struct Model
     float shininess;
 };
 
-struct Sun
-{
-    vec3 direction;
-    vec4 color;
-    float ambient;
-    float diffuse;
-    float specular;
-};
-
-struct PointLight
-{
-    vec4 color;
-    vec3 position;
-    float ambient;
-    float diffuse;
-    float specular;
-    float constant;
-    float linear;
-    float quadratic;
-};
-
-struct Haze
-{
-    bool enabled;
-    vec3 color;
-    float density;
-    float gradient;
-};
-
-uniform Haze haze;
-uniform Sun sun;
 uniform Model model;
 
-uniform PointLight pointLights[8];
-uniform int numberOfPointLights;
-
-uniform vec3 cameraPos;
-
 uniform bool useTextureAmbient;
 uniform bool useTextureDiffuse;
 uniform bool useTextureSpecular;
@@ -80,7 +46,6 @@ vec3 getNormal()
         return fsNormal;
 }
 
-
 vec4 processSun(vec4 ambientColor, vec4 diffuseColor, vec4 specularColor, vec3 normal, vec3 viewDir)
 {
     // Ambient
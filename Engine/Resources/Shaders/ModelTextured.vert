@@ -1,18 +1,22 @@
 #version 330 core
+
+#include "Common.glsl"
+
 layout(location = 0) in vec3 position;
-layout(location = 1) in vec3 normal;
+layout(location = 1) in vec3 normal;   // Octahedral in xy if compactVertices
 layout(location = 2) in vec2 textureCoords;
-layout(location = 3) in vec3 tangent;
-layout(location = 4) in vec3 bitangent;
+layout(location = 3) in vec3 tangent;  // Octahedral in xy, handedness in z if compactVertices
+layout(location = 4) in vec3 bitangent; // Not provided if compactVertices
 layout(location = 5) in int[4] ids;
 layout(location = 6) in float[4] weights;
 
 uniform mat4 M;  // Model matrix
 uniform mat3 N;  // Normal matrix
-uniform mat4 VP; // View-Projection matrix
 
 uniform bool useTextureNormal;
 
+uniform bool compactVertices;
+
 out vec4 fsPosition;
 out vec3 fsNormal;
 out vec2 fsTextureCoords;
@@ -20,15 +24,26 @@ out mat3 fsTBN;
 
 void main()
 {
+    vec3 vertexNormal = normal;
+    vec3 vertexTangent = tangent;
+    vec3 vertexBitangent = bitangent;
+
+    if (compactVertices)
+    {
+        vertexNormal = DecodeOctahedral(normal.xy);
+        vertexTangent = DecodeOctahedral(tangent.xy);
+        vertexBitangent = tangent.z * cross(vertexNormal, vertexTangent);
+    }
+
     fsPosition = M * vec4(position, 1.0);
-    fsNormal = N * normal;
+    fsNormal = N * vertexNormal;
     fsTextureCoords = textureCoords;
 
     if (useTextureNormal)
     {
-        vec3 T3 = normalize(vec3(M * vec4(tangent, 0.0)));
-        vec3 B3 = normalize(vec3(M * vec4(bitangent, 0.0)));
-        vec3 N3 = normalize(vec3(M * vec4(normal, 0.0)));
+        vec3 T3 = normalize(vec3(M * vec4(vertexTangent, 0.0)));
+        vec3 B3 = normalize(vec3(M * vec4(vertexBitangent, 0.0)));
+        vec3 N3 = normalize(vec3(M * vec4(vertexNormal, 0.0)));
         fsTBN = N * mat3(T3, B3, N3);
     }
 
@@ -22,33 +22,14 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "Common.glsl"
+
 in vec3 fsWorldPosition;
 in vec3 fsNormal;
 in vec2 fsTextureCoord;
 in float fsDistanceFromPosition;
 in float fsHeight;
 
-struct Sun
-{
-    vec4 color;
-    vec3 direction;
-    float ambient;
-    float diffuse;
-    float specular;
-};
-
-struct PointLight
-{
-    vec4 color;
-    vec3 position;
-    float ambient;
-    float diffuse;
-    float specular;
-    float constant;
-    float linear;
-    float quadratic;
-};
-
 struct Terrain
 {
     vec3 seed;
@@ -64,21 +45,8 @@ struct Terrain
     float specular;
 };
 
-struct Haze
-{
-    bool enabled;
-    vec3 color;
-    float density;
-    float gradient;
-};
-
-uniform Sun sun;
 uniform Terrain terrain;
-uniform Haze haze;
-uniform PointLight pointLights[8];
 
-uniform int numberOfPointLights;
-uniform vec3 cameraPos;
 uniform float waterHeight;
 uniform sampler2D sand, grass, terrainTexture, snow, rock, rockNormal;
 
@@ -328,7 +296,6 @@ vec4 processSun(vec4 color, vec3 normal, vec3 viewDir)
     return (ambient + diffuse + specular) * sun.color;
 }
 
-
 vec4 processPointLights(vec4 color, vec3 normal, vec3 viewDir, vec3 fragWorldPos)
 {
     vec4 result = vec4(0);
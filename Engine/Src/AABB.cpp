@@ -1,5 +1,10 @@
 #include "AABB.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CANAVAR_AABB_SSE
+#include <emmintrin.h>
+#endif
+
 Canavar::Engine::AABB::AABB() {}
 
 QMatrix4x4 Canavar::Engine::AABB::GetTransformation() const
@@ -12,50 +17,81 @@ QMatrix4x4 Canavar::Engine::AABB::GetTransformation() const
 
 Canavar::Engine::AABB Canavar::Engine::AABB::Transform(const QMatrix4x4 &transformation) const
 {
-    QVector<QVector3D> vertices;
-    vertices << mMin;
+    AABB aabb;
+    Transform(this, &aabb, 1, transformation);
+    return aabb;
+}
 
-    vertices << QVector3D(mMax.x(), mMin.y(), mMin.z());
-    vertices << QVector3D(mMin.x(), mMax.y(), mMin.z());
-    vertices << QVector3D(mMin.x(), mMin.y(), mMax.z());
+void Canavar::Engine::AABB::Transform(const AABB *input, AABB *output, int count, const QMatrix4x4 &transformation)
+{
+    // Column-major, the last row is ignored
+    const float *m = transformation.constData();
 
-    vertices << mMax;
-    vertices << QVector3D(mMin.x(), mMax.y(), mMax.z());
-    vertices << QVector3D(mMax.x(), mMin.y(), mMax.z());
-    vertices << QVector3D(mMax.x(), mMax.y(), mMin.z());
+#ifdef CANAVAR_AABB_SSE
+    const __m128 c0 = _mm_loadu_ps(m + 0);
+    const __m128 c1 = _mm_loadu_ps(m + 4);
+    const __m128 c2 = _mm_loadu_ps(m + 8);
+    const __m128 c3 = _mm_loadu_ps(m + 12);
 
-    for (int i = 0; i < vertices.size(); ++i)
-        vertices[i] = (transformation * QVector4D(vertices[i], 1)).toVector3D();
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 a0 = _mm_andnot_ps(signMask, c0);
+    const __m128 a1 = _mm_andnot_ps(signMask, c1);
+    const __m128 a2 = _mm_andnot_ps(signMask, c2);
 
-    float inf = std::numeric_limits<float>::infinity();
-    QVector3D min(inf, inf, inf);
-    QVector3D max(-inf, -inf, -inf);
+    const __m128 half = _mm_set1_ps(0.5f);
 
-    for (int i = 0; i < vertices.size(); ++i)
+    for (int i = 0; i < count; ++i)
     {
-        if (min[0] > vertices[i].x())
-            min[0] = vertices[i].x();
-
-        if (min[1] > vertices[i].y())
-            min[1] = vertices[i].y();
-
-        if (min[2] > vertices[i].z())
-            min[2] = vertices[i].z();
+        const QVector3D &min = input[i].mMin;
+        const QVector3D &max = input[i].mMax;
+
+        const __m128 lo = _mm_setr_ps(min.x(), min.y(), min.z(), 0.0f);
+        const __m128 hi = _mm_setr_ps(max.x(), max.y(), max.z(), 0.0f);
+        const __m128 center = _mm_mul_ps(_mm_add_ps(lo, hi), half);
+        const __m128 extent = _mm_mul_ps(_mm_sub_ps(hi, lo), half);
+
+        __m128 newCenter = c3;
+        newCenter = _mm_add_ps(newCenter, _mm_mul_ps(c0, _mm_shuffle_ps(center, center, _MM_SHUFFLE(0, 0, 0, 0))));
+        newCenter = _mm_add_ps(newCenter, _mm_mul_ps(c1, _mm_shuffle_ps(center, center, _MM_SHUFFLE(1, 1, 1, 1))));
+        newCenter = _mm_add_ps(newCenter, _mm_mul_ps(c2, _mm_shuffle_ps(center, center, _MM_SHUFFLE(2, 2, 2, 2))));
+
+        __m128 newExtent = _mm_mul_ps(a0, _mm_shuffle_ps(extent, extent, _MM_SHUFFLE(0, 0, 0, 0)));
+        newExtent = _mm_add_ps(newExtent, _mm_mul_ps(a1, _mm_shuffle_ps(extent, extent, _MM_SHUFFLE(1, 1, 1, 1))));
+        newExtent = _mm_add_ps(newExtent, _mm_mul_ps(a2, _mm_shuffle_ps(extent, extent, _MM_SHUFFLE(2, 2, 2, 2))));
+
+        alignas(16) float newMin[4];
+        alignas(16) float newMax[4];
+        _mm_store_ps(newMin, _mm_sub_ps(newCenter, newExtent));
+        _mm_store_ps(newMax, _mm_add_ps(newCenter, newExtent));
+
+        output[i].mMin = QVector3D(newMin[0], newMin[1], newMin[2]);
+        output[i].mMax = QVector3D(newMax[0], newMax[1], newMax[2]);
+    }
+#else
+    for (int i = 0; i < count; ++i)
+    {
+        const QVector3D center = 0.5f * (input[i].mMin + input[i].mMax);
+        const QVector3D extent = 0.5f * (input[i].mMax - input[i].mMin);
 
-        if (max[0] < vertices[i].x())
-            max[0] = vertices[i].x();
+        float newCenter[3];
+        float newExtent[3];
 
-        if (max[1] < vertices[i].y())
-            max[1] = vertices[i].y();
+        for (int row = 0; row < 3; ++row)
+        {
+            newCenter[row] = m[12 + row] + m[row] * center.x() + m[4 + row] * center.y() + m[8 + row] * center.z();
+            newExtent[row] = qAbs(m[row]) * extent.x() + qAbs(m[4 + row]) * extent.y() + qAbs(m[8 + row]) * extent.z();
+        }
 
-        if (max[2] < vertices[i].z())
-            max[2] = vertices[i].z();
+        output[i].mMin = QVector3D(newCenter[0] - newExtent[0], newCenter[1] - newExtent[1], newCenter[2] - newExtent[2]);
+        output[i].mMax = QVector3D(newCenter[0] + newExtent[0], newCenter[1] + newExtent[1], newCenter[2] + newExtent[2]);
     }
+#endif
+}
 
-    AABB aabb;
-    aabb.SetMin(min);
-    aabb.SetMax(max);
-    return aabb;
+void Canavar::Engine::AABB::Merge(const AABB &other)
+{
+    mMin = QVector3D(qMin(mMin.x(), other.mMin.x()), qMin(mMin.y(), other.mMin.y()), qMin(mMin.z(), other.mMin.z()));
+    mMax = QVector3D(qMax(mMax.x(), other.mMax.x()), qMax(mMax.y(), other.mMax.y()), qMax(mMax.z(), other.mMax.z()));
 }
 
 void Canavar::Engine::AABB::ToJson(QJsonObject &object)
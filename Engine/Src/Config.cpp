@@ -9,6 +9,12 @@
 Canavar::Engine::Config::Config(QObject *parent)
     : QObject(parent)
     , mNodeSelectionEnabled(false)
+    , mCompactVertexFormat(false)
+    , mModelCacheFolder("Resources/ModelCache")
+    , mLazyModelLoading(false)
+    , mGPUMemoryBudget(0)
+    , mGeometryArenaEnabled(false)
+    , mMeshDataPolicy(MeshDataPolicy::Keep)
 {}
 
 Canavar::Engine::Config *Canavar::Engine::Config::Instance()
@@ -36,9 +42,35 @@ void Canavar::Engine::Config::Load(const QString &configFile)
     mModelsRootFolder = object.value("models_root_folder").toString(mModelsRootFolder);
     mNodeSelectionEnabled = object.value("node_selection_enabled").toBool();
     mWorldFilePath = object.value("world_file_path").toString();
+    mCompactVertexFormat = object.value("compact_vertex_format").toBool(false);
+    mModelCacheFolder = object.value("model_cache_folder").toString(mModelCacheFolder);
+    mLazyModelLoading = object.value("lazy_model_loading").toBool(false);
+    mGPUMemoryBudget = object.value("gpu_memory_budget_mb").toInt(0);
+    mGeometryArenaEnabled = object.value("geometry_arena").toBool(false);
+
+    const auto toPolicy = [](const QString& value) {
+        if (value == "release")
+            return MeshDataPolicy::Release;
+        else if (value == "positions")
+            return MeshDataPolicy::PositionsOnly;
+        else
+            return MeshDataPolicy::Keep;
+    };
+
+    mMeshDataPolicy = toPolicy(object.value("mesh_cpu_data").toString("keep"));
+
+    const auto policies = object.value("mesh_cpu_data_per_model").toObject();
+
+    for (auto it = policies.constBegin(); it != policies.constEnd(); ++it)
+        mMeshDataPolicies.insert(it.key(), toPolicy(it.value().toString()));
 
     auto formats = object.value("model_formats").toArray();
 
     for (const auto &format : formats)
         mSupportedModelFormats << format.toString();
 }
+
+Canavar::Engine::MeshDataPolicy Canavar::Engine::Config::GetMeshDataPolicy(const QString &modelName) const
+{
+    return mMeshDataPolicies.value(modelName, mMeshDataPolicy);
+}
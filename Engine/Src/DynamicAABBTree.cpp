@@ -0,0 +1,561 @@
+#include "DynamicAABBTree.h"
+#include "Frustum.h"
+
+#include <QDebug>
+#include <QVarLengthArray>
+
+#include <algorithm>
+
+namespace {
+    using Canavar::Engine::AABB;
+
+    AABB Union(const AABB& a, const AABB& b)
+    {
+        AABB result;
+        result.SetMin(QVector3D(qMin(a.GetMin().x(), b.GetMin().x()), qMin(a.GetMin().y(), b.GetMin().y()), qMin(a.GetMin().z(), b.GetMin().z())));
+        result.SetMax(QVector3D(qMax(a.GetMax().x(), b.GetMax().x()), qMax(a.GetMax().y(), b.GetMax().y()), qMax(a.GetMax().z(), b.GetMax().z())));
+        return result;
+    }
+
+    float SurfaceArea(const AABB& aabb)
+    {
+        const QVector3D d = aabb.GetMax() - aabb.GetMin();
+        return 2.0f * (d.x() * d.y() + d.y() * d.z() + d.z() * d.x());
+    }
+
+    bool Contains(const AABB& outer, const AABB& inner)
+    {
+        return outer.GetMin().x() <= inner.GetMin().x() && outer.GetMin().y() <= inner.GetMin().y() && outer.GetMin().z() <= inner.GetMin().z() && //
+               inner.GetMax().x() <= outer.GetMax().x() && inner.GetMax().y() <= outer.GetMax().y() && inner.GetMax().z() <= outer.GetMax().z();
+    }
+
+    bool Overlaps(const AABB& a, const AABB& b)
+    {
+        return a.GetMin().x() <= b.GetMax().x() && b.GetMin().x() <= a.GetMax().x() && //
+               a.GetMin().y() <= b.GetMax().y() && b.GetMin().y() <= a.GetMax().y() && //
+               a.GetMin().z() <= b.GetMax().z() && b.GetMin().z() <= a.GetMax().z();
+    }
+
+    bool OverlapsSphere(const AABB& aabb, const QVector3D& center, float radius)
+    {
+        float distanceSquared = 0.0f;
+
+        for (int i = 0; i < 3; ++i)
+        {
+            if (center[i] < aabb.GetMin()[i])
+                distanceSquared += (aabb.GetMin()[i] - center[i]) * (aabb.GetMin()[i] - center[i]);
+            else if (center[i] > aabb.GetMax()[i])
+                distanceSquared += (center[i] - aabb.GetMax()[i]) * (center[i] - aabb.GetMax()[i]);
+        }
+
+        return distanceSquared <= radius * radius;
+    }
+
+    // Slab test, returns the entry distance or a negative value on miss
+    float IntersectRay(const AABB& aabb, const QVector3D& origin, const QVector3D& direction, const QVector3D& inverseDirection, float maxDistance)
+    {
+        float tMin = 0.0f;
+        float tMax = maxDistance;
+
+        for (int i = 0; i < 3; ++i)
+        {
+            // Parallel to the slab, the products below would be NaN for an origin on one of its planes
+            if (direction[i] == 0.0f)
+            {
+                if (origin[i] < aabb.GetMin()[i] || origin[i] > aabb.GetMax()[i])
+                    return -1.0f;
+
+                continue;
+            }
+
+            float t1 = (aabb.GetMin()[i] - origin[i]) * inverseDirection[i];
+            float t2 = (aabb.GetMax()[i] - origin[i]) * inverseDirection[i];
+
+            tMin = qMax(tMin, qMin(t1, t2));
+            tMax = qMin(tMax, qMax(t1, t2));
+        }
+
+        return tMin <= tMax ? tMin : -1.0f;
+    }
+
+    using Stack = QVarLengthArray<int, 256>;
+} // namespace
+
+Canavar::Engine::DynamicAABBTree::DynamicAABBTree()
+    : mRoot(-1)
+    , mFreeList(-1)
+    , mNumberOfProxies(0)
+{}
+
+int Canavar::Engine::DynamicAABBTree::CreateProxy(const AABB& aabb, Node* node)
+{
+    int proxyID = AllocateNode();
+
+    mNodes[proxyID].aabb = aabb;
+    mNodes[proxyID].fatAABB = Fatten(aabb);
+    mNodes[proxyID].node = node;
+    mNodes[proxyID].height = 0;
+
+    InsertLeaf(proxyID);
+    mNumberOfProxies++;
+
+    return proxyID;
+}
+
+void Canavar::Engine::DynamicAABBTree::DestroyProxy(int proxyID)
+{
+    if (proxyID < 0 || proxyID >= mNodes.size() || !mNodes[proxyID].IsLeaf() || mNodes[proxyID].height != 0)
+    {
+        qWarning() << Q_FUNC_INFO << "Invalid proxy:" << proxyID;
+        return;
+    }
+
+    RemoveLeaf(proxyID);
+    FreeNode(proxyID);
+    mNumberOfProxies--;
+}
+
+bool Canavar::Engine::DynamicAABBTree::MoveProxy(int proxyID, const AABB& aabb)
+{
+    mNodes[proxyID].aabb = aabb;
+
+    if (Contains(mNodes[proxyID].fatAABB, aabb))
+        return false;
+
+    RemoveLeaf(proxyID);
+    mNodes[proxyID].fatAABB = Fatten(aabb);
+    InsertLeaf(proxyID);
+
+    return true;
+}
+
+Canavar::Engine::Node* Canavar::Engine::DynamicAABBTree::GetNode(int proxyID) const
+{
+    return mNodes[proxyID].node;
+}
+
+const Canavar::Engine::AABB& Canavar::Engine::DynamicAABBTree::GetFatAABB(int proxyID) const
+{
+    return mNodes[proxyID].fatAABB;
+}
+
+void Canavar::Engine::DynamicAABBTree::QueryFrustum(const Frustum& frustum, QList<Node*>& result) const
+{
+    if (mRoot == -1)
+        return;
+
+    Stack stack;
+    stack.append(mRoot);
+
+    while (!stack.isEmpty())
+    {
+        const TreeNode& treeNode = mNodes[stack.last()];
+        stack.removeLast();
+
+        if (treeNode.IsLeaf())
+        {
+            if (frustum.Intersects(treeNode.aabb))
+                result << treeNode.node;
+        }
+        else if (frustum.Intersects(treeNode.fatAABB))
+        {
+            stack.append(treeNode.child1);
+            stack.append(treeNode.child2);
+        }
+    }
+}
+
+void Canavar::Engine::DynamicAABBTree::QuerySphere(const QVector3D& center, float radius, QList<Node*>& result) const
+{
+    if (mRoot == -1)
+        return;
+
+    Stack stack;
+    stack.append(mRoot);
+
+    while (!stack.isEmpty())
+    {
+        const TreeNode& treeNode = mNodes[stack.last()];
+        stack.removeLast();
+
+        if (treeNode.IsLeaf())
+        {
+            if (OverlapsSphere(treeNode.aabb, center, radius))
+                result << treeNode.node;
+        }
+        else if (OverlapsSphere(treeNode.fatAABB, center, radius))
+        {
+            stack.append(treeNode.child1);
+            stack.append(treeNode.child2);
+        }
+    }
+}
+
+void Canavar::Engine::DynamicAABBTree::QueryBox(const AABB& aabb, QList<Node*>& result) const
+{
+    if (mRoot == -1)
+        return;
+
+    Stack stack;
+    stack.append(mRoot);
+
+    while (!stack.isEmpty())
+    {
+        const TreeNode& treeNode = mNodes[stack.last()];
+        stack.removeLast();
+
+        if (treeNode.IsLeaf())
+        {
+            if (Overlaps(treeNode.aabb, aabb))
+                result << treeNode.node;
+        }
+        else if (Overlaps(treeNode.fatAABB, aabb))
+        {
+            stack.append(treeNode.child1);
+            stack.append(treeNode.child2);
+        }
+    }
+}
+
+void Canavar::Engine::DynamicAABBTree::QueryRay(const QVector3D& origin, const QVector3D& direction, float maxDistance, QList<Node*>& result) const
+{
+    if (mRoot == -1)
+        return;
+
+    const QVector3D dir = direction.normalized();
+    const QVector3D inverseDirection(1.0f / dir.x(), 1.0f / dir.y(), 1.0f / dir.z());
+
+    QVector<QPair<float, Node*>> hits;
+
+    Stack stack;
+    stack.append(mRoot);
+
+    while (!stack.isEmpty())
+    {
+        const TreeNode& treeNode = mNodes[stack.last()];
+        stack.removeLast();
+
+        if (treeNode.IsLeaf())
+        {
+            float t = IntersectRay(treeNode.aabb, origin, dir, inverseDirection, maxDistance);
+
+            if (t >= 0.0f)
+                hits << qMakePair(t, treeNode.node);
+        }
+        else if (IntersectRay(treeNode.fatAABB, origin, dir, inverseDirection, maxDistance) >= 0.0f)
+        {
+            stack.append(treeNode.child1);
+            stack.append(treeNode.child2);
+        }
+    }
+
+    std::sort(hits.begin(), hits.end(), [](const QPair<float, Node*>& a, const QPair<float, Node*>& b) { return a.first < b.first; });
+
+    for (const auto& hit : hits)
+        result << hit.second;
+}
+
+int Canavar::Engine::DynamicAABBTree::GetHeight() const
+{
+    return mRoot == -1 ? 0 : mNodes[mRoot].height;
+}
+
+int Canavar::Engine::DynamicAABBTree::GetNumberOfProxies() const
+{
+    return mNumberOfProxies;
+}
+
+int Canavar::Engine::DynamicAABBTree::AllocateNode()
+{
+    int index;
+
+    if (mFreeList == -1)
+    {
+        index = mNodes.size();
+        mNodes.append(TreeNode());
+    }
+    else
+    {
+        index = mFreeList;
+        mFreeList = mNodes[index].parent;
+    }
+
+    TreeNode& treeNode = mNodes[index];
+    treeNode.node = nullptr;
+    treeNode.parent = -1;
+    treeNode.child1 = -1;
+    treeNode.child2 = -1;
+    treeNode.height = 0;
+
+    return index;
+}
+
+void Canavar::Engine::DynamicAABBTree::FreeNode(int index)
+{
+    mNodes[index].node = nullptr;
+    mNodes[index].parent = mFreeList;
+    mNodes[index].height = -1;
+    mFreeList = index;
+}
+
+void Canavar::Engine::DynamicAABBTree::InsertLeaf(int leaf)
+{
+    if (mRoot == -1)
+    {
+        mRoot = leaf;
+        mNodes[mRoot].parent = -1;
+        return;
+    }
+
+    // Find the best sibling using the surface area heuristic
+    const AABB leafAABB = mNodes[leaf].fatAABB;
+    int index = mRoot;
+
+    while (!mNodes[index].IsLeaf())
+    {
+        const TreeNode& treeNode = mNodes[index];
+
+        float area = SurfaceArea(treeNode.fatAABB);
+        float combinedArea = SurfaceArea(Union(treeNode.fatAABB, leafAABB));
+
+        // Cost of creating a new parent for this node and the new leaf
+        float cost = 2.0f * combinedArea;
+
+        // Minimum cost of pushing the leaf further down the tree
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        auto descendCost = [&](int child) {
+            const TreeNode& childNode = mNodes[child];
+            float unionArea = SurfaceArea(Union(leafAABB, childNode.fatAABB));
+
+            if (childNode.IsLeaf())
+                return unionArea + inheritanceCost;
+
+            return unionArea - SurfaceArea(childNode.fatAABB) + inheritanceCost;
+        };
+
+        float cost1 = descendCost(treeNode.child1);
+        float cost2 = descendCost(treeNode.child2);
+
+        if (cost < cost1 && cost < cost2)
+            break;
+
+        index = cost1 < cost2 ? treeNode.child1 : treeNode.child2;
+    }
+
+    const int sibling = index;
+
+    // Create a new parent
+    const int newParent = AllocateNode();
+    const int oldParent = mNodes[sibling].parent;
+
+    mNodes[newParent].parent = oldParent;
+    mNodes[newParent].fatAABB = Union(leafAABB, mNodes[sibling].fatAABB);
+    mNodes[newParent].height = mNodes[sibling].height + 1;
+    mNodes[newParent].child1 = sibling;
+    mNodes[newParent].child2 = leaf;
+    mNodes[sibling].parent = newParent;
+    mNodes[leaf].parent = newParent;
+
+    if (oldParent != -1)
+    {
+        if (mNodes[oldParent].child1 == sibling)
+            mNodes[oldParent].child1 = newParent;
+        else
+            mNodes[oldParent].child2 = newParent;
+    }
+    else
+    {
+        mRoot = newParent;
+    }
+
+    // Walk back up the tree fixing heights and bounds
+    index = mNodes[leaf].parent;
+
+    while (index != -1)
+    {
+        index = Balance(index);
+
+        const int child1 = mNodes[index].child1;
+        const int child2 = mNodes[index].child2;
+
+        mNodes[index].height = 1 + qMax(mNodes[child1].height, mNodes[child2].height);
+        mNodes[index].fatAABB = Union(mNodes[child1].fatAABB, mNodes[child2].fatAABB);
+
+        index = mNodes[index].parent;
+    }
+}
+
+void Canavar::Engine::DynamicAABBTree::RemoveLeaf(int leaf)
+{
+    if (leaf == mRoot)
+    {
+        mRoot = -1;
+        return;
+    }
+
+    const int parent = mNodes[leaf].parent;
+    const int grandParent = mNodes[parent].parent;
+    const int sibling = mNodes[parent].child1 == leaf ? mNodes[parent].child2 : mNodes[parent].child1;
+
+    if (grandParent != -1)
+    {
+        // Destroy the parent and connect the sibling to the grand parent
+        if (mNodes[grandParent].child1 == parent)
+            mNodes[grandParent].child1 = sibling;
+        else
+            mNodes[grandParent].child2 = sibling;
+
+        mNodes[sibling].parent = grandParent;
+        FreeNode(parent);
+
+        int index = grandParent;
+
+        while (index != -1)
+        {
+            index = Balance(index);
+
+            const int child1 = mNodes[index].child1;
+            const int child2 = mNodes[index].child2;
+
+            mNodes[index].fatAABB = Union(mNodes[child1].fatAABB, mNodes[child2].fatAABB);
+            mNodes[index].height = 1 + qMax(mNodes[child1].height, mNodes[child2].height);
+
+            index = mNodes[index].parent;
+        }
+    }
+    else
+    {
+        mRoot = sibling;
+        mNodes[sibling].parent = -1;
+        FreeNode(parent);
+    }
+}
+
+int Canavar::Engine::DynamicAABBTree::Balance(int iA)
+{
+    // Performs a left or right rotation if node A is imbalanced, returns the new root of the subtree
+    TreeNode& A = mNodes[iA];
+
+    if (A.IsLeaf() || A.height < 2)
+        return iA;
+
+    const int iB = A.child1;
+    const int iC = A.child2;
+
+    TreeNode& B = mNodes[iB];
+    TreeNode& C = mNodes[iC];
+
+    const int balance = C.height - B.height;
+
+    // Rotate C up
+    if (balance > 1)
+    {
+        const int iF = C.child1;
+        const int iG = C.child2;
+
+        TreeNode& F = mNodes[iF];
+        TreeNode& G = mNodes[iG];
+
+        C.child1 = iA;
+        C.parent = A.parent;
+        A.parent = iC;
+
+        if (C.parent != -1)
+        {
+            if (mNodes[C.parent].child1 == iA)
+                mNodes[C.parent].child1 = iC;
+            else
+                mNodes[C.parent].child2 = iC;
+        }
+        else
+        {
+            mRoot = iC;
+        }
+
+        if (F.height > G.height)
+        {
+            C.child2 = iF;
+            A.child2 = iG;
+            G.parent = iA;
+            A.fatAABB = Union(B.fatAABB, G.fatAABB);
+            C.fatAABB = Union(A.fatAABB, F.fatAABB);
+            A.height = 1 + qMax(B.height, G.height);
+            C.height = 1 + qMax(A.height, F.height);
+        }
+        else
+        {
+            C.child2 = iG;
+            A.child2 = iF;
+            F.parent = iA;
+            A.fatAABB = Union(B.fatAABB, F.fatAABB);
+            C.fatAABB = Union(A.fatAABB, G.fatAABB);
+            A.height = 1 + qMax(B.height, F.height);
+            C.height = 1 + qMax(A.height, G.height);
+        }
+
+        return iC;
+    }
+
+    // Rotate B up
+    if (balance < -1)
+    {
+        const int iD = B.child1;
+        const int iE = B.child2;
+
+        TreeNode& D = mNodes[iD];
+        TreeNode& E = mNodes[iE];
+
+        B.child1 = iA;
+        B.parent = A.parent;
+        A.parent = iB;
+
+        if (B.parent != -1)
+        {
+            if (mNodes[B.parent].child1 == iA)
+                mNodes[B.parent].child1 = iB;
+            else
+                mNodes[B.parent].child2 = iB;
+        }
+        else
+        {
+            mRoot = iB;
+        }
+
+        if (D.height > E.height)
+        {
+            B.child2 = iD;
+            A.child1 = iE;
+            E.parent = iA;
+            A.fatAABB = Union(C.fatAABB, E.fatAABB);
+            B.fatAABB = Union(A.fatAABB, D.fatAABB);
+            A.height = 1 + qMax(C.height, E.height);
+            B.height = 1 + qMax(A.height, D.height);
+        }
+        else
+        {
+            B.child2 = iE;
+            A.child1 = iD;
+            D.parent = iA;
+            A.fatAABB = Union(C.fatAABB, D.fatAABB);
+            B.fatAABB = Union(A.fatAABB, E.fatAABB);
+            A.height = 1 + qMax(C.height, D.height);
+            B.height = 1 + qMax(A.height, E.height);
+        }
+
+        return iB;
+    }
+
+    return iA;
+}
+
+Canavar::Engine::AABB Canavar::Engine::DynamicAABBTree::Fatten(const AABB& aabb) const
+{
+    // Grow by 10% of the extent plus a small constant for flat or degenerate bounds
+    const QVector3D margin = 0.1f * (aabb.GetMax() - aabb.GetMin()) + QVector3D(0.1f, 0.1f, 0.1f);
+
+    AABB result;
+    result.SetMin(aabb.GetMin() - margin);
+    result.SetMax(aabb.GetMax() + margin);
+    return result;
+}
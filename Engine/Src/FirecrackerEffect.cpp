@@ -1,4 +1,5 @@
 #include "FirecrackerEffect.h"
+#include "GPUMemoryTracker.h"
 
 #include "Helper.h"
 
@@ -18,6 +19,10 @@ Canavar::Engine::FirecrackerEffect::FirecrackerEffect()
     mShaderManager = ShaderManager::Instance();
     mCameraManager = CameraManager::Instance();
 
+    mMVPUniform = mShaderManager->GetUniformHandle("MVP");
+    mScaleUniform = mShaderManager->GetUniformHandle("scale");
+    mMaxLifeUniform = mShaderManager->GetUniformHandle("maxLife");
+
     mType = Node::NodeType::FirecrackerEffect;
     mName = "Firecracker Effect";
 }
@@ -41,12 +46,17 @@ void Canavar::Engine::FirecrackerEffect::Create()
     glBindBuffer(GL_ARRAY_BUFFER, mVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(Canavar::Engine::CUBE), Canavar::Engine::CUBE, GL_STATIC_DRAW);
 
+    // The name is assigned after Create(), the UUID is stable
+    const QString owner = "FirecrackerEffect: " + GetUUID();
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Buffer, mVBO, GPUMemoryTracker::Category::VertexBuffer, owner, sizeof(Canavar::Engine::CUBE));
+
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(QVector3D), (void*)0);
     glEnableVertexAttribArray(0);
 
     glGenBuffers(1, &mPBO);
     glBindBuffer(GL_ARRAY_BUFFER, mPBO);
     glBufferData(GL_ARRAY_BUFFER, mParticles.size() * sizeof(Particle), mParticles.constData(), GL_DYNAMIC_DRAW);
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Buffer, mPBO, GPUMemoryTracker::Category::VertexBuffer, owner, mParticles.size() * sizeof(Particle));
 
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)0);
     glEnableVertexAttribArray(1);
@@ -107,8 +117,12 @@ void Canavar::Engine::FirecrackerEffect::FromJson(const QJsonObject& object)
     mDamping = object["damping"].toDouble();
 }
 
-void Canavar::Engine::FirecrackerEffect::Render(float ifps)
+void Canavar::Engine::FirecrackerEffect::Update(float ifps)
 {
+    float inf = std::numeric_limits<float>::infinity();
+    QVector3D min(inf, inf, inf);
+    QVector3D max(-inf, -inf, -inf);
+
     for (int i = 0; i < mParticles.size(); i++)
     {
         if (!mLoop && mParticles[i].dead)
@@ -127,12 +141,27 @@ void Canavar::Engine::FirecrackerEffect::Render(float ifps)
             else
                 mParticles[i].dead = true;
         }
+
+        const auto& position = mParticles[i].position;
+        min = QVector3D(qMin(min.x(), position.x()), qMin(min.y(), position.y()), qMin(min.z(), position.z()));
+        max = QVector3D(qMax(max.x(), position.x()), qMax(max.y(), position.y()), qMax(max.z(), position.z()));
     }
 
+    // Used for culling, pad by the particle size. Keep the last bounds once every particle is dead.
+    if (min.x() <= max.x())
+    {
+        mAABB.SetMin(min - QVector3D(mScale, mScale, mScale));
+        mAABB.SetMax(max + QVector3D(mScale, mScale, mScale));
+        MarkBoundsDirty();
+    }
+}
+
+void Canavar::Engine::FirecrackerEffect::Render()
+{
     mShaderManager->Bind(ShaderType::FirecrackerEffectShader);
-    mShaderManager->SetUniformValue("MVP", mCameraManager->GetActiveCamera()->GetViewProjectionMatrix() * WorldTransformation());
-    mShaderManager->SetUniformValue("scale", mScale);
-    mShaderManager->SetUniformValue("maxLife", mMaxLife);
+    mShaderManager->SetUniformValue(mMVPUniform, mCameraManager->GetActiveCamera()->GetViewProjectionMatrix() * WorldTransformation());
+    mShaderManager->SetUniformValue(mScaleUniform, mScale);
+    mShaderManager->SetUniformValue(mMaxLifeUniform, mMaxLife);
 
     glBindVertexArray(mVAO);
     glBindBuffer(GL_ARRAY_BUFFER, mPBO);
@@ -0,0 +1,57 @@
+#include "Frustum.h"
+
+Canavar::Engine::Frustum::Frustum() {}
+
+void Canavar::Engine::Frustum::Update(const QMatrix4x4& viewProjection)
+{
+    const QVector4D r0 = viewProjection.row(0);
+    const QVector4D r1 = viewProjection.row(1);
+    const QVector4D r2 = viewProjection.row(2);
+    const QVector4D r3 = viewProjection.row(3);
+
+    mPlanes[Left] = r3 + r0;
+    mPlanes[Right] = r3 - r0;
+    mPlanes[Bottom] = r3 + r1;
+    mPlanes[Top] = r3 - r1;
+    mPlanes[Near] = r3 + r2;
+    mPlanes[Far] = r3 - r2;
+
+    for (int i = 0; i < NumberOfPlanes; ++i)
+    {
+        float length = mPlanes[i].toVector3D().length();
+
+        if (length > 0.0f)
+            mPlanes[i] /= length;
+    }
+}
+
+bool Canavar::Engine::Frustum::Intersects(const AABB& worldAABB) const
+{
+    const QVector3D& min = worldAABB.GetMin();
+    const QVector3D& max = worldAABB.GetMax();
+
+    for (int i = 0; i < NumberOfPlanes; ++i)
+    {
+        const QVector4D& plane = mPlanes[i];
+
+        // The corner furthest along the plane normal
+        float x = plane.x() >= 0.0f ? max.x() : min.x();
+        float y = plane.y() >= 0.0f ? max.y() : min.y();
+        float z = plane.z() >= 0.0f ? max.z() : min.z();
+
+        if (plane.x() * x + plane.y() * y + plane.z() * z + plane.w() < 0.0f)
+            return false;
+    }
+
+    return true;
+}
+
+bool Canavar::Engine::Frustum::Intersects(const AABB& localAABB, const QMatrix4x4& transformation) const
+{
+    return Intersects(localAABB.Transform(transformation));
+}
+
+const QVector4D& Canavar::Engine::Frustum::GetPlane(Plane plane) const
+{
+    return mPlanes[plane];
+}
@@ -0,0 +1,191 @@
+#include "GPUCulling.h"
+#include "Frustum.h"
+#include "GPUMemoryTracker.h"
+#include "GeometryArena.h"
+#include "Mesh.h"
+#include "OcclusionCulling.h"
+#include "RenderQueue.h"
+#include "ShaderManager.h"
+
+#include <algorithm>
+
+Canavar::Engine::GPUCulling::GPUCulling()
+    : mShaderManager(nullptr)
+    , mCullCommandBuffer(0)
+    , mCandidateBuffer(0)
+    , mValidationEnabled(false)
+    , mNumberOfTestedInstances(0)
+    , mNumberOfVisibleInstances(0)
+    , mNumberOfMismatches(0)
+{}
+
+void Canavar::Engine::GPUCulling::Init()
+{
+    initializeOpenGLFunctions();
+
+    mShaderManager = ShaderManager::Instance();
+
+    for (int i = 0; i < 6; ++i)
+        mPlaneUniforms[i] = mShaderManager->GetUniformHandle(QString("planes[%1]").arg(i));
+
+    mOcclusionCullingUniform = mShaderManager->GetUniformHandle("occlusionCulling");
+    mPyramidUniform = mShaderManager->GetUniformHandle("pyramid");
+    mPyramidViewProjectionUniform = mShaderManager->GetUniformHandle("pyramidViewProjection");
+
+    glGenBuffers(1, &mCullCommandBuffer);
+    glGenBuffers(1, &mCandidateBuffer);
+}
+
+void Canavar::Engine::GPUCulling::Cull(const Frustum& frustum, RenderQueue& queue, GLuint instanceBuffer, int instanceStride, const QVector<GLuint>& candidates, const OcclusionCulling* occlusionCulling)
+{
+    static_assert(sizeof(CullCommand) == 48, "CullCommand must match the std430 layout in GPUCulling.comp");
+
+    const auto& commands = queue.GetIndirectCommands();
+    const auto& meshes = queue.GetIndirectMeshes();
+
+    mNumberOfTestedInstances = 0;
+    mNumberOfVisibleInstances = 0;
+    mNumberOfMismatches = 0;
+
+    if (commands.isEmpty())
+        return;
+
+    // Per command, not per instance, the CPU cost does not grow with the number of instances
+    mCullCommands.resize(commands.size());
+
+    for (int i = 0; i < commands.size(); ++i)
+    {
+        const AABB& aabb = meshes[i]->GetAABB();
+
+        CullCommand& cullCommand = mCullCommands[i];
+        cullCommand.center = QVector4D(aabb.GetCenter(), 0.0f);
+        cullCommand.extent = QVector4D((aabb.GetMax() - aabb.GetMin()) * 0.5f, 0.0f);
+        cullCommand.firstInstance = commands[i].baseInstance;
+        cullCommand.numberOfInstances = commands[i].instanceCount;
+
+        mNumberOfTestedInstances += commands[i].instanceCount;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mCullCommandBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, mCullCommands.size() * sizeof(CullCommand), mCullCommands.constData(), GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Buffer, mCullCommandBuffer, GPUMemoryTracker::Category::StorageBuffer, "Pass: GPU Culling", mCullCommands.size() * sizeof(CullCommand));
+
+    // One index per candidate, the instance data itself is not uploaded here
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mCandidateBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, candidates.size() * sizeof(GLuint), candidates.constData(), GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Buffer, mCandidateBuffer, GPUMemoryTracker::Category::StorageBuffer, "Pass: GPU Culling", candidates.size() * sizeof(GLuint));
+
+    auto arena = GeometryArena::Instance();
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instanceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, queue.GetIndirectBuffer());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, mCullCommandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, arena->GetInstanceIndexBuffer());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, mCandidateBuffer);
+
+    mShaderManager->Bind(ShaderType::GPUCullingShader);
+
+    for (int i = 0; i < 6; ++i)
+        mShaderManager->SetUniformValue(mPlaneUniforms[i], frustum.GetPlane(Frustum::Plane(i)));
+
+    const bool occlusion = occlusionCulling && occlusionCulling->IsPyramidValid();
+
+    mShaderManager->SetUniformValue(mOcclusionCullingUniform, occlusion);
+
+    if (occlusion)
+    {
+        mShaderManager->SetSampler(mPyramidUniform, 0, occlusionCulling->GetPyramidTexture());
+        mShaderManager->SetUniformValue(mPyramidViewProjectionUniform, occlusionCulling->GetPyramidViewProjection());
+    }
+
+    // One work group per command, GL guarantees at least 65535 of them per dimension
+    glDispatchCompute(qMin(commands.size(), 65535), 1, 1);
+
+    mShaderManager->Release();
+
+    if (commands.size() > 65535)
+        qWarning() << Q_FUNC_INFO << "Too many indirect commands," << commands.size() - 65535 << "of them are not culled.";
+
+    // The commands are read by the draw calls, the indices by the instanceIndex attribute
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    for (int binding = 1; binding <= 4; ++binding)
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0);
+
+    arena->InvalidateInstanceIndices();
+
+    if (mValidationEnabled)
+        Validate(frustum, queue, instanceBuffer, instanceStride, candidates, occlusion);
+}
+
+void Canavar::Engine::GPUCulling::Validate(const Frustum& frustum, RenderQueue& queue, GLuint instanceBuffer, int instanceStride, const QVector<GLuint>& candidates, bool occlusion)
+{
+    const auto& commands = queue.GetIndirectCommands();
+    const auto& meshes = queue.GetIndirectMeshes();
+
+    int numberOfIndices = 0;
+    int numberOfInstances = 0;
+
+    for (const auto& command : commands)
+        numberOfIndices = qMax(numberOfIndices, int(command.baseInstance + command.instanceCount));
+
+    for (const auto& candidate : candidates)
+        numberOfInstances = qMax(numberOfInstances, int(candidate) + 1);
+
+    QVector<RenderQueue::DrawElementsIndirectCommand> results(commands.size());
+    QVector<GLuint> indices(numberOfIndices);
+
+    const auto read = [this](GLuint buffer, qint64 size, void* destination) {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+
+        if (const auto data = glMapBufferRange(GL_COPY_READ_BUFFER, 0, size, GL_MAP_READ_BIT))
+        {
+            memcpy(destination, data, size);
+            glUnmapBuffer(GL_COPY_READ_BUFFER);
+        }
+
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    };
+
+    read(queue.GetIndirectBuffer(), results.size() * sizeof(RenderQueue::DrawElementsIndirectCommand), results.data());
+    read(GeometryArena::Instance()->GetInstanceIndexBuffer(), indices.size() * sizeof(GLuint), indices.data());
+
+    QVector<char> instances(qint64(numberOfInstances) * instanceStride);
+    read(instanceBuffer, instances.size(), instances.data());
+
+    for (int i = 0; i < commands.size() && i < 65535; ++i)
+    {
+        const auto& command = commands[i];
+
+        // Expected by the CPU test, in any order
+        QVector<GLuint> expected;
+
+        for (GLuint j = 0; j < command.instanceCount; ++j)
+        {
+            const GLuint instance = candidates[command.baseInstance + j];
+
+            // M is the first member of Instance, column-major
+            const auto M = reinterpret_cast<const float*>(instances.constData() + qint64(instance) * instanceStride);
+
+            if (frustum.Intersects(meshes[i]->GetAABB(), QMatrix4x4(M).transposed()))
+                expected << instance;
+        }
+
+        QVector<GLuint> actual(indices.constBegin() + command.baseInstance, indices.constBegin() + command.baseInstance + qMin(results[i].instanceCount, command.instanceCount));
+
+        std::sort(expected.begin(), expected.end());
+        std::sort(actual.begin(), actual.end());
+
+        mNumberOfVisibleInstances += actual.size();
+
+        const bool valid = occlusion ? std::includes(expected.begin(), expected.end(), actual.begin(), actual.end()) : actual == expected;
+
+        if (!valid || results[i].instanceCount > command.instanceCount)
+        {
+            mNumberOfMismatches++;
+            qWarning() << Q_FUNC_INFO << "Mesh" << meshes[i]->GetName() << "GPU visible instances:" << actual.size() << "CPU visible instances:" << expected.size();
+        }
+    }
+}
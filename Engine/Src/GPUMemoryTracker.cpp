@@ -0,0 +1,189 @@
+#include "GPUMemoryTracker.h"
+#include "Helper.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+
+Canavar::Engine::GPUMemoryTracker::GPUMemoryTracker()
+    : mTotalBytes(0)
+{}
+
+Canavar::Engine::GPUMemoryTracker* Canavar::Engine::GPUMemoryTracker::Instance()
+{
+    static GPUMemoryTracker instance;
+
+    return &instance;
+}
+
+void Canavar::Engine::GPUMemoryTracker::Allocate(Resource resource, GLuint id, Category category, const QString& owner, qint64 bytes)
+{
+    if (id == 0)
+        return;
+
+    const quint64 key = MakeKey(resource, id);
+
+    if (auto it = mAllocations.constFind(key); it != mAllocations.constEnd())
+        Remove(it.value());
+
+    mAllocations.insert(key, Allocation{ category, owner, bytes });
+
+    mBytesByCategory[category] += bytes;
+    mBytesByOwner[owner] += bytes;
+    mTotalBytes += bytes;
+}
+
+void Canavar::Engine::GPUMemoryTracker::Free(Resource resource, GLuint id)
+{
+    auto it = mAllocations.find(MakeKey(resource, id));
+
+    if (it == mAllocations.end())
+        return;
+
+    Remove(it.value());
+    mAllocations.erase(it);
+}
+
+void Canavar::Engine::GPUMemoryTracker::Remove(const Allocation& allocation)
+{
+    mBytesByCategory[allocation.category] -= allocation.bytes;
+    mBytesByOwner[allocation.owner] -= allocation.bytes;
+    mTotalBytes -= allocation.bytes;
+
+    if (mBytesByOwner[allocation.owner] == 0)
+        mBytesByOwner.remove(allocation.owner);
+}
+
+qint64 Canavar::Engine::GPUMemoryTracker::GetTotalBytes() const
+{
+    return mTotalBytes;
+}
+
+const QMap<Canavar::Engine::GPUMemoryTracker::Category, qint64>& Canavar::Engine::GPUMemoryTracker::GetBytesByCategory() const
+{
+    return mBytesByCategory;
+}
+
+const QMap<QString, qint64>& Canavar::Engine::GPUMemoryTracker::GetBytesByOwner() const
+{
+    return mBytesByOwner;
+}
+
+int Canavar::Engine::GPUMemoryTracker::GetNumberOfAllocations() const
+{
+    return mAllocations.size();
+}
+
+QJsonObject Canavar::Engine::GPUMemoryTracker::ToJson() const
+{
+    QJsonObject object;
+    object.insert("total_bytes", mTotalBytes);
+    object.insert("number_of_allocations", mAllocations.size());
+
+    QJsonObject categories;
+
+    for (auto it = mBytesByCategory.constBegin(); it != mBytesByCategory.constEnd(); ++it)
+        categories.insert(ToString(it.key()), it.value());
+
+    object.insert("categories", categories);
+
+    // Owner -> category -> bytes
+    QMap<QString, QMap<Category, qint64>> breakdown;
+
+    for (const auto& allocation : mAllocations)
+        breakdown[allocation.owner][allocation.category] += allocation.bytes;
+
+    QJsonArray owners;
+
+    for (auto it = breakdown.constBegin(); it != breakdown.constEnd(); ++it)
+    {
+        QJsonObject owner;
+        owner.insert("owner", it.key());
+        owner.insert("total_bytes", mBytesByOwner.value(it.key()));
+
+        QJsonObject ownerCategories;
+
+        for (auto jt = it.value().constBegin(); jt != it.value().constEnd(); ++jt)
+            ownerCategories.insert(ToString(jt.key()), jt.value());
+
+        owner.insert("categories", ownerCategories);
+        owners.append(owner);
+    }
+
+    object.insert("owners", owners);
+
+    return object;
+}
+
+bool Canavar::Engine::GPUMemoryTracker::Dump(const QString& path) const
+{
+    return Helper::WriteTextToFile(path, QJsonDocument(ToJson()).toJson(QJsonDocument::Indented));
+}
+
+QString Canavar::Engine::GPUMemoryTracker::ToString(Category category)
+{
+    switch (category)
+    {
+    case Category::VertexBuffer:
+        return "Vertex Buffer";
+    case Category::IndexBuffer:
+        return "Index Buffer";
+    case Category::UniformBuffer:
+        return "Uniform Buffer";
+    case Category::StorageBuffer:
+        return "Storage Buffer";
+    case Category::Texture:
+        return "Texture";
+    case Category::RenderTarget:
+        return "Render Target";
+    default:
+        return "Unknown";
+    }
+}
+
+int Canavar::Engine::GPUMemoryTracker::GetBytesPerPixel(GLenum internalFormat)
+{
+    switch (internalFormat)
+    {
+    case GL_RGBA32F:
+    case GL_RGBA32I:
+    case GL_RGBA32UI:
+        return 16;
+    case GL_RGB32F:
+        return 12;
+    case GL_RGBA16F:
+    case GL_RG32F:
+        return 8;
+    case GL_R8:
+        return 1;
+    default: // GL_RGBA8, GL_R32F, GL_DEPTH24_STENCIL8, ...
+        return 4;
+    }
+}
+
+qint64 Canavar::Engine::GPUMemoryTracker::CalculateTextureSize(QOpenGLTexture* texture)
+{
+    const qint64 size = qint64(texture->width()) * texture->height() * GetBytesPerPixel(GLenum(texture->format()));
+
+    // A full mip chain adds a third
+    return texture->mipLevels() > 1 ? size * 4 / 3 : size;
+}
+
+qint64 Canavar::Engine::GPUMemoryTracker::CalculateFramebufferSize(QOpenGLFramebufferObject* framebuffer)
+{
+    const auto format = framebuffer->format();
+    const qint64 samples = qMax(1, format.samples());
+    const qint64 pixels = qint64(framebuffer->width()) * framebuffer->height() * samples;
+
+    // Additional color attachments are assumed to have the same format
+    qint64 size = framebuffer->sizes().size() * pixels * GetBytesPerPixel(format.internalTextureFormat());
+
+    if (format.attachment() != QOpenGLFramebufferObject::NoAttachment)
+        size += pixels * GetBytesPerPixel(GL_DEPTH24_STENCIL8);
+
+    return size;
+}
+
+quint64 Canavar::Engine::GPUMemoryTracker::MakeKey(Resource resource, GLuint id)
+{
+    return (quint64(resource) << 32) | id;
+}
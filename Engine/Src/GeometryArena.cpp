@@ -0,0 +1,245 @@
+#include "GeometryArena.h"
+#include "GPUMemoryTracker.h"
+#include "Mesh.h"
+
+#include <iterator>
+
+namespace {
+    // First fit, returns -1 if no free range is large enough
+    qint64 TakeRange(QMap<qint64, qint64>& freeRanges, qint64 count)
+    {
+        for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+        {
+            if (it.value() < count)
+                continue;
+
+            const qint64 offset = it.key();
+            const qint64 remaining = it.value() - count;
+
+            freeRanges.erase(it);
+
+            if (remaining > 0)
+                freeRanges.insert(offset + count, remaining);
+
+            return offset;
+        }
+
+        return -1;
+    }
+
+    // Merges the range with its free neighbours
+    void ReturnRange(QMap<qint64, qint64>& freeRanges, qint64 offset, qint64 count)
+    {
+        auto next = freeRanges.lowerBound(offset);
+
+        if (next != freeRanges.end() && offset + count == next.key())
+        {
+            count += next.value();
+            next = freeRanges.erase(next);
+        }
+
+        if (next != freeRanges.begin())
+        {
+            auto previous = std::prev(next);
+
+            if (previous.key() + previous.value() == offset)
+            {
+                previous.value() += count;
+                return;
+            }
+        }
+
+        freeRanges.insert(offset, count);
+    }
+} // namespace
+
+Canavar::Engine::GeometryArena::GeometryArena()
+    : mInstanceIndexBuffer(0)
+    , mInstanceCapacity(0)
+    , mInstanceIndicesDirty(false)
+    , mInitialized(false)
+{}
+
+Canavar::Engine::GeometryArena* Canavar::Engine::GeometryArena::Instance()
+{
+    static GeometryArena instance;
+    return &instance;
+}
+
+void Canavar::Engine::GeometryArena::Init()
+{
+    initializeOpenGLFunctions();
+
+    glGenBuffers(1, &mInstanceIndexBuffer);
+    mInitialized = true;
+
+    ReserveInstances(4096);
+}
+
+bool Canavar::Engine::GeometryArena::Allocate(bool compact, const void* vertices, int numberOfVertices, const unsigned int* indices, int numberOfIndices, Allocation& allocation)
+{
+    if (!mInitialized)
+        Init();
+
+    if (numberOfVertices == 0 || numberOfIndices == 0)
+        return false;
+
+    const qint64 stride = compact ? sizeof(Mesh::CompactVertex) : sizeof(Mesh::Vertex);
+
+    int page = -1;
+    qint64 baseVertex = -1;
+    qint64 firstIndex = -1;
+
+    for (int i = 0; i < mPages.size() && page == -1; ++i)
+    {
+        if (mPages[i].compact != compact)
+            continue;
+
+        baseVertex = TakeRange(mPages[i].freeVertices, numberOfVertices);
+
+        if (baseVertex == -1)
+            continue;
+
+        firstIndex = TakeRange(mPages[i].freeIndices, numberOfIndices);
+
+        if (firstIndex == -1)
+        {
+            ReturnRange(mPages[i].freeVertices, baseVertex, numberOfVertices);
+            continue;
+        }
+
+        page = i;
+    }
+
+    if (page == -1)
+    {
+        // Meshes larger than a page get a page of their own
+        page = CreatePage(compact, qMax(VERTEX_PAGE_SIZE / stride, qint64(numberOfVertices)), qMax(INDEX_PAGE_SIZE / qint64(sizeof(unsigned int)), qint64(numberOfIndices)));
+        baseVertex = TakeRange(mPages[page].freeVertices, numberOfVertices);
+        firstIndex = TakeRange(mPages[page].freeIndices, numberOfIndices);
+    }
+
+    // Copy targets leave the VAO and array buffer bindings alone
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mPages[page].vbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, baseVertex * stride, numberOfVertices * stride, vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mPages[page].ebo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, firstIndex * sizeof(unsigned int), numberOfIndices * sizeof(unsigned int), indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    allocation.page = page;
+    allocation.baseVertex = int(baseVertex);
+    allocation.firstIndex = int(firstIndex);
+    allocation.numberOfVertices = numberOfVertices;
+    allocation.numberOfIndices = numberOfIndices;
+
+    return true;
+}
+
+void Canavar::Engine::GeometryArena::Free(const Allocation& allocation)
+{
+    if (allocation.page < 0 || allocation.page >= mPages.size())
+        return;
+
+    Page& page = mPages[allocation.page];
+    ReturnRange(page.freeVertices, allocation.baseVertex, allocation.numberOfVertices);
+    ReturnRange(page.freeIndices, allocation.firstIndex, allocation.numberOfIndices);
+}
+
+void Canavar::Engine::GeometryArena::ReserveInstances(int count, bool identity)
+{
+    if (!mInitialized || (count <= mInstanceCapacity && (!identity || !mInstanceIndicesDirty)))
+        return;
+
+    int capacity = qMax(mInstanceCapacity, 1);
+
+    while (capacity < count)
+        capacity *= 2;
+
+    QVector<GLuint> indices(capacity);
+
+    for (int i = 0; i < capacity; ++i)
+        indices[i] = i;
+
+    // Page VAOs refer to the buffer name, respecifying its storage keeps them valid
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mInstanceIndexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, capacity * sizeof(GLuint), indices.constData(), GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Buffer, mInstanceIndexBuffer, GPUMemoryTracker::Category::VertexBuffer, "GeometryArena", capacity * sizeof(GLuint));
+
+    mInstanceCapacity = capacity;
+    mInstanceIndicesDirty = false;
+}
+
+GLuint Canavar::Engine::GeometryArena::GetInstanceIndexBuffer() const
+{
+    return mInstanceIndexBuffer;
+}
+
+void Canavar::Engine::GeometryArena::InvalidateInstanceIndices()
+{
+    mInstanceIndicesDirty = true;
+}
+
+int Canavar::Engine::GeometryArena::CreatePage(bool compact, qint64 numberOfVertices, qint64 numberOfIndices)
+{
+    auto tracker = GPUMemoryTracker::Instance();
+    const qint64 stride = compact ? sizeof(Mesh::CompactVertex) : sizeof(Mesh::Vertex);
+
+    Page page;
+    page.compact = compact;
+    page.freeVertices.insert(0, numberOfVertices);
+    page.freeIndices.insert(0, numberOfIndices);
+
+    glGenVertexArrays(1, &page.vao);
+    glBindVertexArray(page.vao);
+
+    glGenBuffers(1, &page.ebo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page.ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, numberOfIndices * sizeof(unsigned int), nullptr, GL_STATIC_DRAW);
+    tracker->Allocate(GPUMemoryTracker::Resource::Buffer, page.ebo, GPUMemoryTracker::Category::IndexBuffer, "GeometryArena", numberOfIndices * sizeof(unsigned int));
+
+    glGenBuffers(1, &page.vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, page.vbo);
+    glBufferData(GL_ARRAY_BUFFER, numberOfVertices * stride, nullptr, GL_STATIC_DRAW);
+    tracker->Allocate(GPUMemoryTracker::Resource::Buffer, page.vbo, GPUMemoryTracker::Category::VertexBuffer, "GeometryArena", numberOfVertices * stride);
+
+    Mesh::SetVertexAttributes(this, compact, 0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, mInstanceIndexBuffer);
+    glVertexAttribIPointer(INSTANCE_INDEX_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+    glEnableVertexAttribArray(INSTANCE_INDEX_LOCATION);
+    glVertexAttribDivisor(INSTANCE_INDEX_LOCATION, 1);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    mPages << page;
+
+    return mPages.size() - 1;
+}
+
+int Canavar::Engine::GeometryArena::GetNumberOfPages() const
+{
+    return mPages.size();
+}
+
+GLuint Canavar::Engine::GeometryArena::GetVAO(int page) const
+{
+    return mPages[page].vao;
+}
+
+GLuint Canavar::Engine::GeometryArena::GetVertexBuffer(int page) const
+{
+    return mPages[page].vbo;
+}
+
+GLuint Canavar::Engine::GeometryArena::GetIndexBuffer(int page) const
+{
+    return mPages[page].ebo;
+}
+
+bool Canavar::Engine::GeometryArena::IsCompact(int page) const
+{
+    return mPages[page].compact;
+}
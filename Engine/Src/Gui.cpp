@@ -1,14 +1,18 @@
 #include "Gui.h"
 #include "Config.h"
+#include "GPUMemoryTracker.h"
+#include "GeometryArena.h"
 #include "Haze.h"
 #include "Helper.h"
 #include "IntersectionManager.h"
 #include "ModelDataManager.h"
 #include "RendererManager.h"
 #include "SelectableNodeRenderer.h"
+#include "ShaderManager.h"
 
 #include <QFileDialog>
 #include <QJsonDocument>
+#include <QMultiMap>
 
 Canavar::Engine::Gui::Gui(QObject* parent)
     : QObject(parent)
@@ -110,11 +114,119 @@ void Canavar::Engine::Gui::Draw()
         ImGui::SliderFloat("Exposure##RenderSettings", &RendererManager::Instance()->GetExposure_NonConst(), 0.01f, 2.0f, "%.3f");
         ImGui::SliderFloat("Gamma##RenderSettings", &RendererManager::Instance()->GetGamma_NonConst(), 0.01f, 4.0f, "%.3f");
         ImGui::SliderInt("Bloom Blur Pass##RenderSettings", &RendererManager::Instance()->GetBlurPass_NonConst(), 0, 100);
+        ImGui::Checkbox("Frustum Culling##RenderSettings", &RendererManager::Instance()->GetFrustumCullingEnabled_NonConst());
+        ImGui::Text("Drawn: %d, Culled: %d", RendererManager::Instance()->GetNumberOfDrawnNodes(), RendererManager::Instance()->GetNumberOfCulledNodes());
+        ImGui::Text("AABB Tree: %d nodes, height %d", NodeManager::Instance()->GetTree().GetNumberOfProxies(), NodeManager::Instance()->GetTree().GetHeight());
+        ImGui::Checkbox("Instancing##RenderSettings", &RendererManager::Instance()->GetInstancingEnabled_NonConst());
+        ImGui::Text("Instanced draw calls: %d", RendererManager::Instance()->GetNumberOfInstancedDrawCalls());
+
+        if (Config::Instance()->GetGeometryArenaEnabled())
+        {
+            ImGui::Checkbox("Indirect Drawing##RenderSettings", &RendererManager::Instance()->GetIndirectDrawingEnabled_NonConst());
+            ImGui::Text("Indirect commands: %d, Arena pages: %d", RendererManager::Instance()->GetRenderQueue().GetNumberOfIndirectCommands(), GeometryArena::Instance()->GetNumberOfPages());
+
+            auto& culling = RendererManager::Instance()->GetGPUCulling();
+            ImGui::Checkbox("GPU Culling##RenderSettings", &RendererManager::Instance()->GetGPUCullingEnabled_NonConst());
+
+            if (RendererManager::Instance()->IsGPUCullingActive())
+            {
+                ImGui::Checkbox("Validate GPU Culling##RenderSettings", &culling.GetValidationEnabled_NonConst());
+                ImGui::Text("GPU tested instances: %d", culling.GetNumberOfTestedInstances());
+
+                if (culling.GetValidationEnabled())
+                    ImGui::Text("GPU visible instances: %d, Mismatches: %d", culling.GetNumberOfVisibleInstances(), culling.GetNumberOfMismatches());
+            }
+        }
+
+        auto& occlusion = RendererManager::Instance()->GetOcclusionCulling();
+        ImGui::Checkbox("Occlusion Culling##RenderSettings", &RendererManager::Instance()->GetOcclusionCullingEnabled_NonConst());
+
+        if (RendererManager::Instance()->GetOcclusionCullingEnabled())
+        {
+            ImGui::Text("Occlusion tested: %d, Occluded: %d", RendererManager::Instance()->GetNumberOfOcclusionTestedNodes(), RendererManager::Instance()->GetNumberOfOccludedNodes());
+            ImGui::SliderInt("Hi-Z Debug Level##RenderSettings", &occlusion.GetDebugLevel_NonConst(), -1, occlusion.GetNumberOfLevels() - 1);
+        }
+
+        ImGui::Checkbox("Level of Detail##RenderSettings", &RendererManager::Instance()->GetLodEnabled_NonConst());
+        ImGui::SliderFloat("LOD Pixel Error##RenderSettings", &RendererManager::Instance()->GetLodPixelError_NonConst(), 0.25f, 16.0f, "%.2f");
+
+        QStringList lodCounts;
+
+        for (auto count : RendererManager::Instance()->GetNumberOfModelsPerLod())
+            lodCounts << QString::number(count);
+
+        ImGui::Text("Models per LOD: %s", lodCounts.join(" / ").toStdString().c_str());
+
+        auto& impostors = RendererManager::Instance()->GetImpostorRenderer();
+        ImGui::Checkbox("Impostors##RenderSettings", &RendererManager::Instance()->GetImpostorsEnabled_NonConst());
+
+        if (RendererManager::Instance()->GetImpostorsEnabled())
+        {
+            ImGui::SliderFloat("Impostor Distance##RenderSettings", &RendererManager::Instance()->GetImpostorDistance_NonConst(), 100.0f, 20000.0f, "%.0f");
+            ImGui::Text("Impostors: %d, Atlases: %d", impostors.GetNumberOfImpostors(), impostors.GetNumberOfAtlases());
+        }
+
+        ImGui::Checkbox("Sorted Render Queue##RenderSettings", &RendererManager::Instance()->GetRenderQueue().GetSortingEnabled_NonConst());
+        ImGui::Text("Draw calls: %d, Shader switches: %d", RendererManager::Instance()->GetRenderQueue().GetNumberOfDrawCalls(), RendererManager::Instance()->GetRenderQueue().GetNumberOfShaderSwitches());
+        ImGui::Text("Texture binds: %d, VAO binds: %d", RendererManager::Instance()->GetRenderQueue().GetNumberOfTextureBinds(), RendererManager::Instance()->GetRenderQueue().GetNumberOfVAOBinds());
+        ImGui::Text("Uniform lookups by name: %d", ShaderManager::Instance()->GetNumberOfUniformLookups());
+        ImGui::Text("Resident models: %d / %d", ModelDataManager::Instance()->GetNumberOfResidentModels(), int(ModelDataManager::Instance()->GetModelNames().size()));
+        ImGui::Text("Model GPU memory: %.1f / %.1f MB",
+                    ModelDataManager::Instance()->GetResidentGPUMemory() / (1024.0f * 1024.0f),
+                    ModelDataManager::Instance()->GetGPUMemoryBudget() / (1024.0f * 1024.0f));
+        ImGui::Text("Evictions: %d, Reloads: %d", ModelDataManager::Instance()->GetNumberOfEvictions(), ModelDataManager::Instance()->GetNumberOfReloads());
 
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
         ImGui::End();
     }
 
+    // GPU Memory
+    {
+        constexpr float MB = 1024.0f * 1024.0f;
+        auto tracker = GPUMemoryTracker::Instance();
+
+        ImGui::SetNextWindowSize(ImVec2(420, 420), ImGuiCond_FirstUseEver);
+        ImGui::Begin("GPU Memory");
+
+        ImGui::Text("Total: %.2f MB in %d allocations", tracker->GetTotalBytes() / MB, tracker->GetNumberOfAllocations());
+
+        if (ImGui::Button("Dump to JSON##GPUMemory"))
+            tracker->Dump("GPUMemory.json");
+
+        if (ImGui::CollapsingHeader("Categories##GPUMemory", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            const auto& categories = tracker->GetBytesByCategory();
+
+            for (auto it = categories.constBegin(); it != categories.constEnd(); ++it)
+                ImGui::Text("%s: %.2f MB", GPUMemoryTracker::ToString(it.key()).toStdString().c_str(), it.value() / MB);
+        }
+
+        if (ImGui::CollapsingHeader("Owners##GPUMemory"))
+        {
+            // Largest first
+            QMultiMap<qint64, QString> owners;
+            const auto& bytesByOwner = tracker->GetBytesByOwner();
+
+            for (auto it = bytesByOwner.constBegin(); it != bytesByOwner.constEnd(); ++it)
+                owners.insert(it.value(), it.key());
+
+            for (auto it = owners.constEnd(); it != owners.constBegin();)
+            {
+                --it;
+                ImGui::Text("%s: %.2f MB", it.value().toStdString().c_str(), it.key() / MB);
+            }
+        }
+
+        if (ImGui::CollapsingHeader("CPU##GPUMemory"))
+        {
+            ImGui::Text("Process RSS: %.2f MB", Helper::GetResidentSetSize() / MB);
+            ImGui::Text("CPU mesh copies: %.2f MB", ModelDataManager::Instance()->GetCPUMeshMemory() / MB);
+            ImGui::Text("Released after upload: %.2f MB", ModelDataManager::Instance()->GetReleasedCPUMemory() / MB);
+        }
+
+        ImGui::End();
+    }
+
     // Create Node
     {
         ImGui::SetNextWindowSize(ImVec2(420, 820), ImGuiCond_FirstUseEver);
@@ -481,6 +593,13 @@ void Canavar::Engine::Gui::Draw(Model* model)
         ImGui::ColorEdit4("Overlay Color##Model", (float*)&model->GetOverlayColor_NonConst());
     }
 
+    if (!ImGui::CollapsingHeader("Level of Detail##Model"))
+    {
+        const int numberOfLods = model->GetData() ? model->GetData()->GetNumberOfLods() : 1;
+        ImGui::Text("LOD: %d (%d levels)", model->GetLod(), numberOfLods);
+        ImGui::SliderFloat("LOD Bias##Model", &model->GetLodBias_NonConst(), -4.0f, 4.0f, "%.2f");
+    }
+
     if (!ImGui::CollapsingHeader("Meshes##Model"))
     {
         if (auto data = ModelDataManager::Instance()->GetModelData(model->GetModelName()))
@@ -502,7 +621,7 @@ void Canavar::Engine::Gui::Draw(Model* model)
                 ImGui::Text("ID: %d", mSelectedMesh->GetID());
                 ImGui::Text("Number of Vertices: %d", mSelectedMesh->GetNumberOfVertices());
 
-                auto transformation = model->GetMeshTransformation(mSelectedMesh->GetName());
+                auto transformation = model->GetMeshTransformation(mSelectedMesh->GetNameID());
                 auto position = transformation.column(3);
                 auto rotation = QQuaternion::fromRotationMatrix(transformation.normalMatrix());
 
@@ -528,7 +647,7 @@ void Canavar::Engine::Gui::Draw(Model* model)
                 transformation.setToIdentity();
                 transformation.setColumn(3, position);
                 transformation.rotate(rotation);
-                model->SetMeshTransformation(mSelectedMesh->GetName(), transformation);
+                model->SetMeshTransformation(mSelectedMesh->GetNameID(), transformation);
 
                 if (mSelectedVertexIndex != -1)
                 {
@@ -1,4 +1,7 @@
 #include "Helper.h"
+#include "Config.h"
+#include "GPUMemoryTracker.h"
+#include "MeshOptimizer.h"
 #include "ModelData.h"
 
 #include <QFile>
@@ -8,6 +11,15 @@
 
 #include <limits>
 
+#if defined(Q_OS_WIN)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_LINUX)
+#include <unistd.h>
+#endif
+
 Canavar::Engine::Helper::Helper() {}
 
 float Canavar::Engine::Helper::CalculateHorizontalFovForGivenVerticalFov(float verticalFov, float width, float height)
@@ -150,12 +162,7 @@ Canavar::Engine::ModelData* Canavar::Engine::Helper::LoadModel(const QString& na
 {
     Assimp::Importer importer;
 
-    auto* aiScene = importer.ReadFile(path.toStdString(),              //
-        aiProcess_Triangulate |          //
-        aiProcess_GenSmoothNormals | //
-        aiProcess_FlipUVs |          //
-        aiProcess_CalcTangentSpace | //
-        aiProcess_GenBoundingBoxes);
+    auto* aiScene = importer.ReadFile(path.toStdString(), IMPORTER_FLAGS);
 
     if (!aiScene || aiScene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !aiScene->mRootNode)
     {
@@ -179,24 +186,42 @@ Canavar::Engine::ModelData* Canavar::Engine::Helper::LoadModel(const QString& na
     }
 
     // Meshes
+    MeshOptimizer::Statistics statistics;
+
     for (unsigned int i = 0; i < aiScene->mNumMeshes; i++)
     {
         aiMesh* aiMesh = aiScene->mMeshes[i];
-        Mesh* mesh = ProcessMesh(aiMesh);
+        MeshOptimizer::Statistics meshStatistics;
+        Mesh* mesh = ProcessMesh(aiMesh, meshStatistics);
         mesh->SetID(i);
         mesh->SetMaterial(data->GetMaterial(aiMesh->mMaterialIndex));
         data->AddMesh(mesh);
+        statistics += meshStatistics;
     }
 
+    qInfo() << "Model" << name << "optimized."
+            << "ACMR:" << statistics.acmrBefore << "->" << statistics.acmrAfter << "|"
+            << "Vertices:" << statistics.numberOfVerticesBefore << "->" << statistics.numberOfVerticesAfter << "|"
+            << "Bytes:" << statistics.bytesBefore << "->" << statistics.bytesAfter;
+
+    data->BuildDrawList();
     CalculateAABB(data);
 
     return data;
 }
 
-Canavar::Engine::Mesh* Canavar::Engine::Helper::ProcessMesh(aiMesh* aiMesh)
+Canavar::Engine::Mesh* Canavar::Engine::Helper::ProcessMesh(aiMesh* aiMesh, MeshOptimizer::Statistics& statistics)
 {
     Mesh* mesh = new Mesh;
 
+    // Skinned meshes keep the full layout for their bone attributes
+    mesh->SetCompactVertices(Config::Instance()->GetCompactVertexFormat() && !aiMesh->HasBones());
+
+    QVector<Mesh::Vertex> vertices;
+    QVector<unsigned int> indices;
+
+    vertices.reserve(aiMesh->mNumVertices);
+
     for (unsigned int i = 0; i < aiMesh->mNumVertices; i++)
     {
         Mesh::Vertex vertex;
@@ -215,7 +240,7 @@ Canavar::Engine::Mesh* Canavar::Engine::Helper::ProcessMesh(aiMesh* aiMesh)
             vertex.bitangent = QVector3D(aiMesh->mBitangents[i].x, aiMesh->mBitangents[i].y, aiMesh->mBitangents[i].z);
         }
 
-        mesh->AddVertex(vertex);
+        vertices << vertex;
     }
 
     for (unsigned int i = 0; i < aiMesh->mNumFaces; i++)
@@ -223,9 +248,26 @@ Canavar::Engine::Mesh* Canavar::Engine::Helper::ProcessMesh(aiMesh* aiMesh)
         aiFace aiFace = aiMesh->mFaces[i];
 
         for (unsigned int j = 0; j < aiFace.mNumIndices; j++)
-            mesh->AddIndex(aiFace.mIndices[j]);
+            indices << aiFace.mIndices[j];
+    }
+
+    // Points and lines are left as they are
+    if (aiMesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+    {
+        statistics = MeshOptimizer::Optimize(vertices, indices, mesh->GetCompactVertices() ? sizeof(Mesh::CompactVertex) : sizeof(Mesh::Vertex));
+
+        QVector<unsigned int> lodIndices;
+        QVector<Mesh::Lod> lods;
+        MeshOptimizer::GenerateLods(vertices, indices, lodIndices, lods);
+        mesh->SetLods(lodIndices, lods);
     }
 
+    for (const auto& vertex : qAsConst(vertices))
+        mesh->AddVertex(vertex);
+
+    for (auto index : qAsConst(indices))
+        mesh->AddIndex(index);
+
     mesh->SetName(aiMesh->mName.C_Str());
 
     AABB aabb;
@@ -246,7 +288,7 @@ Canavar::Engine::ModelDataNode* Canavar::Engine::Helper::ProcessNode(ModelData*
         parent->AddMeshIndex(aiParent->mMeshes[i]);
 
     parent->SetName(aiParent->mName.C_Str());
-    parent->SetWorldTransformation(ToQMatrix(aiParent->mTransformation));
+    parent->SetTransformation(ToQMatrix(aiParent->mTransformation));
 
     for (unsigned int i = 0; i < aiParent->mNumChildren; ++i)
     {
@@ -281,9 +323,9 @@ bool Canavar::Engine::Helper::ProcessTexture(Material* material, aiMaterial* aiM
         QString filename = QString(str.C_Str());
         auto path = directory + "/" + filename;
 
-        if (auto texture = CreateTexture(path))
+        if (QImage image = DecodeImage(path); !image.isNull())
         {
-            material->Insert(type, texture);
+            material->InsertImage(type, image, path);
             success = true;
         }
     }
@@ -321,25 +363,27 @@ void Canavar::Engine::Helper::CalculateAABB(ModelData* data)
     float maxY = -std::numeric_limits<float>::infinity();
     float maxZ = -std::numeric_limits<float>::infinity();
 
-    for (const auto& mesh : data->GetMeshes())
+    for (const auto& entry : data->GetDrawList())
     {
-        if (minX > mesh->GetAABB().GetMin().x())
-            minX = mesh->GetAABB().GetMin().x();
+        const AABB aabb = entry.mesh->GetAABB().Transform(entry.transformation);
 
-        if (minY > mesh->GetAABB().GetMin().y())
-            minY = mesh->GetAABB().GetMin().y();
+        if (minX > aabb.GetMin().x())
+            minX = aabb.GetMin().x();
 
-        if (minZ > mesh->GetAABB().GetMin().z())
-            minZ = mesh->GetAABB().GetMin().z();
+        if (minY > aabb.GetMin().y())
+            minY = aabb.GetMin().y();
 
-        if (maxX < mesh->GetAABB().GetMax().x())
-            maxX = mesh->GetAABB().GetMax().x();
+        if (minZ > aabb.GetMin().z())
+            minZ = aabb.GetMin().z();
 
-        if (maxY < mesh->GetAABB().GetMax().y())
-            maxY = mesh->GetAABB().GetMax().y();
+        if (maxX < aabb.GetMax().x())
+            maxX = aabb.GetMax().x();
 
-        if (maxZ < mesh->GetAABB().GetMax().z())
-            maxZ = mesh->GetAABB().GetMax().z();
+        if (maxY < aabb.GetMax().y())
+            maxY = aabb.GetMax().y();
+
+        if (maxZ < aabb.GetMax().z())
+            maxZ = aabb.GetMax().z();
     }
 
     AABB aabb;
@@ -363,23 +407,43 @@ QVector3D Canavar::Engine::Helper::GenerateVec3(float x, float y, float z)
     return QVector3D(GenerateFloat(x), GenerateFloat(y), GenerateFloat(z));
 }
 
-QOpenGLTexture* Canavar::Engine::Helper::CreateTexture(const QString& path)
+QOpenGLTexture* Canavar::Engine::Helper::CreateTexture(const QString& path, const QString& owner)
 {
-    QImage image(path);
+    return CreateTexture(DecodeImage(path), owner);
+}
 
+QOpenGLTexture* Canavar::Engine::Helper::CreateTexture(const QImage& image, const QString& owner)
+{
     if (image.isNull())
-    {
-        qWarning() << "An image at " + path + " is null.";
         return nullptr;
-    }
 
     QOpenGLTexture* texture = new QOpenGLTexture(image, QOpenGLTexture::GenerateMipMaps);
     texture->setWrapMode(QOpenGLTexture::WrapMode::Repeat);
     texture->setMinMagFilters(QOpenGLTexture::Filter::LinearMipMapLinear, QOpenGLTexture::Filter::Linear);
 
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Texture,
+                                           texture->textureId(),
+                                           GPUMemoryTracker::Category::Texture,
+                                           owner,
+                                           GPUMemoryTracker::CalculateTextureSize(texture));
+
     return texture;
 }
 
+QImage Canavar::Engine::Helper::DecodeImage(const QString& path)
+{
+    QImage image(path);
+
+    if (image.isNull())
+    {
+        qWarning() << "An image at " + path + " is null.";
+        return image;
+    }
+
+    // QOpenGLTexture converts to this format anyway, do it here rather than on the render thread
+    return image.convertToFormat(QImage::Format_RGBA8888);
+}
+
 QVector<Canavar::Engine::PointLight*> Canavar::Engine::Helper::GetClosePointLights(const QList<PointLight*>& lights, const QVector3D& position, int maxCount)
 {
     QMultiMap<float, PointLight*> distances;
@@ -471,4 +535,31 @@ QByteArray Canavar::Engine::Helper::ReadDataFromFile(const QString& path)
     }
 }
 
-QRandomGenerator Canavar::Engine::Helper::mGenerator = QRandomGenerator::securelySeeded();
\ No newline at end of file
+QRandomGenerator Canavar::Engine::Helper::mGenerator = QRandomGenerator::securelySeeded();
+
+qint64 Canavar::Engine::Helper::GetResidentSetSize()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return qint64(counters.WorkingSetSize);
+
+    return 0;
+#elif defined(Q_OS_LINUX)
+    QFile file("/proc/self/statm");
+
+    if (!file.open(QIODevice::ReadOnly))
+        return 0;
+
+    // size resident shared text lib data dt, in pages
+    const auto fields = file.readAll().split(' ');
+
+    if (fields.size() < 2)
+        return 0;
+
+    return fields[1].toLongLong() * sysconf(_SC_PAGESIZE);
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,403 @@
+#include "ImpostorRenderer.h"
+#include "GPUMemoryTracker.h"
+#include "Mesh.h"
+#include "Model.h"
+#include "ModelData.h"
+#include "ModelDataManager.h"
+#include "ShaderManager.h"
+
+#include <QDebug>
+#include <QOpenGLContext>
+#include <QtMath>
+
+namespace {
+    // Views per side of an atlas and their size in texels
+    constexpr int GRID_SIZE = 8;
+    constexpr int CELL_SIZE = 128;
+    constexpr int ATLAS_SIZE = GRID_SIZE * CELL_SIZE;
+
+    // Down to 8 texels per view, the coarser levels would blend neighbouring views
+    constexpr int NUMBER_OF_LEVELS = 5;
+
+    qint64 GetAtlasTextureSize()
+    {
+        qint64 bytes = 0;
+
+        for (int level = 0; level < NUMBER_OF_LEVELS; ++level)
+            bytes += qint64(ATLAS_SIZE >> level) * (ATLAS_SIZE >> level) * Canavar::Engine::GPUMemoryTracker::GetBytesPerPixel(GL_RGBA8);
+
+        return bytes;
+    }
+
+    // Same as DecodeOctahedral in Common.glsl, the bake and the impostor shader must agree on the directions
+    QVector3D DecodeOctahedral(float x, float y)
+    {
+        QVector3D v(x, y, 1.0f - qAbs(x) - qAbs(y));
+
+        if (v.z() < 0.0f)
+        {
+            v.setX((1.0f - qAbs(y)) * (x >= 0.0f ? 1.0f : -1.0f));
+            v.setY((1.0f - qAbs(x)) * (y >= 0.0f ? 1.0f : -1.0f));
+        }
+
+        return v.normalized();
+    }
+} // namespace
+
+Canavar::Engine::ImpostorRenderer::ImpostorRenderer()
+    : mShaderManager(nullptr)
+    , mInstanceBuffer(0)
+    , mNumberOfImpostors(0)
+    , mFramebuffer(0)
+    , mDepthRenderbuffer(0)
+{}
+
+Canavar::Engine::ImpostorRenderer::~ImpostorRenderer()
+{
+    // Never initialized or the context is already gone
+    if (mShaderManager == nullptr || QOpenGLContext::currentContext() == nullptr)
+        return;
+
+    auto tracker = GPUMemoryTracker::Instance();
+
+    for (const auto& atlas : qAsConst(mAtlases))
+        DeleteAtlas(atlas);
+
+    mAtlases.clear();
+
+    tracker->Free(GPUMemoryTracker::Resource::Buffer, mInstanceBuffer);
+    glDeleteBuffers(1, &mInstanceBuffer);
+
+    tracker->Free(GPUMemoryTracker::Resource::Renderbuffer, mDepthRenderbuffer);
+    glDeleteRenderbuffers(1, &mDepthRenderbuffer);
+    glDeleteFramebuffers(1, &mFramebuffer);
+}
+
+void Canavar::Engine::ImpostorRenderer::Init()
+{
+    initializeOpenGLFunctions();
+
+    mShaderManager = ShaderManager::Instance();
+
+    mMVPUniform = mShaderManager->GetUniformHandle("MVP");
+    mNUniform = mShaderManager->GetUniformHandle("N");
+    mUseTextureAmbientUniform = mShaderManager->GetUniformHandle("useTextureAmbient");
+    mTextureAmbientUniform = mShaderManager->GetUniformHandle("textureAmbient");
+    mTintUniform = mShaderManager->GetUniformHandle("tint");
+    mInstanceOffsetUniform = mShaderManager->GetUniformHandle("instanceOffset");
+    mGridSizeUniform = mShaderManager->GetUniformHandle("gridSize");
+    mTextureAlbedoUniform = mShaderManager->GetUniformHandle("textureAlbedo");
+    mTextureNormalDepthUniform = mShaderManager->GetUniformHandle("textureNormalDepth");
+
+    glGenBuffers(1, &mInstanceBuffer);
+
+    // Shared by all bakes, the atlases are attached as the color buffers
+    glGenRenderbuffers(1, &mDepthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, mDepthRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, ATLAS_SIZE, ATLAS_SIZE);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Renderbuffer, mDepthRenderbuffer, GPUMemoryTracker::Category::RenderTarget, "Pass: Impostor Bake", qint64(ATLAS_SIZE) * ATLAS_SIZE * GPUMemoryTracker::GetBytesPerPixel(GL_DEPTH_COMPONENT24));
+
+    glGenFramebuffers(1, &mFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mDepthRenderbuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Canavar::Engine::ImpostorRenderer::Clear()
+{
+    // Keeps the capacity of the vectors of the atlases that stay in use
+    for (auto& impostors : mImpostors)
+        impostors.clear();
+
+    mNumberOfImpostors = 0;
+}
+
+bool Canavar::Engine::ImpostorRenderer::Add(Model* model)
+{
+    ModelData* data = model->GetData();
+    const auto it = mAtlases.constFind(data);
+
+    if (it == mAtlases.constEnd())
+    {
+        if (!mBakeQueue.contains(data))
+            mBakeQueue << data;
+
+        return false;
+    }
+
+    const Atlas& atlas = it.value();
+
+    if (atlas.albedo == 0)
+        return false;
+
+    const QMatrix4x4& world = model->WorldTransformation();
+
+    // Rotation and the largest scale, the sphere covers the model under non-uniform scale too
+    QMatrix4x4 rotation;
+    float scale = 0.0f;
+
+    for (int column = 0; column < 3; ++column)
+    {
+        const QVector3D axis = world.column(column).toVector3D();
+        scale = qMax(scale, axis.length());
+        rotation.setColumn(column, QVector4D(axis.normalized(), 0.0f));
+    }
+
+    ImpostorData impostor;
+
+    // QMatrix4x4 carries a flag word, copy the raw column-major floats only
+    memcpy(impostor.rotation, rotation.constData(), sizeof(impostor.rotation));
+    impostor.sphere = QVector4D(world.map(atlas.center), scale * atlas.radius);
+    impostor.color = model->GetColor();
+    impostor.overlayColor = model->GetOverlayColor();
+    impostor.overlayColorFactor = model->GetOverlayColorFactor();
+    impostor.ambient = model->GetAmbient();
+    impostor.diffuse = model->GetDiffuse();
+    impostor.specular = model->GetSpecular();
+    impostor.shininess = model->GetShininess();
+
+    mImpostors[data] << impostor;
+    mNumberOfImpostors++;
+
+    return true;
+}
+
+void Canavar::Engine::ImpostorRenderer::Bake(GLuint framebuffer, int width, int height)
+{
+    if (mBakeQueue.isEmpty())
+        return;
+
+    ModelData* data = mBakeQueue.takeFirst();
+
+    // Requested again once its meshes are back on the GPU
+    if (!data->IsResident())
+        return;
+
+    const auto& drawList = data->GetDrawList();
+
+    Atlas atlas;
+
+    if (!drawList.isEmpty())
+    {
+        AABB aabb = drawList[0].mesh->GetAABB().Transform(drawList[0].transformation);
+
+        for (int i = 1; i < drawList.size(); ++i)
+            aabb.Merge(drawList[i].mesh->GetAABB().Transform(drawList[i].transformation));
+
+        atlas.center = aabb.GetCenter();
+        atlas.radius = 0.5f * (aabb.GetMax() - aabb.GetMin()).length();
+    }
+
+    // Nothing to show, the models of the data are drawn as usual
+    if (qFuzzyIsNull(atlas.radius))
+    {
+        mAtlases.insert(data, atlas);
+        return;
+    }
+
+    const QString owner = "Impostor: " + data->GetName();
+
+    atlas.albedo = CreateAtlasTexture(owner);
+    atlas.normalDepth = CreateAtlasTexture(owner);
+    atlas.size = 2 * GetAtlasTextureSize();
+
+    const GLenum attachments[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    const GLfloat zero[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const GLfloat one = 1.0f;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, atlas.albedo, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, atlas.normalDepth, 0);
+    glDrawBuffers(2, attachments);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        qWarning() << Q_FUNC_INFO << "Impostor framebuffer is not complete.";
+
+    glClearBufferfv(GL_COLOR, 0, zero);
+    glClearBufferfv(GL_COLOR, 1, zero);
+    glClearBufferfv(GL_DEPTH, 0, &one);
+
+    // Orthographic views of the bounding sphere, the depth range is its diameter
+    QMatrix4x4 projection;
+    projection.ortho(-atlas.radius, atlas.radius, -atlas.radius, atlas.radius, 0.0f, 2.0f * atlas.radius);
+
+    mShaderManager->Bind(ShaderType::ImpostorBakeShader);
+
+    for (int y = 0; y < GRID_SIZE; ++y)
+    {
+        for (int x = 0; x < GRID_SIZE; ++x)
+        {
+            const QVector3D direction = DecodeOctahedral(2.0f * (x + 0.5f) / GRID_SIZE - 1.0f, 2.0f * (y + 0.5f) / GRID_SIZE - 1.0f);
+            const QVector3D up = qAbs(direction.y()) > 0.999f ? QVector3D(0, 0, 1) : QVector3D(0, 1, 0);
+
+            QMatrix4x4 view;
+            view.lookAt(atlas.center + atlas.radius * direction, atlas.center, up);
+
+            const QMatrix4x4 VP = projection * view;
+
+            glViewport(x * CELL_SIZE, y * CELL_SIZE, CELL_SIZE, CELL_SIZE);
+
+            for (const auto& entry : drawList)
+            {
+                Mesh* mesh = entry.mesh;
+                QOpenGLTexture* texture = nullptr;
+
+                // Textured meshes ignore Model::Color
+                if (mesh->GetMaterial()->GetNumberOfTextures())
+                {
+                    texture = mesh->GetMaterial()->Get(Material::TextureType::Ambient);
+
+                    if (texture == nullptr)
+                        texture = mesh->GetMaterial()->Get(Material::TextureType::Diffuse);
+                }
+
+                mShaderManager->SetUniformValue(mUseTextureAmbientUniform, texture != nullptr);
+                mShaderManager->SetUniformValue(mTintUniform, mesh->GetMaterial()->GetNumberOfTextures() ? 0.0f : 1.0f);
+
+                if (texture)
+                    mShaderManager->SetSampler(mTextureAmbientUniform, 0, texture->textureId());
+
+                mesh->SetVertexFormatUniforms();
+                mShaderManager->SetUniformValue(mMVPUniform, VP * entry.transformation);
+                mShaderManager->SetUniformValue(mNUniform, entry.transformation.normalMatrix());
+
+                mesh->GetVAO()->bind();
+                glDrawElements(GL_TRIANGLES, mesh->GetNumberOfIndices(), mesh->GetIndexType(), mesh->GetIndexOffset());
+                mesh->GetVAO()->release();
+            }
+        }
+    }
+
+    mShaderManager->Release();
+
+    for (const auto texture : { atlas.albedo, atlas.normalDepth })
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, width, height);
+
+    mAtlases.insert(data, atlas);
+
+    // Counted against the GPU memory budget, freed with the data on eviction
+    ModelDataManager::Instance()->AddResidentGPUMemory(atlas.size);
+
+    qInfo() << "Impostor atlas of" << data->GetName() << "is baked.";
+}
+
+GLuint Canavar::Engine::ImpostorRenderer::CreateAtlasTexture(const QString& owner)
+{
+    GLuint texture = 0;
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexStorage2D(GL_TEXTURE_2D, NUMBER_OF_LEVELS, GL_RGBA8, ATLAS_SIZE, ATLAS_SIZE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Texture, texture, GPUMemoryTracker::Category::Texture, owner, GetAtlasTextureSize());
+
+    return texture;
+}
+
+void Canavar::Engine::ImpostorRenderer::DeleteAtlas(const Atlas& atlas)
+{
+    for (const auto texture : { atlas.albedo, atlas.normalDepth })
+    {
+        if (texture)
+        {
+            GPUMemoryTracker::Instance()->Free(GPUMemoryTracker::Resource::Texture, texture);
+            glDeleteTextures(1, &texture);
+        }
+    }
+}
+
+void Canavar::Engine::ImpostorRenderer::Release(ModelData* data)
+{
+    mBakeQueue.removeAll(data);
+
+    // Only drawn in the frame they are added in
+    mNumberOfImpostors -= mImpostors.value(data).size();
+    mImpostors.remove(data);
+
+    const auto it = mAtlases.constFind(data);
+
+    if (it == mAtlases.constEnd())
+        return;
+
+    DeleteAtlas(it.value());
+    ModelDataManager::Instance()->AddResidentGPUMemory(-it.value().size);
+    mAtlases.erase(it);
+}
+
+void Canavar::Engine::ImpostorRenderer::Render(GLuint quadVAO)
+{
+    if (mNumberOfImpostors == 0)
+        return;
+
+    static_assert(sizeof(ImpostorData) == 144, "ImpostorData must match the std430 layout of Impostor");
+
+    // All impostors of the frame go up in one upload, grouped by atlas
+    mInstanceData.clear();
+    mInstanceData.reserve(mNumberOfImpostors);
+
+    for (auto it = mImpostors.constBegin(); it != mImpostors.constEnd(); ++it)
+        mInstanceData << it.value();
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mInstanceBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, mInstanceData.size() * sizeof(ImpostorData), mInstanceData.constData(), GL_STREAM_DRAW);
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Buffer, mInstanceBuffer, GPUMemoryTracker::Category::StorageBuffer, "Pass: Impostors", mInstanceData.size() * sizeof(ImpostorData));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mInstanceBuffer);
+
+    mShaderManager->Bind(ShaderType::ImpostorShader);
+    mShaderManager->SetUniformValue(mGridSizeUniform, GRID_SIZE);
+    glBindVertexArray(quadVAO);
+
+    int offset = 0;
+
+    for (auto it = mImpostors.constBegin(); it != mImpostors.constEnd(); ++it)
+    {
+        const int count = it.value().size();
+
+        if (count == 0)
+            continue;
+
+        const Atlas& atlas = mAtlases[it.key()];
+
+        mShaderManager->SetSampler(mTextureAlbedoUniform, 0, atlas.albedo);
+        mShaderManager->SetSampler(mTextureNormalDepthUniform, 1, atlas.normalDepth);
+        mShaderManager->SetUniformValue(mInstanceOffsetUniform, offset);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, count);
+
+        offset += count;
+    }
+
+    glBindVertexArray(0);
+    mShaderManager->Release();
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+}
+
+int Canavar::Engine::ImpostorRenderer::GetNumberOfImpostors() const
+{
+    return mNumberOfImpostors;
+}
+
+int Canavar::Engine::ImpostorRenderer::GetNumberOfAtlases() const
+{
+    int count = 0;
+
+    for (const auto& atlas : mAtlases)
+        if (atlas.albedo)
+            count++;
+
+    return count;
+}
@@ -1,4 +1,5 @@
 #include "IntersectionManager.h"
+#include "GPUMemoryTracker.h"
 #include "NodeManager.h"
 #include "ShaderManager.h"
 
@@ -19,12 +20,14 @@ bool Canavar::Engine::IntersectionManager::Init()
 
     mNodeManager = NodeManager::Instance();
     mShaderManager = ShaderManager::Instance();
+    mVPUniform = mShaderManager->GetUniformHandle("VP");
 
     mFBOFormat.setSamples(0);
     mFBOFormat.setInternalTextureFormat(GL_RGBA32F);
     mFBOFormat.setAttachment(QOpenGLFramebufferObject::Depth);
 
     mFBO = new QOpenGLFramebufferObject(FBO_WIDTH, FBO_HEIGHT, mFBOFormat);
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Framebuffer, mFBO->handle(), GPUMemoryTracker::Category::RenderTarget, "Pass: Raycast", GPUMemoryTracker::CalculateFramebufferSize(mFBO));
 
     mProjection.ortho(-10, 10, -10, 10, 0.1, 1000000);
 
@@ -55,31 +58,25 @@ Canavar::Engine::IntersectionManager::IntersectionResult Canavar::Engine::Inters
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     mShaderManager->Bind(ShaderType::RaycasterShader);
-    mShaderManager->SetUniformValue("VP", vp);
+    mShaderManager->SetUniformValue(mVPUniform, vp);
 
     if (includeList.isEmpty())
     {
-        auto &nodes = mNodeManager->GetNodes();
-
-        for (const auto &node : nodes)
+        for (const auto &model : mNodeManager->GetModels())
         {
-            if (!node->GetVisible())
+            if (!model->GetVisible())
                 continue;
 
-            if (auto model = dynamic_cast<Model *>(node))
-            {
-                if (excludeList.contains(model))
-                    continue;
+            if (excludeList.contains(model))
+                continue;
 
-                model->Render(RenderMode::Raycaster);
-            }
+            model->Render(RenderMode::Raycaster);
         }
 
     } else
     {
-        for (const auto &node : includeList)
-            if (auto model = dynamic_cast<Model *>(node))
-                model->Render(RenderMode::Raycaster);
+        for (const auto &model : includeList)
+            model->Render(RenderMode::Raycaster);
     }
 
     IntersectionResult result;
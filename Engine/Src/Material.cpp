@@ -1,17 +1,77 @@
 #include "Material.h"
+#include "GPUMemoryTracker.h"
+#include "Helper.h"
+
+#include <atomic>
+#include <utility>
+
+namespace {
+    // Materials are created on the import threads as well
+    std::atomic<quint32> NEXT_MATERIAL_ID{1};
+} // namespace
 
 Canavar::Engine::Material::Material()
     : QObject()
+    , mID(NEXT_MATERIAL_ID++)
 {}
 
 Canavar::Engine::Material::~Material()
 {
-    // TODO
+    DestroyTextures();
 }
 
-void Canavar::Engine::Material::Insert(TextureType type, QOpenGLTexture* texture)
+void Canavar::Engine::Material::Insert(TextureType type, QOpenGLTexture* texture, const QString& path)
 {
     mTextures.insert(type, texture);
+
+    if (!path.isEmpty())
+        mPaths.insert(type, path);
+}
+
+void Canavar::Engine::Material::InsertImage(TextureType type, const QImage& image, const QString& path)
+{
+    mImages.insert(type, image);
+    mPaths.insert(type, path);
+}
+
+void Canavar::Engine::Material::CreateTextures(const QString& owner)
+{
+    for (auto it = mImages.constBegin(); it != mImages.constEnd(); ++it)
+        if (auto texture = Helper::CreateTexture(it.value(), owner))
+            mTextures.insert(it.key(), texture);
+
+    mImages.clear();
+}
+
+void Canavar::Engine::Material::DestroyTextures()
+{
+    for (const auto& texture : qAsConst(mTextures))
+        GPUMemoryTracker::Instance()->Free(GPUMemoryTracker::Resource::Texture, texture->textureId());
+
+    qDeleteAll(mTextures);
+    mTextures.clear();
+}
+
+void Canavar::Engine::Material::DecodeImages()
+{
+    for (auto it = mPaths.constBegin(); it != mPaths.constEnd(); ++it)
+        if (QImage image = Helper::DecodeImage(it.value()); !image.isNull())
+            mImages.insert(it.key(), image);
+}
+
+void Canavar::Engine::Material::TakeImages(Material* source)
+{
+    mImages = std::exchange(source->mImages, QMap<TextureType, QImage>());
+}
+
+qint64 Canavar::Engine::Material::GetGPUMemorySize() const
+{
+    qint64 size = 0;
+
+    for (const auto& texture : mTextures)
+        size += GPUMemoryTracker::CalculateTextureSize(texture);
+
+    return size;
 }
 
 QOpenGLTexture* Canavar::Engine::Material::Get(TextureType type)
@@ -19,6 +79,16 @@ QOpenGLTexture* Canavar::Engine::Material::Get(TextureType type)
     return mTextures.value(type, nullptr);
 }
 
+QString Canavar::Engine::Material::GetPath(TextureType type) const
+{
+    return mPaths.value(type);
+}
+
+quint32 Canavar::Engine::Material::GetID() const
+{
+    return mID;
+}
+
 int Canavar::Engine::Material::GetNumberOfTextures()
 {
     return mTextures.size();
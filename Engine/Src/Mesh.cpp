@@ -1,13 +1,141 @@
 #include "Mesh.h"
 #include "CameraManager.h"
 #include "Common.h"
+#include "Config.h"
+#include "GPUMemoryTracker.h"
 #include "Model.h"
+#include "NameRegistry.h"
 #include "ShaderManager.h"
 
+#include <utility>
+
+namespace {
+    // Uniforms set for every mesh, resolved once on first use
+    struct MeshUniforms {
+        Canavar::Engine::UniformHandle M;
+        Canavar::Engine::UniformHandle N;
+        Canavar::Engine::UniformHandle MVP;
+        Canavar::Engine::UniformHandle color;
+        Canavar::Engine::UniformHandle overlayColor;
+        Canavar::Engine::UniformHandle overlayColorFactor;
+        Canavar::Engine::UniformHandle meshOverlayColor;
+        Canavar::Engine::UniformHandle meshOverlayColorFactor;
+        Canavar::Engine::UniformHandle shininess;
+        Canavar::Engine::UniformHandle ambient;
+        Canavar::Engine::UniformHandle diffuse;
+        Canavar::Engine::UniformHandle specular;
+        Canavar::Engine::UniformHandle nodeID;
+        Canavar::Engine::UniformHandle meshID;
+        Canavar::Engine::UniformHandle fillVertexInfo;
+        Canavar::Engine::UniformHandle useTextureAmbient;
+        Canavar::Engine::UniformHandle useTextureDiffuse;
+        Canavar::Engine::UniformHandle useTextureSpecular;
+        Canavar::Engine::UniformHandle useTextureNormal;
+        Canavar::Engine::UniformHandle textureAmbient;
+        Canavar::Engine::UniformHandle textureDiffuse;
+        Canavar::Engine::UniformHandle textureSpecular;
+        Canavar::Engine::UniformHandle textureNormal;
+        Canavar::Engine::UniformHandle compactVertices;
+
+        MeshUniforms()
+        {
+            auto shaderManager = Canavar::Engine::ShaderManager::Instance();
+            M = shaderManager->GetUniformHandle("M");
+            N = shaderManager->GetUniformHandle("N");
+            MVP = shaderManager->GetUniformHandle("MVP");
+            color = shaderManager->GetUniformHandle("model.color");
+            overlayColor = shaderManager->GetUniformHandle("model.overlayColor");
+            overlayColorFactor = shaderManager->GetUniformHandle("model.overlayColorFactor");
+            meshOverlayColor = shaderManager->GetUniformHandle("model.meshOverlayColor");
+            meshOverlayColorFactor = shaderManager->GetUniformHandle("model.meshOverlayColorFactor");
+            shininess = shaderManager->GetUniformHandle("model.shininess");
+            ambient = shaderManager->GetUniformHandle("model.ambient");
+            diffuse = shaderManager->GetUniformHandle("model.diffuse");
+            specular = shaderManager->GetUniformHandle("model.specular");
+            nodeID = shaderManager->GetUniformHandle("nodeID");
+            meshID = shaderManager->GetUniformHandle("meshID");
+            fillVertexInfo = shaderManager->GetUniformHandle("fillVertexInfo");
+            useTextureAmbient = shaderManager->GetUniformHandle("useTextureAmbient");
+            useTextureDiffuse = shaderManager->GetUniformHandle("useTextureDiffuse");
+            useTextureSpecular = shaderManager->GetUniformHandle("useTextureSpecular");
+            useTextureNormal = shaderManager->GetUniformHandle("useTextureNormal");
+            textureAmbient = shaderManager->GetUniformHandle("textureAmbient");
+            textureDiffuse = shaderManager->GetUniformHandle("textureDiffuse");
+            textureSpecular = shaderManager->GetUniformHandle("textureSpecular");
+            textureNormal = shaderManager->GetUniformHandle("textureNormal");
+            compactVertices = shaderManager->GetUniformHandle("compactVertices");
+        }
+    };
+
+    qint16 ToSnorm16(float value)
+    {
+        return qint16(qRound(qBound(-1.0f, value, 1.0f) * 32767.0f));
+    }
+
+    float FromSnorm16(qint16 value)
+    {
+        return qMax(value / 32767.0f, -1.0f);
+    }
+
+    // Maps a unit vector onto the octahedron and unfolds it to [-1, 1]^2
+    QVector2D EncodeOctahedral(const QVector3D& vector)
+    {
+        const float l1 = qAbs(vector.x()) + qAbs(vector.y()) + qAbs(vector.z());
+
+        if (qFuzzyIsNull(l1))
+            return QVector2D(0, 0);
+
+        QVector2D e(vector.x() / l1, vector.y() / l1);
+
+        if (vector.z() < 0.0f)
+        {
+            const float x = (1.0f - qAbs(e.y())) * (e.x() >= 0.0f ? 1.0f : -1.0f);
+            const float y = (1.0f - qAbs(e.x())) * (e.y() >= 0.0f ? 1.0f : -1.0f);
+            e = QVector2D(x, y);
+        }
+
+        return e;
+    }
+
+    QVector3D DecodeOctahedral(const QVector2D& e)
+    {
+        QVector3D vector(e.x(), e.y(), 1.0f - qAbs(e.x()) - qAbs(e.y()));
+
+        if (vector.z() < 0.0f)
+        {
+            const float x = (1.0f - qAbs(e.y())) * (e.x() >= 0.0f ? 1.0f : -1.0f);
+            const float y = (1.0f - qAbs(e.x())) * (e.y() >= 0.0f ? 1.0f : -1.0f);
+            vector.setX(x);
+            vector.setY(y);
+        }
+
+        return vector.normalized();
+    }
+
+    const MeshUniforms& Uniforms()
+    {
+        static const MeshUniforms uniforms;
+        return uniforms;
+    }
+} // namespace
+
 Canavar::Engine::Mesh::Mesh()
     : QObject()
     , mVAO(nullptr)
+    , mEBO(0)
+    , mVBO(0)
+    , mVertexOffset(0)
+    , mIndexOffset(0)
+    , mNumberOfVertices(0)
+    , mNumberOfIndices(0)
+    , mNumberOfLodIndices(0)
+    , mDataPolicy(MeshDataPolicy::Keep)
+    , mIndexType(GL_UNSIGNED_INT)
     , mMaterial(nullptr)
+    , mNameID(NameRegistry::INVALID_ID)
+    , mCompactVertices(false)
+    , mVerticesVAO(nullptr)
+    , mVerticesVBO(0)
 {
     mShaderManager = ShaderManager::Instance();
     mCameraManager = CameraManager::Instance();
@@ -15,17 +143,40 @@ Canavar::Engine::Mesh::Mesh()
 
 Canavar::Engine::Mesh::~Mesh()
 {
-    // TODO
+    Destroy();
 }
 
 void Canavar::Engine::Mesh::AddVertex(const Vertex& vertex)
 {
     mVertices << vertex;
+    mNumberOfVertices = mVertices.size();
 }
 
 void Canavar::Engine::Mesh::AddIndex(unsigned int index)
 {
     mIndices << index;
+    mNumberOfIndices = mIndices.size();
+}
+
+void Canavar::Engine::Mesh::SetVertices(const Vertex* vertices, int count)
+{
+    mVertices.resize(count);
+    memcpy(mVertices.data(), vertices, count * sizeof(Vertex));
+    mNumberOfVertices = count;
+}
+
+void Canavar::Engine::Mesh::SetIndices(const unsigned int* indices, int count)
+{
+    mIndices.resize(count);
+    memcpy(mIndices.data(), indices, count * sizeof(unsigned int));
+    mNumberOfIndices = count;
+}
+
+void Canavar::Engine::Mesh::SetLods(const QVector<unsigned int>& lodIndices, const QVector<Lod>& lods)
+{
+    mLodIndices = lodIndices;
+    mLods = lods;
+    mNumberOfLodIndices = lodIndices.size();
 }
 
 void Canavar::Engine::Mesh::SetMaterial(Material* material)
@@ -33,48 +184,103 @@ void Canavar::Engine::Mesh::SetMaterial(Material* material)
     mMaterial = material;
 }
 
-void Canavar::Engine::Mesh::Create()
+void Canavar::Engine::Mesh::SetName(const QString& name)
 {
+    mName = name;
+    mNameID = NameRegistry::Instance()->Intern(name);
+}
+
+void Canavar::Engine::Mesh::Create(const QString& owner)
+{
+    auto tracker = GPUMemoryTracker::Instance();
+
     initializeOpenGLFunctions();
-    mVAO = new QOpenGLVertexArrayObject;
-    mVAO->create();
-    mVAO->bind();
 
-    glGenBuffers(1, &mEBO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mIndices.size() * sizeof(unsigned int), mIndices.constData(), GL_STATIC_DRAW);
+    QVector<CompactVertex> compactVertices;
 
-    glGenBuffers(1, &mVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, mVBO);
-    glBufferData(GL_ARRAY_BUFFER, mVertices.size() * sizeof(Vertex), mVertices.constData(), GL_STATIC_DRAW);
+    if (mCompactVertices)
+    {
+        static_assert(sizeof(CompactVertex) == 28, "CompactVertex must be tightly packed");
 
-    // Position
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    glEnableVertexAttribArray(0);
+        compactVertices.resize(mVertices.size());
 
-    // Normals
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-    glEnableVertexAttribArray(1);
+        for (int i = 0; i < mVertices.size(); ++i)
+        {
+            const Vertex& vertex = mVertices[i];
+            const QVector2D normal = EncodeOctahedral(vertex.normal);
+            const QVector2D tangent = EncodeOctahedral(vertex.tangent);
+            const float handedness = QVector3D::dotProduct(QVector3D::crossProduct(vertex.normal, vertex.tangent), vertex.bitangent) < 0.0f ? -1.0f : 1.0f;
+
+            CompactVertex& compact = compactVertices[i];
+            compact.position = vertex.position;
+            compact.normal[0] = ToSnorm16(normal.x());
+            compact.normal[1] = ToSnorm16(normal.y());
+            compact.tangent[0] = ToSnorm16(tangent.x());
+            compact.tangent[1] = ToSnorm16(tangent.y());
+            compact.tangent[2] = ToSnorm16(handedness);
+            compact.tangent[3] = 0;
+            compact.texture[0] = qfloat16(vertex.texture.x());
+            compact.texture[1] = qfloat16(vertex.texture.y());
+        }
+    }
 
-    //Texture Cooords
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texture));
-    glEnableVertexAttribArray(2);
+    const void* vertices = mCompactVertices ? static_cast<const void*>(compactVertices.constData()) : static_cast<const void*>(mVertices.constData());
+    const qint64 vertexSize = mCompactVertices ? sizeof(CompactVertex) : sizeof(Vertex);
+
+    // The LOD indices follow the full detail ones in the same buffer
+    const QVector<unsigned int> allIndices = mLodIndices.isEmpty() ? mIndices : mIndices + mLodIndices;
 
-    // Tangent
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
-    glEnableVertexAttribArray(3);
+    mArenaAllocation = GeometryArena::Allocation();
+    mVertexOffset = 0;
+    mIndexOffset = 0;
+
+    if (Config::Instance()->GetGeometryArenaEnabled())
+        GeometryArena::Instance()->Allocate(mCompactVertices, vertices, mVertices.size(), allIndices.constData(), allIndices.size(), mArenaAllocation);
+
+    mVAO = new QOpenGLVertexArrayObject;
+    mVAO->create();
+    mVAO->bind();
+
+    if (IsInArena())
+    {
+        // The buffers belong to the arena, the VAO only points at this mesh's ranges in them
+        auto arena = GeometryArena::Instance();
+        mEBO = arena->GetIndexBuffer(mArenaAllocation.page);
+        mVBO = arena->GetVertexBuffer(mArenaAllocation.page);
+        mVertexOffset = mArenaAllocation.baseVertex * vertexSize;
+        mIndexOffset = mArenaAllocation.firstIndex * qint64(sizeof(unsigned int));
+        mIndexType = GL_UNSIGNED_INT;
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
+        glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+    }
+    else
+    {
+        glGenBuffers(1, &mEBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
 
-    // Bitangent
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, bitangent));
-    glEnableVertexAttribArray(4);
+        // 16-bit indices are enough for most meshes and halve the index buffer
+        if (mVertices.size() < 65536)
+        {
+            QVector<quint16> indices(allIndices.constBegin(), allIndices.constEnd());
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(quint16), indices.constData(), GL_STATIC_DRAW);
+            tracker->Allocate(GPUMemoryTracker::Resource::Buffer, mEBO, GPUMemoryTracker::Category::IndexBuffer, owner, indices.size() * sizeof(quint16));
+            mIndexType = GL_UNSIGNED_SHORT;
+        }
+        else
+        {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, allIndices.size() * sizeof(unsigned int), allIndices.constData(), GL_STATIC_DRAW);
+            tracker->Allocate(GPUMemoryTracker::Resource::Buffer, mEBO, GPUMemoryTracker::Category::IndexBuffer, owner, allIndices.size() * sizeof(unsigned int));
+            mIndexType = GL_UNSIGNED_INT;
+        }
 
-    // IDs
-    glVertexAttribPointer(5, 4, GL_INT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, boneIDs));
-    glEnableVertexAttribArray(5);
+        glGenBuffers(1, &mVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+        glBufferData(GL_ARRAY_BUFFER, mVertices.size() * vertexSize, vertices, GL_STATIC_DRAW);
+        tracker->Allocate(GPUMemoryTracker::Resource::Buffer, mVBO, GPUMemoryTracker::Category::VertexBuffer, owner, mVertices.size() * vertexSize);
+    }
 
-    // Weights
-    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, weights));
-    glEnableVertexAttribArray(6);
+    SetVertexAttributes(this, mCompactVertices, mVertexOffset);
 
     mVAO->release();
 
@@ -87,13 +293,22 @@ void Canavar::Engine::Mesh::Create()
     glGenBuffers(1, &mVerticesVBO);
     glBindBuffer(GL_ARRAY_BUFFER, mVerticesVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(CUBE), CUBE, GL_STATIC_DRAW);
+    tracker->Allocate(GPUMemoryTracker::Resource::Buffer, mVerticesVBO, GPUMemoryTracker::Category::VertexBuffer, owner, sizeof(CUBE));
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(QVector3D), (void*)0);
     glEnableVertexAttribArray(0);
 
     glBindBuffer(GL_ARRAY_BUFFER, mVBO);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+
+    // Only the position is read by MeshVertexRenderer.vert
+    const GLsizei stride = vertexSize;
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)mVertexOffset);
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+
+    if (mCompactVertices)
+        glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, stride, (void*)(mVertexOffset + offsetof(CompactVertex, normal)));
+    else
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(mVertexOffset + offsetof(Vertex, normal)));
+
     glEnableVertexAttribArray(2);
 
     glVertexAttribDivisor(1, 1);
@@ -102,83 +317,95 @@ void Canavar::Engine::Mesh::Create()
     mVerticesVAO->release();
 }
 
-void Canavar::Engine::Mesh::Render(RenderModes modes, Model* model)
+void Canavar::Engine::Mesh::SetVertexAttributes(QOpenGLExtraFunctions* functions, bool compact, qintptr offset)
+{
+    // A vertex array object and GL_ARRAY_BUFFER must be bound
+    if (compact)
+    {
+        // Position
+        functions->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(CompactVertex), (void*)offset);
+        functions->glEnableVertexAttribArray(0);
+
+        // Normal
+        functions->glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)(offset + offsetof(CompactVertex, normal)));
+        functions->glEnableVertexAttribArray(1);
+
+        // Texture Coords
+        functions->glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(CompactVertex), (void*)(offset + offsetof(CompactVertex, texture)));
+        functions->glEnableVertexAttribArray(2);
+
+        // Tangent and handedness, bitangent is derived in the shader
+        functions->glVertexAttribPointer(3, 3, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (void*)(offset + offsetof(CompactVertex, tangent)));
+        functions->glEnableVertexAttribArray(3);
+    }
+    else
+    {
+        // Position
+        functions->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offset);
+        functions->glEnableVertexAttribArray(0);
+
+        // Normals
+        functions->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offset + offsetof(Vertex, normal)));
+        functions->glEnableVertexAttribArray(1);
+
+        //Texture Cooords
+        functions->glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offset + offsetof(Vertex, texture)));
+        functions->glEnableVertexAttribArray(2);
+
+        // Tangent
+        functions->glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offset + offsetof(Vertex, tangent)));
+        functions->glEnableVertexAttribArray(3);
+
+        // Bitangent
+        functions->glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offset + offsetof(Vertex, bitangent)));
+        functions->glEnableVertexAttribArray(4);
+
+        // IDs
+        functions->glVertexAttribPointer(5, 4, GL_INT, GL_FALSE, sizeof(Vertex), (void*)(offset + offsetof(Vertex, boneIDs)));
+        functions->glEnableVertexAttribArray(5);
+
+        // Weights
+        functions->glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offset + offsetof(Vertex, weights)));
+        functions->glEnableVertexAttribArray(6);
+    }
+}
+
+void Canavar::Engine::Mesh::Render(RenderModes modes, Model* model, const QMatrix4x4& nodeTransformation)
 {
+    const auto& uniforms = Uniforms();
+
     if (modes.testFlag(RenderMode::Custom))
     {
         mVAO->bind();
-        glDrawElements(GL_TRIANGLES, mIndices.size(), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, mNumberOfIndices, mIndexType, GetIndexOffset());
         mVAO->release();
     }
 
     if (modes.testFlag(RenderMode::Raycaster))
     {
-        mShaderManager->SetUniformValue("M", model->WorldTransformation() * model->GetMeshTransformation(mName));
+        mShaderManager->SetUniformValue(uniforms.M, model->WorldTransformation() * nodeTransformation * model->GetMeshOverride(mID).transformation);
 
         mVAO->bind();
-        glDrawElements(GL_TRIANGLES, mIndices.size(), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, mNumberOfIndices, mIndexType, GetIndexOffset());
         mVAO->release();
     }
 
     if (modes.testFlag(RenderMode::Default))
     {
-        if (bool useTexture = mMaterial->GetNumberOfTextures())
+        if (mMaterial->GetNumberOfTextures())
         {
             mShaderManager->Bind(ShaderType::ModelTexturedShader);
-            mShaderManager->SetUniformValue("N", model->WorldTransformation().normalMatrix() * model->GetMeshTransformation(mName).normalMatrix());
-            mShaderManager->SetUniformValue("useTextureAmbient", false);
-            mShaderManager->SetUniformValue("useTextureDiffuse", false);
-            mShaderManager->SetUniformValue("useTextureSpecular", false);
-            mShaderManager->SetUniformValue("useTextureNormal", false);
-
-            if (auto texture = mMaterial->Get(Material::TextureType::Ambient))
-            {
-                mShaderManager->SetUniformValue("useTextureAmbient", true);
-                mShaderManager->SetSampler("textureAmbient", 0, texture->textureId());
-            }
-            else if (auto texture = mMaterial->Get(Material::TextureType::Diffuse))
-            {
-                mShaderManager->SetUniformValue("useTextureAmbient", true);
-                mShaderManager->SetSampler("textureAmbient", 0, texture->textureId()); // Use diffuse texture if there is no ambient texture
-            }
-
-            if (auto texture = mMaterial->Get(Material::TextureType::Diffuse))
-            {
-                mShaderManager->SetUniformValue("useTextureDiffuse", true);
-                mShaderManager->SetSampler("textureDiffuse", 1, texture->textureId());
-            }
-
-            if (auto texture = mMaterial->Get(Material::TextureType::Specular))
-            {
-                mShaderManager->SetUniformValue("useTextureSpecular", true);
-                mShaderManager->SetSampler("textureSpecular", 2, texture->textureId());
-            }
-
-            if (auto texture = mMaterial->Get(Material::TextureType::Normal))
-            {
-                mShaderManager->SetUniformValue("useTextureNormal", true);
-                mShaderManager->SetSampler("textureNormal", 3, texture->textureId());
-            }
+            SetTextureUniforms();
         }
         else
         {
             mShaderManager->Bind(ShaderType::ModelColoredShader);
-            mShaderManager->SetUniformValue("model.color", model->GetColor());
         }
 
-        // Common uniforms
-        mShaderManager->SetUniformValue("M", model->WorldTransformation() * model->GetMeshTransformation(mName));
-        mShaderManager->SetUniformValue("model.overlayColor", model->GetOverlayColor());
-        mShaderManager->SetUniformValue("model.overlayColorFactor", model->GetOverlayColorFactor());
-        mShaderManager->SetUniformValue("model.meshOverlayColor", model->GetMeshOverlayColor(mName));
-        mShaderManager->SetUniformValue("model.meshOverlayColorFactor", model->GetMeshOverlayColorFactor(mName));
-        mShaderManager->SetUniformValue("model.shininess", model->GetShininess());
-        mShaderManager->SetUniformValue("model.ambient", model->GetAmbient());
-        mShaderManager->SetUniformValue("model.diffuse", model->GetDiffuse());
-        mShaderManager->SetUniformValue("model.specular", model->GetSpecular());
+        SetModelUniforms(model, nodeTransformation);
 
         mVAO->bind();
-        glDrawElements(GL_TRIANGLES, mIndices.size(), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, GetNumberOfIndices(model->GetLod()), mIndexType, GetIndexOffset(model->GetLod()));
         mVAO->release();
 
         mShaderManager->Release();
@@ -187,32 +414,386 @@ void Canavar::Engine::Mesh::Render(RenderModes modes, Model* model)
     if (modes.testFlag(RenderMode::NodeInfo))
     {
         mShaderManager->Bind(ShaderType::NodeInfoShader);
-        mShaderManager->SetUniformValue("MVP", mCameraManager->GetActiveCamera()->GetViewProjectionMatrix() * model->WorldTransformation() * model->GetMeshTransformation(mName));
-        mShaderManager->SetUniformValue("nodeID", model->GetID());
-        mShaderManager->SetUniformValue("meshID", mID);
-        mShaderManager->SetUniformValue("fillVertexInfo", false);
+        mShaderManager->SetUniformValue(uniforms.MVP, mCameraManager->GetActiveCamera()->GetViewProjectionMatrix() * model->WorldTransformation() * nodeTransformation * model->GetMeshOverride(mID).transformation);
+        mShaderManager->SetUniformValue(uniforms.nodeID, model->GetID());
+        mShaderManager->SetUniformValue(uniforms.meshID, mID);
+        mShaderManager->SetUniformValue(uniforms.fillVertexInfo, false);
 
+        // Same level as the default pass so that the picked pixels match what is shown
         mVAO->bind();
-        glDrawElements(GL_TRIANGLES, mIndices.size(), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, GetNumberOfIndices(model->GetLod()), mIndexType, GetIndexOffset(model->GetLod()));
         mVAO->release();
 
         mShaderManager->Release();
     }
 }
 
-Canavar::Engine::Mesh::Vertex Canavar::Engine::Mesh::GetVertex(int index) const
+void Canavar::Engine::Mesh::SetVertexFormatUniforms()
+{
+    mShaderManager->SetUniformValue(Uniforms().compactVertices, mCompactVertices);
+}
+
+void Canavar::Engine::Mesh::SetModelUniforms(Model* model, const QMatrix4x4& nodeTransformation)
+{
+    const auto& uniforms = Uniforms();
+    const auto& meshOverride = model->GetMeshOverride(mID);
+    const QMatrix4x4 M = model->WorldTransformation() * nodeTransformation * meshOverride.transformation;
+
+    if (!mMaterial->GetNumberOfTextures())
+        mShaderManager->SetUniformValue(uniforms.color, model->GetColor());
+
+    SetVertexFormatUniforms();
+    mShaderManager->SetUniformValue(uniforms.M, M);
+    mShaderManager->SetUniformValue(uniforms.N, M.normalMatrix());
+    mShaderManager->SetUniformValue(uniforms.overlayColor, model->GetOverlayColor());
+    mShaderManager->SetUniformValue(uniforms.overlayColorFactor, model->GetOverlayColorFactor());
+    mShaderManager->SetUniformValue(uniforms.meshOverlayColor, meshOverride.overlayColor);
+    mShaderManager->SetUniformValue(uniforms.meshOverlayColorFactor, meshOverride.overlayColorFactor);
+    mShaderManager->SetUniformValue(uniforms.shininess, model->GetShininess());
+    mShaderManager->SetUniformValue(uniforms.ambient, model->GetAmbient());
+    mShaderManager->SetUniformValue(uniforms.diffuse, model->GetDiffuse());
+    mShaderManager->SetUniformValue(uniforms.specular, model->GetSpecular());
+}
+
+void Canavar::Engine::Mesh::SetTextureUniforms()
+{
+    const auto& uniforms = Uniforms();
+
+    mShaderManager->SetUniformValue(uniforms.useTextureAmbient, false);
+    mShaderManager->SetUniformValue(uniforms.useTextureDiffuse, false);
+    mShaderManager->SetUniformValue(uniforms.useTextureSpecular, false);
+    mShaderManager->SetUniformValue(uniforms.useTextureNormal, false);
+
+    if (auto texture = mMaterial->Get(Material::TextureType::Ambient))
+    {
+        mShaderManager->SetUniformValue(uniforms.useTextureAmbient, true);
+        mShaderManager->SetSampler(uniforms.textureAmbient, 0, texture->textureId());
+    }
+    else if (auto texture = mMaterial->Get(Material::TextureType::Diffuse))
+    {
+        mShaderManager->SetUniformValue(uniforms.useTextureAmbient, true);
+        mShaderManager->SetSampler(uniforms.textureAmbient, 0, texture->textureId()); // Use diffuse texture if there is no ambient texture
+    }
+
+    if (auto texture = mMaterial->Get(Material::TextureType::Diffuse))
+    {
+        mShaderManager->SetUniformValue(uniforms.useTextureDiffuse, true);
+        mShaderManager->SetSampler(uniforms.textureDiffuse, 1, texture->textureId());
+    }
+
+    if (auto texture = mMaterial->Get(Material::TextureType::Specular))
+    {
+        mShaderManager->SetUniformValue(uniforms.useTextureSpecular, true);
+        mShaderManager->SetSampler(uniforms.textureSpecular, 2, texture->textureId());
+    }
+
+    if (auto texture = mMaterial->Get(Material::TextureType::Normal))
+    {
+        mShaderManager->SetUniformValue(uniforms.useTextureNormal, true);
+        mShaderManager->SetSampler(uniforms.textureNormal, 3, texture->textureId());
+    }
+}
+
+Canavar::Engine::Mesh::Vertex Canavar::Engine::Mesh::GetVertex(int index)
 {
     Vertex vertex;
 
-    if (0 <= index && index < mVertices.size())
+    if (index < 0 || index >= mNumberOfVertices)
+        return vertex;
+
+    switch (mDataPolicy)
+    {
+    case MeshDataPolicy::Keep:
         vertex = mVertices.at(index);
+        break;
+    case MeshDataPolicy::PositionsOnly:
+        vertex.position = mPositions.at(index);
+        break;
+    case MeshDataPolicy::Release:
+        vertex = ReadVertices(index, 1).value(0);
+        break;
+    }
 
     return vertex;
 }
 
 int Canavar::Engine::Mesh::GetNumberOfVertices()
 {
-    return mVertices.size();
+    return mNumberOfVertices;
+}
+
+const QVector<Canavar::Engine::Mesh::Vertex>& Canavar::Engine::Mesh::GetVertices()
+{
+    RestoreCPUData();
+    return mVertices;
+}
+
+const QVector<unsigned int>& Canavar::Engine::Mesh::GetIndices()
+{
+    RestoreCPUData();
+    return mIndices;
+}
+
+int Canavar::Engine::Mesh::GetNumberOfIndices() const
+{
+    return mNumberOfIndices;
+}
+
+GLenum Canavar::Engine::Mesh::GetIndexType() const
+{
+    return mIndexType;
+}
+
+const void* Canavar::Engine::Mesh::GetIndexOffset() const
+{
+    return reinterpret_cast<const void*>(mIndexOffset);
+}
+
+int Canavar::Engine::Mesh::GetNumberOfLods() const
+{
+    return 1 + mLods.size();
+}
+
+int Canavar::Engine::Mesh::GetNumberOfIndices(int lod) const
+{
+    lod = qBound(0, lod, mLods.size());
+    return lod == 0 ? mNumberOfIndices : mLods[lod - 1].numberOfIndices;
+}
+
+const void* Canavar::Engine::Mesh::GetIndexOffset(int lod) const
+{
+    const qintptr indexSize = mIndexType == GL_UNSIGNED_SHORT ? sizeof(quint16) : sizeof(unsigned int);
+    return reinterpret_cast<const void*>(mIndexOffset + GetFirstIndex(lod) * indexSize);
+}
+
+int Canavar::Engine::Mesh::GetFirstIndex(int lod) const
+{
+    lod = qBound(0, lod, mLods.size());
+    return lod == 0 ? 0 : mNumberOfIndices + mLods[lod - 1].firstIndex;
+}
+
+float Canavar::Engine::Mesh::GetLodError(int lod) const
+{
+    lod = qBound(0, lod, mLods.size());
+    return lod == 0 ? 0.0f : mLods[lod - 1].error;
+}
+
+const QVector<unsigned int>& Canavar::Engine::Mesh::GetLodIndices()
+{
+    RestoreCPUData();
+    return mLodIndices;
+}
+
+const QVector<Canavar::Engine::Mesh::Lod>& Canavar::Engine::Mesh::GetLods() const
+{
+    return mLods;
+}
+
+bool Canavar::Engine::Mesh::IsInArena() const
+{
+    return mArenaAllocation.page != -1;
+}
+
+const Canavar::Engine::GeometryArena::Allocation& Canavar::Engine::Mesh::GetArenaAllocation() const
+{
+    return mArenaAllocation;
+}
+
+void Canavar::Engine::Mesh::Destroy()
+{
+    if (mVAO == nullptr)
+        return;
+
+    auto tracker = GPUMemoryTracker::Instance();
+
+    if (IsInArena())
+    {
+        GeometryArena::Instance()->Free(mArenaAllocation);
+        mArenaAllocation = GeometryArena::Allocation();
+    }
+    else
+    {
+        tracker->Free(GPUMemoryTracker::Resource::Buffer, mEBO);
+        tracker->Free(GPUMemoryTracker::Resource::Buffer, mVBO);
+        glDeleteBuffers(1, &mEBO);
+        glDeleteBuffers(1, &mVBO);
+    }
+
+    tracker->Free(GPUMemoryTracker::Resource::Buffer, mVerticesVBO);
+    glDeleteBuffers(1, &mVerticesVBO);
+
+    mVAO->destroy();
+    mVerticesVAO->destroy();
+
+    delete mVAO;
+    delete mVerticesVAO;
+
+    mVAO = nullptr;
+    mVerticesVAO = nullptr;
+    mEBO = 0;
+    mVBO = 0;
+    mVertexOffset = 0;
+    mIndexOffset = 0;
+    mVerticesVBO = 0;
+}
+
+bool Canavar::Engine::Mesh::IsCreated() const
+{
+    return mVAO != nullptr;
+}
+
+qint64 Canavar::Engine::Mesh::GetGPUMemorySize() const
+{
+    if (mVAO == nullptr)
+        return 0;
+
+    const qint64 vertexSize = mCompactVertices ? sizeof(CompactVertex) : sizeof(Vertex);
+    const qint64 indexSize = mIndexType == GL_UNSIGNED_SHORT ? sizeof(quint16) : sizeof(unsigned int);
+
+    return mNumberOfVertices * vertexSize + (mNumberOfIndices + mNumberOfLodIndices) * indexSize + sizeof(CUBE);
+}
+
+void Canavar::Engine::Mesh::ReleaseCPUData(MeshDataPolicy policy)
+{
+    if (policy == MeshDataPolicy::Keep || mDataPolicy != MeshDataPolicy::Keep || mVAO == nullptr)
+        return;
+
+    if (policy == MeshDataPolicy::PositionsOnly)
+    {
+        mPositions.resize(mVertices.size());
+
+        for (int i = 0; i < mVertices.size(); ++i)
+            mPositions[i] = mVertices[i].position;
+    }
+
+    // Assigning empty vectors frees the storage, clear() keeps the capacity
+    mVertices = QVector<Vertex>();
+    mIndices = QVector<unsigned int>();
+    mLodIndices = QVector<unsigned int>();
+    mDataPolicy = policy;
+}
+
+void Canavar::Engine::Mesh::RestoreCPUData()
+{
+    if (mDataPolicy == MeshDataPolicy::Keep || mVAO == nullptr)
+        return;
+
+    const QVector<unsigned int> indices = ReadIndices(0, mNumberOfIndices + mNumberOfLodIndices);
+
+    mVertices = ReadVertices(0, mNumberOfVertices);
+    mIndices = indices.mid(0, mNumberOfIndices);
+    mLodIndices = indices.mid(mNumberOfIndices);
+    mPositions = QVector<QVector3D>();
+    mDataPolicy = MeshDataPolicy::Keep;
+}
+
+void Canavar::Engine::Mesh::TakeCPUData(Mesh* source)
+{
+    // Assigning empty vectors frees the storage of source
+    mVertices = std::exchange(source->mVertices, QVector<Vertex>());
+    mIndices = std::exchange(source->mIndices, QVector<unsigned int>());
+    mLodIndices = std::exchange(source->mLodIndices, QVector<unsigned int>());
+    mPositions = QVector<QVector3D>();
+    mDataPolicy = MeshDataPolicy::Keep;
+}
+
+bool Canavar::Engine::Mesh::HasCPUData() const
+{
+    return mDataPolicy == MeshDataPolicy::Keep;
+}
+
+qint64 Canavar::Engine::Mesh::GetCPUMemorySize() const
+{
+    return mVertices.capacity() * sizeof(Vertex) + (mIndices.capacity() + mLodIndices.capacity()) * sizeof(unsigned int) + mPositions.capacity() * sizeof(QVector3D);
+}
+
+QVector<Canavar::Engine::Mesh::Vertex> Canavar::Engine::Mesh::ReadVertices(int first, int count)
+{
+    QVector<Vertex> vertices;
+
+    const GLsizeiptr stride = mCompactVertices ? sizeof(CompactVertex) : sizeof(Vertex);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, mVBO);
+    const auto data = static_cast<const char*>(glMapBufferRange(GL_COPY_READ_BUFFER, mVertexOffset + first * stride, count * stride, GL_MAP_READ_BIT));
+
+    if (data == nullptr)
+    {
+        qWarning() << Q_FUNC_INFO << "Could not map the vertex buffer of mesh" << mName;
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        return vertices;
+    }
+
+    vertices.resize(count);
+
+    if (mCompactVertices)
+    {
+        const auto compacts = reinterpret_cast<const CompactVertex*>(data);
+
+        for (int i = 0; i < count; ++i)
+        {
+            const CompactVertex& compact = compacts[i];
+            const float handedness = FromSnorm16(compact.tangent[2]) < 0.0f ? -1.0f : 1.0f;
+
+            Vertex& vertex = vertices[i];
+            vertex.position = compact.position;
+            vertex.normal = DecodeOctahedral(QVector2D(FromSnorm16(compact.normal[0]), FromSnorm16(compact.normal[1])));
+            vertex.tangent = DecodeOctahedral(QVector2D(FromSnorm16(compact.tangent[0]), FromSnorm16(compact.tangent[1])));
+            vertex.bitangent = QVector3D::crossProduct(vertex.normal, vertex.tangent) * handedness;
+            vertex.texture = QVector2D(compact.texture[0], compact.texture[1]);
+        }
+    }
+    else
+    {
+        memcpy(vertices.data(), data, count * sizeof(Vertex));
+    }
+
+    glUnmapBuffer(GL_COPY_READ_BUFFER);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    return vertices;
+}
+
+QVector<unsigned int> Canavar::Engine::Mesh::ReadIndices(int first, int count)
+{
+    QVector<unsigned int> indices;
+
+    const GLsizeiptr indexSize = mIndexType == GL_UNSIGNED_SHORT ? sizeof(quint16) : sizeof(unsigned int);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, mEBO);
+    const auto data = glMapBufferRange(GL_COPY_READ_BUFFER, mIndexOffset + first * indexSize, count * indexSize, GL_MAP_READ_BIT);
+
+    if (data == nullptr)
+    {
+        qWarning() << Q_FUNC_INFO << "Could not map the index buffer of mesh" << mName;
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        return indices;
+    }
+
+    if (mIndexType == GL_UNSIGNED_SHORT)
+    {
+        const auto shorts = static_cast<const quint16*>(data);
+        indices = QVector<unsigned int>(shorts, shorts + count);
+    }
+    else
+    {
+        indices.resize(count);
+        memcpy(indices.data(), data, count * sizeof(unsigned int));
+    }
+
+    glUnmapBuffer(GL_COPY_READ_BUFFER);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    return indices;
+}
+
+Canavar::Engine::Material* Canavar::Engine::Mesh::GetMaterial() const
+{
+    return mMaterial;
+}
+
+QOpenGLVertexArrayObject* Canavar::Engine::Mesh::GetVAO() const
+{
+    return mVAO;
 }
 
 QOpenGLVertexArrayObject* Canavar::Engine::Mesh::GetVerticesVAO() const
@@ -0,0 +1,785 @@
+#include "MeshOptimizer.h"
+
+#include <QHash>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <tuple>
+
+namespace {
+    // Forsyth, "Linear-Speed Vertex Cache Optimisation"
+    constexpr int MAX_CACHE_SIZE = 32;
+    constexpr float CACHE_DECAY_POWER = 1.5f;
+    constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+    constexpr float VALENCE_BOOST_SCALE = 2.0f;
+    constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+    // Cache size used to find cluster boundaries for the overdraw pass
+    constexpr int OVERDRAW_CACHE_SIZE = 16;
+
+    // Each LOD targets this fraction of the triangles of the previous one
+    constexpr float LOD_REDUCTION = 0.5f;
+    constexpr int MAX_NUMBER_OF_LODS = 3; // In addition to the full detail level
+    constexpr int MIN_LOD_TRIANGLES = 32;
+
+    // A level is kept only if it has at most this fraction of the triangles of the previous one
+    constexpr float MIN_LOD_GAIN = 0.8f;
+
+    // Collapses stop once the error reaches this fraction of the bounding box diagonal
+    constexpr float MAX_LOD_RELATIVE_ERROR = 0.05f;
+
+    // Weight of the planes keeping open borders in place, relative to the surface planes
+    constexpr double BORDER_WEIGHT = 10.0;
+
+    // Collapses turning a triangle normal by more than ~75 degrees are rejected
+    constexpr float MIN_NORMAL_DOT = 0.25f;
+
+    // Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics".
+    // Sum of weighted squared distances to a set of planes, the weight is kept to report a mean distance.
+    struct Quadric {
+        double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+        double weight = 0;
+
+        static Quadric FromPlane(const QVector3D& normal, const QVector3D& point, double weight)
+        {
+            const double a = normal.x(), b = normal.y(), c = normal.z();
+            const double d = -(a * point.x() + b * point.y() + c * point.z());
+
+            Quadric q;
+            q.a2 = weight * a * a;
+            q.ab = weight * a * b;
+            q.ac = weight * a * c;
+            q.ad = weight * a * d;
+            q.b2 = weight * b * b;
+            q.bc = weight * b * c;
+            q.bd = weight * b * d;
+            q.c2 = weight * c * c;
+            q.cd = weight * c * d;
+            q.d2 = weight * d * d;
+            q.weight = weight;
+            return q;
+        }
+
+        Quadric& operator+=(const Quadric& other)
+        {
+            a2 += other.a2;
+            ab += other.ab;
+            ac += other.ac;
+            ad += other.ad;
+            b2 += other.b2;
+            bc += other.bc;
+            bd += other.bd;
+            c2 += other.c2;
+            cd += other.cd;
+            d2 += other.d2;
+            weight += other.weight;
+            return *this;
+        }
+
+        // Mean distance of point to the planes
+        float Error(const QVector3D& point) const
+        {
+            if (weight <= 0)
+                return 0.0f;
+
+            const double x = point.x(), y = point.y(), z = point.z();
+            const double sum = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x //
+                               + b2 * y * y + 2 * bc * y * z + 2 * bd * y                //
+                               + c2 * z * z + 2 * cd * z + d2;
+
+            return float(std::sqrt(qMax(0.0, sum) / weight));
+        }
+    };
+
+    // Half-edge collapse of "from" onto "to", the vertex positions never change
+    struct Collapse {
+        float error;
+        int from;
+        int to;
+
+        bool operator>(const Collapse& other) const { return error > other.error; }
+    };
+
+    quint64 EdgeKey(unsigned int a, unsigned int b)
+    {
+        return a < b ? (quint64(a) << 32) | b : (quint64(b) << 32) | a;
+    }
+
+    float VertexScore(int cachePosition, int numberOfLiveTriangles)
+    {
+        if (numberOfLiveTriangles == 0)
+            return -1.0f;
+
+        float score = 0.0f;
+
+        if (cachePosition >= 0)
+        {
+            if (cachePosition < 3)
+                score = LAST_TRIANGLE_SCORE;
+            else
+                score = std::pow(1.0f - float(cachePosition - 3) / (MAX_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+        }
+
+        score += VALENCE_BOOST_SCALE * std::pow(float(numberOfLiveTriangles), -VALENCE_BOOST_POWER);
+
+        return score;
+    }
+} // namespace
+
+Canavar::Engine::MeshOptimizer::Statistics& Canavar::Engine::MeshOptimizer::Statistics::operator+=(const Statistics& other)
+{
+    // ACMR is weighted by the vertex count so that large meshes dominate
+    const int before = numberOfVerticesBefore + other.numberOfVerticesBefore;
+    const int after = numberOfVerticesAfter + other.numberOfVerticesAfter;
+
+    if (before > 0)
+        acmrBefore = (acmrBefore * numberOfVerticesBefore + other.acmrBefore * other.numberOfVerticesBefore) / before;
+
+    if (after > 0)
+        acmrAfter = (acmrAfter * numberOfVerticesAfter + other.acmrAfter * other.numberOfVerticesAfter) / after;
+
+    numberOfVerticesBefore = before;
+    numberOfVerticesAfter = after;
+    bytesBefore += other.bytesBefore;
+    bytesAfter += other.bytesAfter;
+
+    return *this;
+}
+
+Canavar::Engine::MeshOptimizer::Statistics Canavar::Engine::MeshOptimizer::Optimize(QVector<Mesh::Vertex>& vertices, QVector<unsigned int>& indices, int vertexSize)
+{
+    Statistics statistics;
+    statistics.numberOfVerticesBefore = vertices.size();
+    statistics.acmrBefore = CalculateACMR(indices, vertices.size());
+    statistics.bytesBefore = CalculateSize(vertices.size(), vertexSize, indices.size(), sizeof(unsigned int));
+
+    if (!indices.isEmpty() && indices.size() % 3 == 0)
+    {
+        Weld(vertices, indices);
+        OptimizeVertexCache(indices, vertices.size());
+        OptimizeOverdraw(vertices, indices);
+        OptimizeVertexFetch(vertices, indices);
+    }
+
+    statistics.numberOfVerticesAfter = vertices.size();
+    statistics.acmrAfter = CalculateACMR(indices, vertices.size());
+    statistics.bytesAfter = CalculateSize(vertices.size(), vertexSize, indices.size(), vertices.size() < 65536 ? sizeof(quint16) : sizeof(unsigned int));
+
+    return statistics;
+}
+
+void Canavar::Engine::MeshOptimizer::Weld(QVector<Mesh::Vertex>& vertices, QVector<unsigned int>& indices)
+{
+    QVector<Mesh::Vertex> result;
+    QVector<unsigned int> remap(vertices.size());
+
+    {
+        const Mesh::Vertex* data = vertices.constData();
+
+        QHash<QByteArray, unsigned int> unique;
+        unique.reserve(vertices.size());
+
+        for (int i = 0; i < vertices.size(); ++i)
+        {
+            // Keys point into "vertices" which outlives the hash
+            const QByteArray key = QByteArray::fromRawData(reinterpret_cast<const char*>(data + i), sizeof(Mesh::Vertex));
+            const auto it = unique.constFind(key);
+
+            if (it == unique.constEnd())
+            {
+                remap[i] = result.size();
+                unique.insert(key, remap[i]);
+                result << data[i];
+            }
+            else
+            {
+                remap[i] = it.value();
+            }
+        }
+    }
+
+    for (auto& index : indices)
+        index = remap[index];
+
+    vertices = result;
+}
+
+void Canavar::Engine::MeshOptimizer::OptimizeVertexCache(QVector<unsigned int>& indices, int numberOfVertices)
+{
+    const int numberOfTriangles = indices.size() / 3;
+
+    if (numberOfTriangles == 0)
+        return;
+
+    // Triangles of each vertex, the first liveTriangles[v] entries are not emitted yet
+    QVector<int> liveTriangles(numberOfVertices, 0);
+
+    for (auto index : qAsConst(indices))
+        liveTriangles[index]++;
+
+    QVector<int> offsets(numberOfVertices + 1, 0);
+
+    for (int v = 0; v < numberOfVertices; ++v)
+        offsets[v + 1] = offsets[v] + liveTriangles[v];
+
+    QVector<int> adjacency(indices.size());
+    QVector<int> fill(offsets.constBegin(), offsets.constEnd() - 1);
+
+    for (int t = 0; t < numberOfTriangles; ++t)
+        for (int k = 0; k < 3; ++k)
+            adjacency[fill[indices[3 * t + k]]++] = t;
+
+    QVector<int> cachePositions(numberOfVertices, -1);
+    QVector<float> vertexScores(numberOfVertices);
+
+    for (int v = 0; v < numberOfVertices; ++v)
+        vertexScores[v] = VertexScore(-1, liveTriangles[v]);
+
+    QVector<float> triangleScores(numberOfTriangles);
+    QVector<bool> emitted(numberOfTriangles, false);
+
+    int bestTriangle = 0;
+
+    for (int t = 0; t < numberOfTriangles; ++t)
+    {
+        triangleScores[t] = vertexScores[indices[3 * t]] + vertexScores[indices[3 * t + 1]] + vertexScores[indices[3 * t + 2]];
+
+        if (triangleScores[t] > triangleScores[bestTriangle])
+            bestTriangle = t;
+    }
+
+    QVector<unsigned int> result;
+    result.reserve(indices.size());
+
+    QVector<int> cache;
+    QVector<int> newCache;
+    cache.reserve(MAX_CACHE_SIZE + 3);
+    newCache.reserve(MAX_CACHE_SIZE + 3);
+
+    int nextCandidate = 0;
+
+    while (bestTriangle >= 0)
+    {
+        emitted[bestTriangle] = true;
+
+        newCache.clear();
+
+        for (int k = 0; k < 3; ++k)
+        {
+            const int v = indices[3 * bestTriangle + k];
+            result << v;
+            newCache << v;
+
+            // Remove the triangle from the live part of the adjacency list
+            const int begin = offsets[v];
+            const int end = begin + liveTriangles[v];
+
+            for (int i = begin; i < end; ++i)
+            {
+                if (adjacency[i] == bestTriangle)
+                {
+                    std::swap(adjacency[i], adjacency[end - 1]);
+                    break;
+                }
+            }
+
+            liveTriangles[v]--;
+        }
+
+        for (int v : qAsConst(cache))
+            if (!newCache.contains(v))
+                newCache << v;
+
+        // Vertices pushed out of the cache lose their cache bonus
+        for (int i = MAX_CACHE_SIZE; i < newCache.size(); ++i)
+        {
+            cachePositions[newCache[i]] = -1;
+            vertexScores[newCache[i]] = VertexScore(-1, liveTriangles[newCache[i]]);
+        }
+
+        for (int i = 0; i < qMin(int(newCache.size()), MAX_CACHE_SIZE); ++i)
+        {
+            cachePositions[newCache[i]] = i;
+            vertexScores[newCache[i]] = VertexScore(i, liveTriangles[newCache[i]]);
+        }
+
+        // Only triangles touching the cache can change, pick the best among them
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+
+        for (int v : qAsConst(newCache))
+        {
+            for (int i = offsets[v]; i < offsets[v] + liveTriangles[v]; ++i)
+            {
+                const int t = adjacency[i];
+                triangleScores[t] = vertexScores[indices[3 * t]] + vertexScores[indices[3 * t + 1]] + vertexScores[indices[3 * t + 2]];
+
+                if (cachePositions[v] >= 0 && triangleScores[t] > bestScore)
+                {
+                    bestScore = triangleScores[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        if (newCache.size() > MAX_CACHE_SIZE)
+            newCache.resize(MAX_CACHE_SIZE);
+
+        std::swap(cache, newCache);
+
+        // Nothing in the cache has live triangles left, continue with the next unused one
+        if (bestTriangle < 0)
+        {
+            while (nextCandidate < numberOfTriangles && emitted[nextCandidate])
+                ++nextCandidate;
+
+            if (nextCandidate < numberOfTriangles)
+                bestTriangle = nextCandidate;
+        }
+    }
+
+    indices = result;
+}
+
+void Canavar::Engine::MeshOptimizer::OptimizeOverdraw(const QVector<Mesh::Vertex>& vertices, QVector<unsigned int>& indices)
+{
+    const int numberOfTriangles = indices.size() / 3;
+
+    if (numberOfTriangles == 0)
+        return;
+
+    // Split where the cache simulation starts over, reordering clusters keeps the cache behaviour
+    QVector<int> clusters;
+    QVector<int> cacheTimes(vertices.size(), -OVERDRAW_CACHE_SIZE - 1);
+    int time = 0;
+
+    for (int t = 0; t < numberOfTriangles; ++t)
+    {
+        int misses = 0;
+
+        for (int k = 0; k < 3; ++k)
+        {
+            const int v = indices[3 * t + k];
+
+            if (time - cacheTimes[v] > OVERDRAW_CACHE_SIZE)
+            {
+                cacheTimes[v] = time++;
+                misses++;
+            }
+        }
+
+        if (t == 0 || misses == 3)
+            clusters << t;
+    }
+
+    clusters << numberOfTriangles;
+
+    const int numberOfClusters = clusters.size() - 1;
+
+    if (numberOfClusters < 2)
+        return;
+
+    // Area weighted centroid and normal of the mesh and of each cluster
+    QVector<QVector3D> clusterCentroids(numberOfClusters);
+    QVector<QVector3D> clusterNormals(numberOfClusters);
+    QVector3D meshCentroid;
+    float meshArea = 0.0f;
+
+    for (int c = 0; c < numberOfClusters; ++c)
+    {
+        float clusterArea = 0.0f;
+
+        for (int t = clusters[c]; t < clusters[c + 1]; ++t)
+        {
+            const QVector3D& p0 = vertices[indices[3 * t]].position;
+            const QVector3D& p1 = vertices[indices[3 * t + 1]].position;
+            const QVector3D& p2 = vertices[indices[3 * t + 2]].position;
+
+            const QVector3D normal = QVector3D::crossProduct(p1 - p0, p2 - p0);
+            const float area = normal.length();
+            const QVector3D centroid = (p0 + p1 + p2) / 3.0f;
+
+            clusterNormals[c] += normal;
+            clusterCentroids[c] += centroid * area;
+            clusterArea += area;
+        }
+
+        meshCentroid += clusterCentroids[c];
+        meshArea += clusterArea;
+
+        if (clusterArea > 0.0f)
+            clusterCentroids[c] /= clusterArea;
+
+        clusterNormals[c].normalize();
+    }
+
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // Clusters facing away from the center occlude the rest, draw them first
+    QVector<float> sortKeys(numberOfClusters);
+    QVector<int> order(numberOfClusters);
+
+    for (int c = 0; c < numberOfClusters; ++c)
+    {
+        sortKeys[c] = QVector3D::dotProduct(clusterCentroids[c] - meshCentroid, clusterNormals[c]);
+        order[c] = c;
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](int a, int b) { return sortKeys[a] > sortKeys[b]; });
+
+    QVector<unsigned int> result;
+    result.reserve(indices.size());
+
+    for (int c : qAsConst(order))
+        for (int i = 3 * clusters[c]; i < 3 * clusters[c + 1]; ++i)
+            result << indices[i];
+
+    indices = result;
+}
+
+void Canavar::Engine::MeshOptimizer::OptimizeVertexFetch(QVector<Mesh::Vertex>& vertices, QVector<unsigned int>& indices)
+{
+    QVector<int> remap(vertices.size(), -1);
+    QVector<Mesh::Vertex> result;
+    result.reserve(vertices.size());
+
+    for (auto& index : indices)
+    {
+        if (remap[index] < 0)
+        {
+            remap[index] = result.size();
+            result << vertices[index];
+        }
+
+        index = remap[index];
+    }
+
+    vertices = result;
+}
+
+void Canavar::Engine::MeshOptimizer::GenerateLods(const QVector<Mesh::Vertex>& vertices, const QVector<unsigned int>& indices, QVector<unsigned int>& lodIndices, QVector<Mesh::Lod>& lods)
+{
+    lodIndices.clear();
+    lods.clear();
+
+    const int numberOfVertices = vertices.size();
+    const int numberOfTriangles = indices.size() / 3;
+
+    if (numberOfTriangles < MIN_LOD_TRIANGLES || indices.size() % 3 != 0)
+        return;
+
+    QVector3D min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+    QVector3D max = -min;
+
+    for (const auto& vertex : vertices)
+    {
+        min = QVector3D(qMin(min.x(), vertex.position.x()), qMin(min.y(), vertex.position.y()), qMin(min.z(), vertex.position.z()));
+        max = QVector3D(qMax(max.x(), vertex.position.x()), qMax(max.y(), vertex.position.y()), qMax(max.z(), vertex.position.z()));
+    }
+
+    const float maxError = MAX_LOD_RELATIVE_ERROR * (max - min).length();
+
+    // Vertices sharing their position with another one sit on an attribute seam.
+    // They stay where they are, otherwise both sides of the seam would simplify differently and crack.
+    enum class Kind { Interior, Border, Locked };
+    QVector<Kind> kinds(numberOfVertices, Kind::Interior);
+
+    {
+        QVector<int> order(numberOfVertices);
+        std::iota(order.begin(), order.end(), 0);
+
+        const auto less = [&vertices](int a, int b) {
+            const QVector3D& p = vertices[a].position;
+            const QVector3D& q = vertices[b].position;
+            return std::make_tuple(p.x(), p.y(), p.z()) < std::make_tuple(q.x(), q.y(), q.z());
+        };
+
+        std::sort(order.begin(), order.end(), less);
+
+        for (int i = 1; i < numberOfVertices; ++i)
+            if (vertices[order[i - 1]].position == vertices[order[i]].position)
+                kinds[order[i - 1]] = kinds[order[i]] = Kind::Locked;
+    }
+
+    // Edges used by one triangle are open borders, edges used by more than two are left alone
+    QHash<quint64, int> edgeUses;
+    edgeUses.reserve(indices.size());
+
+    for (int t = 0; t < numberOfTriangles; ++t)
+        for (int k = 0; k < 3; ++k)
+            edgeUses[EdgeKey(indices[3 * t + k], indices[3 * t + (k + 1) % 3])]++;
+
+    QVector<Quadric> quadrics(numberOfVertices);
+    QVector<QVector<int>> triangles(numberOfVertices); // Of each vertex, may contain removed ones
+    QVector<unsigned int> corners = indices;
+    QVector<bool> removed(numberOfTriangles, false);
+
+    for (int t = 0; t < numberOfTriangles; ++t)
+    {
+        const QVector3D& p0 = vertices[corners[3 * t]].position;
+        const QVector3D& p1 = vertices[corners[3 * t + 1]].position;
+        const QVector3D& p2 = vertices[corners[3 * t + 2]].position;
+        const QVector3D cross = QVector3D::crossProduct(p1 - p0, p2 - p0);
+        const float area = 0.5f * cross.length();
+
+        for (int k = 0; k < 3; ++k)
+            triangles[corners[3 * t + k]] << t;
+
+        if (cross.isNull())
+            continue;
+
+        const QVector3D normal = cross.normalized();
+        const Quadric plane = Quadric::FromPlane(normal, p0, area);
+
+        for (int k = 0; k < 3; ++k)
+        {
+            const unsigned int a = corners[3 * t + k];
+            const unsigned int b = corners[3 * t + (k + 1) % 3];
+
+            quadrics[a] += plane;
+
+            const int uses = edgeUses.value(EdgeKey(a, b));
+
+            if (uses > 2)
+            {
+                kinds[a] = kinds[b] = Kind::Locked;
+            }
+            else if (uses == 1)
+            {
+                // Plane through the border edge, perpendicular to the surface
+                const QVector3D edge = vertices[b].position - vertices[a].position;
+                const Quadric border = Quadric::FromPlane(QVector3D::crossProduct(edge, normal).normalized(), vertices[a].position, BORDER_WEIGHT * edge.lengthSquared());
+
+                quadrics[a] += border;
+                quadrics[b] += border;
+
+                for (auto v : { a, b })
+                    if (kinds[v] == Kind::Interior)
+                        kinds[v] = Kind::Border;
+            }
+        }
+    }
+
+    QVector<int> remap(numberOfVertices);
+    std::iota(remap.begin(), remap.end(), 0);
+
+    // Number of live triangles using both from and to
+    const auto countShared = [&](int from, int to) {
+        int count = 0;
+
+        for (int t : qAsConst(triangles[from]))
+            if (!removed[t] && (corners[3 * t] == unsigned(to) || corners[3 * t + 1] == unsigned(to) || corners[3 * t + 2] == unsigned(to)))
+                count++;
+
+        return count;
+    };
+
+    const auto isValid = [&](int from, int to) {
+        if (kinds[from] == Kind::Locked)
+            return false;
+
+        const int shared = countShared(from, to);
+
+        // Border vertices may only slide along their border
+        if (shared == 0 || (kinds[from] == Kind::Border && shared != 1))
+            return false;
+
+        // No triangle may flip or degenerate
+        for (int t : qAsConst(triangles[from]))
+        {
+            if (removed[t])
+                continue;
+
+            QVector3D before[3], after[3];
+            bool degenerate = false;
+
+            for (int k = 0; k < 3; ++k)
+            {
+                const int v = corners[3 * t + k];
+                before[k] = vertices[v].position;
+                after[k] = vertices[v == from ? to : v].position;
+                degenerate |= v == to;
+            }
+
+            // Triangles along the collapsed edge disappear
+            if (degenerate)
+                continue;
+
+            const QVector3D n0 = QVector3D::crossProduct(before[1] - before[0], before[2] - before[0]);
+            const QVector3D n1 = QVector3D::crossProduct(after[1] - after[0], after[2] - after[0]);
+
+            // Already degenerate, nothing to flip
+            if (n0.isNull())
+                continue;
+
+            if (n1.lengthSquared() <= 1e-12f * n0.lengthSquared() || QVector3D::dotProduct(n0.normalized(), n1.normalized()) < MIN_NORMAL_DOT)
+                return false;
+        }
+
+        return true;
+    };
+
+    const auto costOf = [&](int from, int to) {
+        Quadric q = quadrics[from];
+        q += quadrics[to];
+        return q.Error(vertices[to].position);
+    };
+
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+
+    const auto push = [&](int a, int b) {
+        if (kinds[a] != Kind::Locked)
+            heap.push({ costOf(a, b), a, b });
+
+        if (kinds[b] != Kind::Locked)
+            heap.push({ costOf(b, a), b, a });
+    };
+
+    for (int t = 0; t < numberOfTriangles; ++t)
+        for (int k = 0; k < 3; ++k)
+            if (corners[3 * t + k] < corners[3 * t + (k + 1) % 3])
+                push(corners[3 * t + k], corners[3 * t + (k + 1) % 3]);
+
+    int liveTriangles = numberOfTriangles;
+    int target = qMax(MIN_LOD_TRIANGLES, int(numberOfTriangles * LOD_REDUCTION));
+    int previousTriangles = numberOfTriangles;
+    float error = 0.0f;
+
+    const auto snapshot = [&]() {
+        QVector<unsigned int> level;
+        level.reserve(3 * liveTriangles);
+
+        for (int t = 0; t < numberOfTriangles; ++t)
+            if (!removed[t])
+                level << corners[3 * t] << corners[3 * t + 1] << corners[3 * t + 2];
+
+        OptimizeVertexCache(level, numberOfVertices);
+
+        Mesh::Lod lod;
+        lod.firstIndex = lodIndices.size();
+        lod.numberOfIndices = level.size();
+        lod.error = error;
+
+        lods << lod;
+        lodIndices << level;
+        previousTriangles = liveTriangles;
+    };
+
+    while (lods.size() < MAX_NUMBER_OF_LODS)
+    {
+        bool done = heap.empty();
+
+        if (!done)
+        {
+            const Collapse collapse = heap.top();
+            heap.pop();
+
+            const int from = collapse.from;
+            const int to = collapse.to;
+
+            if (remap[from] != from || remap[to] != to)
+                continue;
+
+            // Quadrics only grow, a stale entry underestimates its cost and is pushed again
+            const float cost = costOf(from, to);
+
+            if (cost > collapse.error * 1.0001f + 1e-9f)
+            {
+                heap.push({ cost, from, to });
+                continue;
+            }
+
+            done = cost > maxError;
+
+            if (!done)
+            {
+                if (!isValid(from, to))
+                    continue;
+
+                remap[from] = to;
+                quadrics[to] += quadrics[from];
+                error = qMax(error, cost);
+
+                for (int t : qAsConst(triangles[from]))
+                {
+                    if (removed[t])
+                        continue;
+
+                    bool degenerate = false;
+
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        degenerate |= corners[3 * t + k] == unsigned(to);
+
+                        if (corners[3 * t + k] == unsigned(from))
+                            corners[3 * t + k] = to;
+                    }
+
+                    if (degenerate)
+                    {
+                        removed[t] = true;
+                        liveTriangles--;
+                    }
+                    else
+                    {
+                        triangles[to] << t;
+                    }
+                }
+
+                triangles[from].clear();
+
+                // The neighbourhood of "to" changed, its edges get fresh candidates
+                for (int t : qAsConst(triangles[to]))
+                    if (!removed[t])
+                        for (int k = 0; k < 3; ++k)
+                            if (corners[3 * t + k] != unsigned(to))
+                                push(corners[3 * t + k], to);
+
+                if (liveTriangles > target)
+                    continue;
+            }
+        }
+
+        // Reached the target or nothing is left to collapse
+        if (liveTriangles <= MIN_LOD_GAIN * previousTriangles)
+            snapshot();
+
+        if (done || liveTriangles <= MIN_LOD_TRIANGLES)
+            break;
+
+        target = qMax(MIN_LOD_TRIANGLES, int(liveTriangles * LOD_REDUCTION));
+    }
+}
+
+float Canavar::Engine::MeshOptimizer::CalculateACMR(const QVector<unsigned int>& indices, int numberOfVertices, int cacheSize)
+{
+    const int numberOfTriangles = indices.size() / 3;
+
+    if (numberOfTriangles == 0)
+        return 0.0f;
+
+    QVector<int> cacheTimes(numberOfVertices, -cacheSize - 1);
+    int time = 0;
+    int misses = 0;
+
+    for (auto index : indices)
+    {
+        if (time - cacheTimes[index] > cacheSize)
+        {
+            cacheTimes[index] = time++;
+            misses++;
+        }
+    }
+
+    return float(misses) / numberOfTriangles;
+}
+
+qint64 Canavar::Engine::MeshOptimizer::CalculateSize(int numberOfVertices, int vertexSize, int numberOfIndices, int indexSize)
+{
+    return qint64(numberOfVertices) * vertexSize + qint64(numberOfIndices) * indexSize;
+}
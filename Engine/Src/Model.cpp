@@ -1,6 +1,7 @@
 #include "Model.h"
 #include "ModelData.h"
 #include "ModelDataManager.h"
+#include "NameRegistry.h"
 
 Canavar::Engine::Model::Model(const QString& modelName)
     : Node()
@@ -13,87 +14,236 @@ Canavar::Engine::Model::Model(const QString& modelName)
     , mDiffuse(0.75)
     , mSpecular(0.25)
     , mShininess(32.0f)
+    , mLodBias(0.0f)
+    , mLod(0)
 {
     mName = modelName;
     mType = Node::NodeType::Model;
     mData = ModelDataManager::Instance()->GetModelData(mModelName);
 
     if (mData)
+    {
+        mData->AddReference();
+        ResolvePendingMeshOverrides();
         SetAABB(mData->GetAABB());
+    } else
+        connect(ModelDataManager::Instance(), &ModelDataManager::ModelDataLoaded, this, &Model::OnModelDataLoaded);
 }
 
-QMatrix4x4 Canavar::Engine::Model::GetMeshTransformation(const QString& meshName)
+Canavar::Engine::Model::~Model()
 {
-    return mMeshTransformations.value(meshName, QMatrix4x4());
+    if (mData)
+        mData->RemoveReference();
 }
 
-void Canavar::Engine::Model::SetMeshTransformation(const QString& meshName, const QMatrix4x4& transformation)
+void Canavar::Engine::Model::OnModelDataLoaded(ModelData* data)
 {
-    mMeshTransformations.insert(meshName, transformation);
+    if (mData || data->GetName() != mModelName)
+        return;
 
+    mData = data;
+    mData->AddReference();
+    ResolvePendingMeshOverrides();
     UpdateAABB();
+
+    disconnect(ModelDataManager::Instance(), &ModelDataManager::ModelDataLoaded, this, &Model::OnModelDataLoaded);
+}
+
+const Canavar::Engine::Model::MeshOverride& Canavar::Engine::Model::GetMeshOverride(unsigned int meshID) const
+{
+    static const MeshOverride DEFAULT;
+
+    if (meshID < (unsigned int) mMeshOverrides.size())
+        return mMeshOverrides[meshID];
+
+    return DEFAULT;
+}
+
+QMatrix4x4 Canavar::Engine::Model::GetMeshTransformation(int nameID) const
+{
+    const MeshOverride* meshOverride = FindMeshOverride(nameID);
+    return meshOverride ? meshOverride->transformation : QMatrix4x4();
+}
+
+void Canavar::Engine::Model::SetMeshTransformation(int nameID, const QMatrix4x4& transformation)
+{
+    GetMeshOverride_Ref(nameID).transformation = transformation;
+
+    // Values kept for data still loading are picked up by UpdateAABB() on load
+    if (mData)
+        if (const int meshID = mData->GetMeshID(nameID); meshID != -1)
+            UpdateMeshBounds(meshID);
+}
+
+QVector4D Canavar::Engine::Model::GetMeshOverlayColor(int nameID) const
+{
+    const MeshOverride* meshOverride = FindMeshOverride(nameID);
+    return meshOverride ? meshOverride->overlayColor : QVector4D(0, 0, 0, 0);
+}
+
+void Canavar::Engine::Model::SetMeshOverlayColor(int nameID, const QVector4D& color)
+{
+    GetMeshOverride_Ref(nameID).overlayColor = color;
+}
+
+float Canavar::Engine::Model::GetMeshOverlayColorFactor(int nameID) const
+{
+    const MeshOverride* meshOverride = FindMeshOverride(nameID);
+    return meshOverride ? meshOverride->overlayColorFactor : 0.0f;
 }
 
-QVector4D Canavar::Engine::Model::GetMeshOverlayColor(const QString& meshName)
+void Canavar::Engine::Model::SetMeshOverlayColorFactor(int nameID, float factor)
 {
-    return mMeshOverlayColors.value(meshName, QVector4D(0, 0, 0, 0));
+    GetMeshOverride_Ref(nameID).overlayColorFactor = factor;
+}
+
+QMatrix4x4 Canavar::Engine::Model::GetMeshTransformation(const QString& meshName) const
+{
+    return GetMeshTransformation(NameRegistry::Instance()->Find(meshName));
+}
+
+void Canavar::Engine::Model::SetMeshTransformation(const QString& meshName, const QMatrix4x4& transformation)
+{
+    SetMeshTransformation(NameRegistry::Instance()->Intern(meshName), transformation);
+}
+
+QVector4D Canavar::Engine::Model::GetMeshOverlayColor(const QString& meshName) const
+{
+    return GetMeshOverlayColor(NameRegistry::Instance()->Find(meshName));
 }
 
 void Canavar::Engine::Model::SetMeshOverlayColor(const QString& meshName, const QVector4D& color)
 {
-    mMeshOverlayColors.insert(meshName, color);
+    SetMeshOverlayColor(NameRegistry::Instance()->Intern(meshName), color);
 }
 
-float Canavar::Engine::Model::GetMeshOverlayColorFactor(const QString& meshName)
+float Canavar::Engine::Model::GetMeshOverlayColorFactor(const QString& meshName) const
 {
-    return mMeshOverlayColorFactors.value(meshName, 0);
+    return GetMeshOverlayColorFactor(NameRegistry::Instance()->Find(meshName));
 }
 
 void Canavar::Engine::Model::SetMeshOverlayColorFactor(const QString& meshName, float factor)
 {
-    mMeshOverlayColorFactors.insert(meshName, factor);
+    SetMeshOverlayColorFactor(NameRegistry::Instance()->Intern(meshName), factor);
 }
 
-void Canavar::Engine::Model::Render(RenderMode renderMode)
+QMatrix4x4 Canavar::Engine::Model::GetMeshWorldTransformation(Mesh* mesh)
 {
+    QMatrix4x4 transformation = WorldTransformation();
+
     if (mData)
-        mData->Render(renderMode, this);
+        transformation *= mData->GetNodeTransformation(mesh);
+
+    return transformation * GetMeshOverride(mesh->GetID()).transformation;
 }
 
-void Canavar::Engine::Model::UpdateAABB()
+const Canavar::Engine::Model::MeshOverride* Canavar::Engine::Model::FindMeshOverride(int nameID) const
+{
+    if (nameID == NameRegistry::INVALID_ID)
+        return nullptr;
+
+    if (mData)
+    {
+        const int meshID = mData->GetMeshID(nameID);
+
+        if (meshID != -1)
+            return &GetMeshOverride(meshID);
+    }
+
+    const auto it = mPendingMeshOverrides.constFind(nameID);
+    return it != mPendingMeshOverrides.constEnd() ? &it.value() : nullptr;
+}
+
+Canavar::Engine::Model::MeshOverride& Canavar::Engine::Model::GetMeshOverride_Ref(int nameID)
 {
     if (mData)
     {
-        float inf = std::numeric_limits<float>::infinity();
-        QVector3D min(inf, inf, inf);
-        QVector3D max(-inf, -inf, -inf);
+        const int meshID = mData->GetMeshID(nameID);
 
-        for (const auto& mesh : mData->GetMeshes())
-        {
-            auto aabb = mesh->GetAABB().Transform(mMeshTransformations.value(mesh->GetName()));
+        if (0 <= meshID && meshID < mMeshOverrides.size())
+            return mMeshOverrides[meshID];
+    }
 
-            if (min[0] > aabb.GetMin().x())
-                min[0] = aabb.GetMin().x();
+    return mPendingMeshOverrides[nameID];
+}
 
-            if (min[1] > aabb.GetMin().y())
-                min[1] = aabb.GetMin().y();
+void Canavar::Engine::Model::ResolvePendingMeshOverrides()
+{
+    int size = 0;
 
-            if (min[2] > aabb.GetMin().z())
-                min[2] = aabb.GetMin().z();
+    for (const auto& mesh : mData->GetMeshes())
+        size = qMax(size, int(mesh->GetID()) + 1);
 
-            if (max[0] < aabb.GetMax().x())
-                max[0] = aabb.GetMax().x();
+    mMeshOverrides.resize(size);
 
-            if (max[1] < aabb.GetMax().y())
-                max[1] = aabb.GetMax().y();
+    for (auto it = mPendingMeshOverrides.begin(); it != mPendingMeshOverrides.end();)
+    {
+        const int meshID = mData->GetMeshID(it.key());
 
-            if (max[2] < aabb.GetMax().z())
-                max[2] = aabb.GetMax().z();
+        if (meshID != -1)
+        {
+            mMeshOverrides[meshID] = it.value();
+            it = mPendingMeshOverrides.erase(it);
         }
+        else
+            ++it;
+    }
+}
+
+void Canavar::Engine::Model::Render(RenderMode renderMode)
+{
+    if (mData)
+        mData->Render(renderMode, this);
+}
+
+void Canavar::Engine::Model::UpdateAABB()
+{
+    if (mData == nullptr)
+        return;
+
+    const auto& drawList = mData->GetDrawList();
+    mMeshBounds.resize(drawList.size());
+
+    for (int i = 0; i < drawList.size(); ++i)
+        mMeshBounds[i] = drawList[i].mesh->GetAABB().Transform(drawList[i].transformation * GetMeshOverride(drawList[i].mesh->GetID()).transformation);
+
+    MergeMeshBounds();
+}
+
+void Canavar::Engine::Model::UpdateMeshBounds(int meshID)
+{
+    if (mData == nullptr)
+        return;
+
+    const auto& drawList = mData->GetDrawList();
 
-        mAABB.SetMin(min);
-        mAABB.SetMax(max);
+    if (mMeshBounds.size() != drawList.size())
+    {
+        UpdateAABB();
+        return;
     }
+
+    const QMatrix4x4& transformation = GetMeshOverride(meshID).transformation;
+
+    for (int i = 0; i < drawList.size(); ++i)
+        if (int(drawList[i].mesh->GetID()) == meshID)
+            mMeshBounds[i] = drawList[i].mesh->GetAABB().Transform(drawList[i].transformation * transformation);
+
+    MergeMeshBounds();
+}
+
+void Canavar::Engine::Model::MergeMeshBounds()
+{
+    if (mMeshBounds.isEmpty())
+        return;
+
+    AABB aabb = mMeshBounds[0];
+
+    for (int i = 1; i < mMeshBounds.size(); ++i)
+        aabb.Merge(mMeshBounds[i]);
+
+    mAABB = aabb;
+    MarkBoundsDirty();
 }
 
 void Canavar::Engine::Model::ToJson(QJsonObject& object)
@@ -119,10 +269,11 @@ void Canavar::Engine::Model::ToJson(QJsonObject& object)
     object.insert("diffuse", mDiffuse);
     object.insert("specular", mSpecular);
     object.insert("shininess", mShininess);
+    object.insert("lod_bias", mLodBias);
     object.insert("model_name", mModelName);
 
     // TODO
-    // mMeshTransformations, mMeshOverlayColors, mMeshOverlayColorFactors
+    // mMeshOverrides, mPendingMeshOverrides
 }
 
 void Canavar::Engine::Model::FromJson(const QJsonObject& object)
@@ -154,5 +305,6 @@ void Canavar::Engine::Model::FromJson(const QJsonObject& object)
     mDiffuse = object["diffuse"].toDouble();
     mSpecular = object["specular"].toDouble();
     mShininess = object["shininess"].toDouble();
+    mLodBias = object["lod_bias"].toDouble(0.0);
     mModelName = object["model_name"].toString();
 }
\ No newline at end of file
@@ -0,0 +1,513 @@
+#include "ModelCache.h"
+#include "Config.h"
+#include "Helper.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <cstring>
+
+// File layout, all records are tightly packed and 4-byte aligned:
+// Header | MaterialRecord[] | MeshRecord[] | NodeRecord[] (pre-order) | quint32 meshIndices[] | strings | data
+// Strings are stored as quint32 length + UTF-8 bytes. Data holds raw Mesh::Vertex, unsigned int and Mesh::Lod arrays.
+namespace {
+    constexpr char MAGIC[4] = { 'C', 'N', 'V', 'M' };
+    constexpr int NUMBER_OF_TEXTURE_TYPES = 4;
+
+    struct Header {
+        char magic[4];
+        quint32 version;
+        quint32 importerFlags;
+        quint32 vertexSize;
+        quint32 compactVertexFormat;
+        quint32 numberOfMaterials;
+        quint32 numberOfMeshes;
+        quint32 numberOfNodes;
+        quint32 numberOfMeshIndices;
+        char sourceHash[20];
+        float aabbMin[3];
+        float aabbMax[3];
+        quint64 stringsOffset;
+        quint64 dataOffset;
+    };
+
+    struct MaterialRecord {
+        qint32 texturePaths[NUMBER_OF_TEXTURE_TYPES]; // Relative to the model directory, -1 if empty
+    };
+
+    struct MeshRecord {
+        quint64 verticesOffset; // Relative to Header::dataOffset
+        quint64 indicesOffset;
+        quint32 numberOfVertices;
+        quint32 numberOfIndices;
+        qint32 materialIndex;
+        quint32 name;
+        quint32 id;
+        quint32 compactVertices;
+        float aabbMin[3];
+        float aabbMax[3];
+        quint64 lodIndicesOffset;
+        quint64 lodsOffset;
+        quint32 numberOfLodIndices;
+        quint32 numberOfLods;
+    };
+
+    struct NodeRecord {
+        quint32 name;
+        quint32 numberOfChildren;
+        quint32 firstMeshIndex;
+        quint32 numberOfMeshIndices;
+        float transformation[16];
+    };
+
+    static_assert(sizeof(Header) == 96, "Header must be tightly packed");
+    static_assert(sizeof(MaterialRecord) == 16, "MaterialRecord must be tightly packed");
+    static_assert(sizeof(MeshRecord) == 88, "MeshRecord must be tightly packed");
+    static_assert(sizeof(Canavar::Engine::Mesh::Lod) == 12, "Mesh::Lod must be tightly packed");
+    static_assert(sizeof(NodeRecord) == 80, "NodeRecord must be tightly packed");
+
+    constexpr Canavar::Engine::Material::TextureType TEXTURE_TYPES[NUMBER_OF_TEXTURE_TYPES] = {
+        Canavar::Engine::Material::TextureType::Ambient,
+        Canavar::Engine::Material::TextureType::Diffuse,
+        Canavar::Engine::Material::TextureType::Specular,
+        Canavar::Engine::Material::TextureType::Normal,
+    };
+
+    void Align(QByteArray& bytes, int alignment)
+    {
+        while (bytes.size() % alignment)
+            bytes.append('\0');
+    }
+
+    quint32 AddString(QByteArray& strings, const QString& string)
+    {
+        const quint32 offset = strings.size();
+        const QByteArray utf8 = string.toUtf8();
+        const quint32 length = utf8.size();
+
+        strings.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        strings.append(utf8);
+        Align(strings, 4);
+
+        return offset;
+    }
+
+    template<typename T>
+    void Append(QByteArray& bytes, const QVector<T>& values)
+    {
+        bytes.append(reinterpret_cast<const char*>(values.constData()), values.size() * sizeof(T));
+    }
+
+    void WriteNode(Canavar::Engine::ModelDataNode* node, QByteArray& strings, QVector<NodeRecord>& nodes, QVector<quint32>& meshIndices)
+    {
+        QList<Canavar::Engine::ModelDataNode*> children;
+
+        for (const auto& child : node->GetChildren())
+            if (auto modelDataNode = dynamic_cast<Canavar::Engine::ModelDataNode*>(child))
+                children << modelDataNode;
+
+        NodeRecord record;
+        record.name = AddString(strings, node->GetName());
+        record.numberOfChildren = children.size();
+        record.firstMeshIndex = meshIndices.size();
+        record.numberOfMeshIndices = node->GetMeshIndices().size();
+        memcpy(record.transformation, node->Transformation().constData(), sizeof(record.transformation));
+
+        for (auto index : node->GetMeshIndices())
+            meshIndices << quint32(index);
+
+        nodes << record;
+
+        for (const auto& child : children)
+            WriteNode(child, strings, nodes, meshIndices);
+    }
+
+    // Bounds checked view over the mapped file
+    class Reader
+    {
+    public:
+        Reader(const uchar* memory, qint64 size)
+            : mMemory(memory)
+            , mSize(size)
+        {}
+
+        bool Contains(quint64 offset, quint64 length) const { return offset <= quint64(mSize) && length <= quint64(mSize) - offset; }
+
+        template<typename T>
+        const T* At(quint64 offset) const
+        {
+            return reinterpret_cast<const T*>(mMemory + offset);
+        }
+
+        bool ReadString(quint64 stringsOffset, quint32 offset, QString& string) const
+        {
+            if (!Contains(stringsOffset + offset, sizeof(quint32)))
+                return false;
+
+            const quint32 length = *At<quint32>(stringsOffset + offset);
+
+            if (!Contains(stringsOffset + offset + sizeof(quint32), length))
+                return false;
+
+            string = QString::fromUtf8(At<char>(stringsOffset + offset + sizeof(quint32)), length);
+            return true;
+        }
+
+    private:
+        const uchar* mMemory;
+        qint64 mSize;
+    };
+} // namespace
+
+Canavar::Engine::ModelData* Canavar::Engine::ModelCache::Load(const QString& name, const QString& sourcePath)
+{
+    const QString cachePath = GetCachePath(name, sourcePath);
+
+    if (cachePath.isEmpty())
+        return nullptr;
+
+    QFile file(cachePath);
+
+    if (!file.exists() || !file.open(QIODevice::ReadOnly))
+        return nullptr;
+
+    const qint64 size = file.size();
+
+    if (size < qint64(sizeof(Header)))
+        return nullptr;
+
+    const uchar* memory = file.map(0, size);
+
+    if (!memory)
+    {
+        qWarning() << Q_FUNC_INFO << "Could not map" << cachePath;
+        return nullptr;
+    }
+
+    const Reader reader(memory, size);
+    const Header* header = reader.At<Header>(0);
+
+    // Key
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||                                          //
+        header->version != VERSION ||                                                                //
+        header->importerFlags != Helper::IMPORTER_FLAGS ||                                           //
+        header->vertexSize != sizeof(Mesh::Vertex) ||                                                //
+        header->compactVertexFormat != quint32(Config::Instance()->GetCompactVertexFormat()) ||      //
+        QByteArray(header->sourceHash, sizeof(header->sourceHash)) != CalculateSourceHash(sourcePath))
+    {
+        qInfo() << "Model cache at" << cachePath << "is out of date.";
+        return nullptr;
+    }
+
+    // Structure
+    const quint64 materialsOffset = sizeof(Header);
+    const quint64 meshesOffset = materialsOffset + quint64(header->numberOfMaterials) * sizeof(MaterialRecord);
+    const quint64 nodesOffset = meshesOffset + quint64(header->numberOfMeshes) * sizeof(MeshRecord);
+    const quint64 meshIndicesOffset = nodesOffset + quint64(header->numberOfNodes) * sizeof(NodeRecord);
+    const quint64 recordsEnd = meshIndicesOffset + quint64(header->numberOfMeshIndices) * sizeof(quint32);
+
+    bool valid = header->numberOfNodes > 0 && recordsEnd <= header->stringsOffset && header->stringsOffset <= header->dataOffset && reader.Contains(header->dataOffset, 0);
+
+    const MaterialRecord* materials = reader.At<MaterialRecord>(materialsOffset);
+    const MeshRecord* meshes = reader.At<MeshRecord>(meshesOffset);
+    const NodeRecord* nodes = reader.At<NodeRecord>(nodesOffset);
+    const quint32* meshIndices = reader.At<quint32>(meshIndicesOffset);
+
+    for (quint32 i = 0; valid && i < header->numberOfMeshes; ++i)
+    {
+        const MeshRecord& mesh = meshes[i];
+        valid &= reader.Contains(header->dataOffset + mesh.verticesOffset, quint64(mesh.numberOfVertices) * sizeof(Mesh::Vertex));
+        valid &= reader.Contains(header->dataOffset + mesh.indicesOffset, quint64(mesh.numberOfIndices) * sizeof(unsigned int));
+        valid &= reader.Contains(header->dataOffset + mesh.lodIndicesOffset, quint64(mesh.numberOfLodIndices) * sizeof(unsigned int));
+        valid &= reader.Contains(header->dataOffset + mesh.lodsOffset, quint64(mesh.numberOfLods) * sizeof(Mesh::Lod));
+
+        for (quint32 j = 0; valid && j < mesh.numberOfLods; ++j)
+        {
+            const Mesh::Lod& lod = reader.At<Mesh::Lod>(header->dataOffset + mesh.lodsOffset)[j];
+            valid &= quint64(lod.firstIndex) + lod.numberOfIndices <= mesh.numberOfLodIndices;
+        }
+        valid &= 0 <= mesh.materialIndex && quint32(mesh.materialIndex) < header->numberOfMaterials;
+    }
+
+    // Pre-order nodes must form exactly one tree
+    qint64 openChildren = 1;
+
+    for (quint32 i = 0; valid && i < header->numberOfNodes; ++i)
+    {
+        valid &= openChildren > 0;
+        openChildren += qint64(nodes[i].numberOfChildren) - 1;
+        valid &= quint64(nodes[i].firstMeshIndex) + nodes[i].numberOfMeshIndices <= header->numberOfMeshIndices;
+    }
+
+    valid &= openChildren == 0;
+
+    for (quint32 i = 0; valid && i < header->numberOfMeshIndices; ++i)
+        valid &= meshIndices[i] < header->numberOfMeshes;
+
+    if (!valid)
+    {
+        qWarning() << Q_FUNC_INFO << "Model cache at" << cachePath << "is corrupt.";
+        file.unmap(const_cast<uchar*>(memory));
+        return nullptr;
+    }
+
+    const QString directory = sourcePath.left(sourcePath.lastIndexOf("/"));
+
+    ModelData* data = new ModelData(name);
+
+    // Materials
+    for (quint32 i = 0; i < header->numberOfMaterials; ++i)
+    {
+        Material* material = new Material;
+
+        for (int j = 0; j < NUMBER_OF_TEXTURE_TYPES; ++j)
+        {
+            QString path;
+
+            if (materials[i].texturePaths[j] < 0 || !reader.ReadString(header->stringsOffset, materials[i].texturePaths[j], path))
+                continue;
+
+            path = directory + "/" + path;
+
+            if (QImage image = Helper::DecodeImage(path); !image.isNull())
+                material->InsertImage(TEXTURE_TYPES[j], image, path);
+        }
+
+        data->AddMaterial(material);
+    }
+
+    // Meshes, vertex and index arrays are copied straight out of the mapping
+    for (quint32 i = 0; i < header->numberOfMeshes; ++i)
+    {
+        const MeshRecord& record = meshes[i];
+
+        QString meshName;
+        reader.ReadString(header->stringsOffset, record.name, meshName);
+
+        AABB aabb;
+        aabb.SetMin(QVector3D(record.aabbMin[0], record.aabbMin[1], record.aabbMin[2]));
+        aabb.SetMax(QVector3D(record.aabbMax[0], record.aabbMax[1], record.aabbMax[2]));
+
+        Mesh* mesh = new Mesh;
+        mesh->SetVertices(reader.At<Mesh::Vertex>(header->dataOffset + record.verticesOffset), record.numberOfVertices);
+        mesh->SetIndices(reader.At<unsigned int>(header->dataOffset + record.indicesOffset), record.numberOfIndices);
+
+        const auto lodIndices = reader.At<unsigned int>(header->dataOffset + record.lodIndicesOffset);
+        const auto lods = reader.At<Mesh::Lod>(header->dataOffset + record.lodsOffset);
+        mesh->SetLods(QVector<unsigned int>(lodIndices, lodIndices + record.numberOfLodIndices), QVector<Mesh::Lod>(lods, lods + record.numberOfLods));
+        mesh->SetName(meshName);
+        mesh->SetID(record.id);
+        mesh->SetCompactVertices(record.compactVertices);
+        mesh->SetAABB(aabb);
+        mesh->SetMaterial(data->GetMaterial(record.materialIndex));
+        data->AddMesh(mesh);
+    }
+
+    // Nodes
+    ModelDataNode* root = nullptr;
+    QVector<QPair<ModelDataNode*, quint32>> parents; // Node -> number of children still to attach
+
+    for (quint32 i = 0; i < header->numberOfNodes; ++i)
+    {
+        const NodeRecord& record = nodes[i];
+
+        QString nodeName;
+        reader.ReadString(header->stringsOffset, record.name, nodeName);
+
+        ModelDataNode* node = new ModelDataNode(data);
+        node->SetName(nodeName);
+        node->SetTransformation(QMatrix4x4(record.transformation).transposed());
+
+        for (quint32 j = 0; j < record.numberOfMeshIndices; ++j)
+            node->AddMeshIndex(meshIndices[record.firstMeshIndex + j]);
+
+        if (parents.isEmpty())
+            root = node;
+        else
+        {
+            parents.last().first->AddChild(node);
+
+            if (--parents.last().second == 0)
+                parents.removeLast();
+        }
+
+        if (record.numberOfChildren > 0)
+            parents << qMakePair(node, record.numberOfChildren);
+    }
+
+    data->SetRootNode(root);
+    data->BuildDrawList();
+
+    AABB aabb;
+    aabb.SetMin(QVector3D(header->aabbMin[0], header->aabbMin[1], header->aabbMin[2]));
+    aabb.SetMax(QVector3D(header->aabbMax[0], header->aabbMax[1], header->aabbMax[2]));
+    data->SetAABB(aabb);
+
+    file.unmap(const_cast<uchar*>(memory));
+
+    return data;
+}
+
+bool Canavar::Engine::ModelCache::Save(ModelData* data, const QString& sourcePath)
+{
+    const QString cachePath = GetCachePath(data->GetName(), sourcePath);
+
+    if (cachePath.isEmpty() || data->GetRootNode() == nullptr)
+        return false;
+
+    const QByteArray hash = CalculateSourceHash(sourcePath);
+
+    if (hash.isEmpty())
+        return false;
+
+    const QDir directory(sourcePath.left(sourcePath.lastIndexOf("/")));
+    const auto& materials = data->GetMaterials();
+
+    QByteArray strings;
+    QByteArray payload;
+
+    QVector<MaterialRecord> materialRecords;
+
+    for (const auto& material : materials)
+    {
+        MaterialRecord record;
+
+        for (int j = 0; j < NUMBER_OF_TEXTURE_TYPES; ++j)
+        {
+            const QString path = material->GetPath(TEXTURE_TYPES[j]);
+            record.texturePaths[j] = path.isEmpty() ? -1 : qint32(AddString(strings, directory.relativeFilePath(path)));
+        }
+
+        materialRecords << record;
+    }
+
+    QVector<MeshRecord> meshRecords;
+
+    for (const auto& mesh : data->GetMeshes())
+    {
+        MeshRecord record;
+        record.name = AddString(strings, mesh->GetName());
+        record.id = mesh->GetID();
+        record.compactVertices = mesh->GetCompactVertices();
+        record.materialIndex = materials.indexOf(mesh->GetMaterial());
+        record.numberOfVertices = mesh->GetVertices().size();
+        record.numberOfIndices = mesh->GetIndices().size();
+        record.numberOfLodIndices = mesh->GetLodIndices().size();
+        record.numberOfLods = mesh->GetLods().size();
+
+        for (int k = 0; k < 3; ++k)
+        {
+            record.aabbMin[k] = mesh->GetAABB().GetMin()[k];
+            record.aabbMax[k] = mesh->GetAABB().GetMax()[k];
+        }
+
+        Align(payload, 8);
+        record.verticesOffset = payload.size();
+        Append(payload, mesh->GetVertices());
+
+        Align(payload, 8);
+        record.indicesOffset = payload.size();
+        Append(payload, mesh->GetIndices());
+
+        Align(payload, 8);
+        record.lodIndicesOffset = payload.size();
+        Append(payload, mesh->GetLodIndices());
+
+        Align(payload, 8);
+        record.lodsOffset = payload.size();
+        Append(payload, mesh->GetLods());
+
+        meshRecords << record;
+    }
+
+    QVector<NodeRecord> nodeRecords;
+    QVector<quint32> meshIndices;
+    WriteNode(data->GetRootNode(), strings, nodeRecords, meshIndices);
+
+    Header header;
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.importerFlags = Helper::IMPORTER_FLAGS;
+    header.vertexSize = sizeof(Mesh::Vertex);
+    header.compactVertexFormat = Config::Instance()->GetCompactVertexFormat();
+    header.numberOfMaterials = materialRecords.size();
+    header.numberOfMeshes = meshRecords.size();
+    header.numberOfNodes = nodeRecords.size();
+    header.numberOfMeshIndices = meshIndices.size();
+    memcpy(header.sourceHash, hash.constData(), qMin(hash.size(), int(sizeof(header.sourceHash))));
+
+    for (int k = 0; k < 3; ++k)
+    {
+        header.aabbMin[k] = data->GetAABB().GetMin()[k];
+        header.aabbMax[k] = data->GetAABB().GetMax()[k];
+    }
+
+    QByteArray bytes;
+    bytes.append(reinterpret_cast<const char*>(&header), sizeof(Header));
+    Append(bytes, materialRecords);
+    Append(bytes, meshRecords);
+    Append(bytes, nodeRecords);
+    Append(bytes, meshIndices);
+
+    header.stringsOffset = bytes.size();
+    bytes.append(strings);
+    Align(bytes, 8);
+
+    header.dataOffset = bytes.size();
+    bytes.append(payload);
+
+    // Offsets are known only now
+    memcpy(bytes.data(), &header, sizeof(Header));
+
+    QDir().mkpath(QFileInfo(cachePath).path());
+
+    QSaveFile file(cachePath);
+
+    if (!file.open(QIODevice::WriteOnly) || file.write(bytes) != bytes.size() || !file.commit())
+    {
+        qWarning() << Q_FUNC_INFO << "Could not write model cache to" << cachePath;
+        return false;
+    }
+
+    return true;
+}
+
+QString Canavar::Engine::ModelCache::GetCachePath(const QString& name, const QString& sourcePath)
+{
+    const QString folder = Config::Instance()->GetModelCacheFolder();
+
+    if (folder.isEmpty())
+        return QString();
+
+    return folder + "/" + name + "/" + QFileInfo(sourcePath).fileName() + ".cache";
+}
+
+QByteArray Canavar::Engine::ModelCache::CalculateSourceHash(const QString& sourcePath)
+{
+    QFile file(sourcePath);
+
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(&file);
+
+    // Companion files (.mtl, .bin, ...) change the import result too, their size and time stamp is enough
+    const QFileInfo info(sourcePath);
+    const auto siblings = info.dir().entryInfoList(QDir::Files, QDir::Name);
+
+    for (const auto& sibling : siblings)
+    {
+        if (sibling.fileName() == info.fileName())
+            continue;
+
+        hash.addData(sibling.fileName().toUtf8());
+        hash.addData(QByteArray::number(sibling.size()));
+        hash.addData(QByteArray::number(sibling.lastModified().toMSecsSinceEpoch()));
+    }
+
+    return hash.result();
+}
@@ -4,16 +4,35 @@ Canavar::Engine::ModelData::ModelData(const QString& name)
     : QObject()
     , mName(name)
     , mRootNode(nullptr)
-{}
+    , mReferenceCount(0)
+    , mResident(false)
+    , mLastRenderedFrame(0)
+{
+    mLodErrors << 0.0f;
+}
 
 Canavar::Engine::ModelData::~ModelData()
 {
-    // TODO
+    qDeleteAll(mMeshes);
+    qDeleteAll(mMaterials);
+
+    QList<Node*> nodes;
+
+    if (mRootNode)
+        nodes << mRootNode;
+
+    while (!nodes.isEmpty())
+    {
+        Node* node = nodes.takeLast();
+        nodes << node->GetChildren();
+        delete node;
+    }
 }
 
 void Canavar::Engine::ModelData::AddMesh(Mesh* mesh)
 {
     mMeshes << mesh;
+    mMeshIDs.insert(mesh->GetNameID(), mesh->GetID());
 }
 
 void Canavar::Engine::ModelData::AddMaterial(Material* material)
@@ -40,6 +59,11 @@ Canavar::Engine::Mesh* Canavar::Engine::ModelData::GetMeshByID(unsigned int id)
     return nullptr;
 }
 
+int Canavar::Engine::ModelData::GetMeshID(int nameID) const
+{
+    return mMeshIDs.value(nameID, -1);
+}
+
 const QString& Canavar::Engine::ModelData::GetName() const
 {
     return mName;
@@ -50,7 +74,217 @@ const QVector<Canavar::Engine::Mesh*>& Canavar::Engine::ModelData::GetMeshes() c
     return mMeshes;
 }
 
+const QVector<Canavar::Engine::Material*>& Canavar::Engine::ModelData::GetMaterials() const
+{
+    return mMaterials;
+}
+
+Canavar::Engine::ModelDataNode* Canavar::Engine::ModelData::GetRootNode() const
+{
+    return mRootNode;
+}
+
+void Canavar::Engine::ModelData::BuildDrawList()
+{
+    mDrawList.clear();
+    mLodErrors = { 0.0f };
+
+    if (mRootNode == nullptr)
+        return;
+
+    // Pre-order, same as the recursive traversal it replaces
+    QList<QPair<ModelDataNode*, QMatrix4x4>> nodes;
+    nodes << qMakePair(mRootNode, mRootNode->Transformation());
+
+    while (!nodes.isEmpty())
+    {
+        const auto [node, transformation] = nodes.takeLast();
+
+        for (auto index : node->GetMeshIndices())
+        {
+            if (index < 0 || index >= mMeshes.size())
+                continue;
+
+            DrawEntry entry;
+            entry.meshIndex = index;
+            entry.mesh = mMeshes[index];
+            entry.transformation = transformation;
+            mDrawList << entry;
+        }
+
+        const auto& children = node->GetChildren();
+
+        for (int i = children.size() - 1; i >= 0; --i)
+            if (auto child = dynamic_cast<ModelDataNode*>(children[i]))
+                nodes << qMakePair(child, transformation * child->Transformation());
+    }
+
+    int numberOfLods = 1;
+
+    for (const auto& entry : qAsConst(mDrawList))
+        numberOfLods = qMax(numberOfLods, entry.mesh->GetNumberOfLods());
+
+    mLodErrors.resize(numberOfLods);
+
+    // Meshes with fewer levels stay at their coarsest one
+    for (const auto& entry : qAsConst(mDrawList))
+    {
+        float scale = 0.0f;
+
+        for (int column = 0; column < 3; ++column)
+            scale = qMax(scale, entry.transformation.column(column).toVector3D().length());
+
+        for (int lod = 1; lod < numberOfLods; ++lod)
+            mLodErrors[lod] = qMax(mLodErrors[lod], scale * entry.mesh->GetLodError(lod));
+    }
+}
+
+int Canavar::Engine::ModelData::GetNumberOfLods() const
+{
+    return mLodErrors.size();
+}
+
+float Canavar::Engine::ModelData::GetLodError(int lod) const
+{
+    return mLodErrors[qBound(0, lod, mLodErrors.size() - 1)];
+}
+
+const QVector<Canavar::Engine::ModelData::DrawEntry>& Canavar::Engine::ModelData::GetDrawList() const
+{
+    return mDrawList;
+}
+
+QMatrix4x4 Canavar::Engine::ModelData::GetNodeTransformation(Mesh* mesh) const
+{
+    for (const auto& entry : mDrawList)
+        if (entry.mesh == mesh)
+            return entry.transformation;
+
+    return QMatrix4x4();
+}
+
 void Canavar::Engine::ModelData::Render(RenderModes modes, Model* model)
 {
-    mRootNode->Render(modes, model);
+    for (const auto& entry : qAsConst(mDrawList))
+        entry.mesh->Render(modes, model, entry.transformation);
+}
+
+void Canavar::Engine::ModelData::MoveToThread(QThread* thread)
+{
+    moveToThread(thread);
+
+    for (const auto& mesh : qAsConst(mMeshes))
+        mesh->moveToThread(thread);
+
+    for (const auto& material : qAsConst(mMaterials))
+        material->moveToThread(thread);
+
+    QList<Node*> nodes;
+
+    if (mRootNode)
+        nodes << mRootNode;
+
+    while (!nodes.isEmpty())
+    {
+        Node* node = nodes.takeLast();
+        node->moveToThread(thread);
+        nodes << node->GetChildren();
+    }
+}
+
+void Canavar::Engine::ModelData::CreateGPUResources()
+{
+    if (mResident)
+        return;
+
+    const QString owner = "Model: " + mName;
+
+    for (const auto& material : qAsConst(mMaterials))
+        material->CreateTextures(owner);
+
+    for (const auto& mesh : qAsConst(mMeshes))
+        mesh->Create(owner);
+
+    mResident = true;
+}
+
+void Canavar::Engine::ModelData::DestroyGPUResources()
+{
+    if (!mResident)
+        return;
+
+    for (const auto& material : qAsConst(mMaterials))
+        material->DestroyTextures();
+
+    for (const auto& mesh : qAsConst(mMeshes))
+        mesh->Destroy();
+
+    mResident = false;
+}
+
+bool Canavar::Engine::ModelData::IsResident() const
+{
+    return mResident;
+}
+
+bool Canavar::Engine::ModelData::IsInArena() const
+{
+    for (const auto& mesh : mMeshes)
+        if (!mesh->IsInArena())
+            return false;
+
+    return true;
+}
+
+qint64 Canavar::Engine::ModelData::GetGPUMemorySize() const
+{
+    qint64 size = 0;
+
+    for (const auto& material : mMaterials)
+        size += material->GetGPUMemorySize();
+
+    for (const auto& mesh : mMeshes)
+        size += mesh->GetGPUMemorySize();
+
+    return size;
+}
+
+void Canavar::Engine::ModelData::ReleaseCPUData(MeshDataPolicy policy)
+{
+    for (const auto& mesh : qAsConst(mMeshes))
+        mesh->ReleaseCPUData(policy);
+}
+
+bool Canavar::Engine::ModelData::HasCPUData() const
+{
+    for (const auto& mesh : mMeshes)
+        if (!mesh->HasCPUData())
+            return false;
+
+    return true;
+}
+
+qint64 Canavar::Engine::ModelData::GetCPUMemorySize() const
+{
+    qint64 size = 0;
+
+    for (const auto& mesh : mMeshes)
+        size += mesh->GetCPUMemorySize();
+
+    return size;
+}
+
+void Canavar::Engine::ModelData::AddReference()
+{
+    mReferenceCount++;
+}
+
+void Canavar::Engine::ModelData::RemoveReference()
+{
+    mReferenceCount--;
+}
+
+int Canavar::Engine::ModelData::GetReferenceCount() const
+{
+    return mReferenceCount;
 }
\ No newline at end of file
@@ -1,13 +1,37 @@
 #include "ModelDataManager.h"
 #include "Config.h"
 #include "Helper.h"
+#include "ModelCache.h"
 
 #include <QDir>
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include <algorithm>
 
 Canavar::Engine::ModelDataManager::ModelDataManager()
     : Manager()
+    , mLazyModelLoading(false)
+    , mNumberOfPendingModels(0)
+    , mNumberOfCacheHits(0)
+    , mNumberOfCacheMisses(0)
+    , mFrameIndex(0)
+    , mGPUMemoryBudget(0)
+    , mResidentGPUMemory(0)
+    , mNumberOfResidentModels(0)
+    , mNumberOfEvictions(0)
+    , mNumberOfReloads(0)
+    , mReleasedCPUMemory(0)
 {}
 
+Canavar::Engine::ModelDataManager::~ModelDataManager()
+{
+    // The tasks write to the upload queue of this manager
+    for (auto &task : mImportTasks)
+        task.waitForFinished();
+}
+
 Canavar::Engine::ModelDataManager *Canavar::Engine::ModelDataManager::Instance()
 {
     static ModelDataManager instance;
@@ -17,16 +41,84 @@ Canavar::Engine::ModelDataManager *Canavar::Engine::ModelDataManager::Instance()
 
 bool Canavar::Engine::ModelDataManager::Init()
 {
-    LoadModels(Config::Instance()->GetModelsRootFolder(), Config::Instance()->GetSupportedModelFormats());
+    mLazyModelLoading = Config::Instance()->GetLazyModelLoading();
+    mGPUMemoryBudget = qint64(Config::Instance()->GetGPUMemoryBudget()) * 1024 * 1024;
 
-    mModelNames = mModelsData.keys();
+    ScanModels(Config::Instance()->GetModelsRootFolder(), Config::Instance()->GetSupportedModelFormats());
+
+    if (!mLazyModelLoading)
+        LoadModels();
 
     return true;
 }
 
+void Canavar::Engine::ModelDataManager::Update(float)
+{
+    mFrameIndex++;
+
+    ProcessUploadQueue(false);
+    EvictUnusedModels();
+}
+
 Canavar::Engine::ModelData *Canavar::Engine::ModelDataManager::GetModelData(const QString &modelName)
 {
-    return mModelsData.value(modelName, nullptr);
+    auto data = mModelsData.value(modelName, nullptr);
+
+    if (data && data->IsResident())
+        return data;
+
+    // Evicted data is always reloaded
+    if (mLazyModelLoading || data)
+        RequestModelData(modelName);
+
+    return nullptr;
+}
+
+void Canavar::Engine::ModelDataManager::RequestModelData(const QString &modelName)
+{
+    if (mRequestedModels.contains(modelName))
+        return;
+
+    mRequestedModels.insert(modelName);
+
+    const QString path = mModelPaths.value(modelName);
+
+    if (path.isEmpty())
+    {
+        qWarning() << Q_FUNC_INFO << "There is no model named" << modelName;
+        return;
+    }
+
+    mNumberOfPendingModels++;
+
+    mImportTasks.removeIf([](const QFuture<void> &task) { return task.isFinished(); });
+
+    if (auto data = mModelsData.value(modelName, nullptr))
+    {
+        // Nothing uses evicted data, it is safe to touch it on a worker thread
+        mImportTasks << QtConcurrent::run([=]() {
+            ImportResult result;
+            result.name = modelName;
+            result.path = path;
+            result.data = Reload(data, modelName, path) ? data : nullptr;
+            result.fromCache = false;
+            result.reload = true;
+
+            QMutexLocker locker(&mUploadMutex);
+            mUploadQueue.enqueue(result);
+            mUploadCondition.wakeOne();
+        });
+
+        return;
+    }
+
+    mImportTasks << QtConcurrent::run([=]() {
+        ImportResult result = Import(modelName, path);
+
+        QMutexLocker locker(&mUploadMutex);
+        mUploadQueue.enqueue(result);
+        mUploadCondition.wakeOne();
+    });
 }
 
 const QStringList &Canavar::Engine::ModelDataManager::GetModelNames() const
@@ -34,9 +126,29 @@ const QStringList &Canavar::Engine::ModelDataManager::GetModelNames() const
     return mModelNames;
 }
 
-void Canavar::Engine::ModelDataManager::LoadModels(const QString &path, const QStringList &formats)
+void Canavar::Engine::ModelDataManager::MarkRendered(ModelData *data)
 {
-    qInfo() << "Loading and creating all models at" << path << "whose extensions are" << formats;
+    data->SetLastRenderedFrame(mFrameIndex);
+}
+
+qint64 Canavar::Engine::ModelDataManager::GetCPUMeshMemory() const
+{
+    qint64 size = 0;
+
+    for (const auto &data : mModelsData)
+        size += data->GetCPUMemorySize();
+
+    return size;
+}
+
+void Canavar::Engine::ModelDataManager::AddResidentGPUMemory(qint64 bytes)
+{
+    mResidentGPUMemory += bytes;
+}
+
+void Canavar::Engine::ModelDataManager::ScanModels(const QString &path, const QStringList &formats)
+{
+    qInfo() << "Scanning models at" << path << "whose extensions are" << formats;
 
     QDir dir(path);
     auto dirs = dir.entryList(QDir::AllDirs | QDir::NoDotAndDotDot);
@@ -47,28 +159,199 @@ void Canavar::Engine::ModelDataManager::LoadModels(const QString &path, const QS
         childDir.setNameFilters(formats);
         auto files = childDir.entryList(QDir::AllEntries | QDir::NoDotAndDotDot);
 
+        // A model is named after its folder
         for (const auto &file : qAsConst(files))
-        {
-            auto path = childDir.path() + "/" + file;
+            mModelPaths.insert(dirName, childDir.path() + "/" + file);
+    }
+
+    mModelNames = mModelPaths.keys();
 
-            qInfo() << "Loading model" << dirName << "at" << path;
+    qInfo() << mModelNames.size() << "models are found at" << path;
+}
+
+void Canavar::Engine::ModelDataManager::LoadModels()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // One task per model, results come back through the upload queue
+    for (const auto &name : qAsConst(mModelNames))
+        RequestModelData(name);
 
-            ModelData *data = Canavar::Engine::Helper::LoadModel(dirName, path);
+    qInfo() << mNumberOfPendingModels << "models are being imported on" << QThreadPool::globalInstance()->maxThreadCount() << "threads.";
 
-            if (data)
-            {
-                auto meshes = data->GetMeshes();
+    ProcessUploadQueue(true);
 
-                for (auto mesh : meshes)
-                    mesh->Create();
+    qInfo() << "All models are loaded in" << timer.elapsed() << "ms." << mNumberOfCacheHits << "models are read from the cache," << mNumberOfCacheMisses << "are imported.";
+}
+
+void Canavar::Engine::ModelDataManager::ProcessUploadQueue(bool wait)
+{
+    // GL objects can only be created here, upload models as soon as they are imported
+    while (mNumberOfPendingModels > 0)
+    {
+        mUploadMutex.lock();
 
-                mModelsData.insert(data->GetName(), data);
+        if (wait)
+            while (mUploadQueue.isEmpty())
+                mUploadCondition.wait(&mUploadMutex);
 
-                qInfo() << "Model" << dirName << "at" << path << "is loaded.";
-            } else
-                qWarning() << "Model" << dirName << "at" << path << "could not be loaded.";
+        if (mUploadQueue.isEmpty())
+        {
+            mUploadMutex.unlock();
+            return;
         }
+
+        ImportResult result = mUploadQueue.dequeue();
+        mUploadMutex.unlock();
+
+        mNumberOfPendingModels--;
+
+        Upload(result);
     }
+}
 
-    qInfo() << "All models are loaded at" << path;
+Canavar::Engine::ModelDataManager::ImportResult Canavar::Engine::ModelDataManager::Import(const QString &name, const QString &path)
+{
+    qInfo() << "Loading model" << name << "at" << path;
+
+    ImportResult result;
+    result.name = name;
+    result.path = path;
+    result.data = ModelCache::Load(name, path);
+    result.fromCache = result.data != nullptr;
+    result.reload = false;
+
+    if (!result.data)
+    {
+        result.data = Canavar::Engine::Helper::LoadModel(name, path);
+
+        if (result.data)
+            ModelCache::Save(result.data, path);
+    }
+
+    // Objects are created on this pool thread, hand them over to the context thread
+    if (result.data)
+        result.data->MoveToThread(thread());
+
+    return result;
+}
+
+bool Canavar::Engine::ModelDataManager::Reload(ModelData *data, const QString &name, const QString &path)
+{
+    // The meshes kept their CPU copies, only the images are gone
+    if (data->HasCPUData())
+    {
+        for (const auto &material : data->GetMaterials())
+            material->DecodeImages();
+
+        return true;
+    }
+
+    // The copies were released after upload and the buffers are gone, import the model again and take its data
+    ModelData *source = ModelCache::Load(name, path);
+
+    if (!source)
+        source = Helper::LoadModel(name, path);
+
+    const bool valid = source && source->GetMeshes().size() == data->GetMeshes().size() && source->GetMaterials().size() == data->GetMaterials().size();
+
+    if (valid)
+    {
+        for (int i = 0; i < data->GetMeshes().size(); ++i)
+            data->GetMeshes()[i]->TakeCPUData(source->GetMeshes()[i]);
+
+        for (int i = 0; i < data->GetMaterials().size(); ++i)
+            data->GetMaterials()[i]->TakeImages(source->GetMaterials()[i]);
+    } else
+        qWarning() << Q_FUNC_INFO << "Model" << name << "at" << path << "does not match its evicted data anymore.";
+
+    delete source;
+
+    return valid;
+}
+
+void Canavar::Engine::ModelDataManager::Upload(const ImportResult &result)
+{
+    if (!result.data)
+    {
+        qWarning() << "Model" << result.name << "at" << result.path << "could not be loaded.";
+        return;
+    }
+
+    result.data->CreateGPUResources();
+    result.data->SetLastRenderedFrame(mFrameIndex);
+
+    const auto policy = Config::Instance()->GetMeshDataPolicy(result.name);
+
+    if (policy != MeshDataPolicy::Keep)
+    {
+        const qint64 before = result.data->GetCPUMemorySize();
+        const qint64 rssBefore = Helper::GetResidentSetSize();
+
+        result.data->ReleaseCPUData(policy);
+
+        const qint64 rssAfter = Helper::GetResidentSetSize();
+
+        mReleasedCPUMemory += before - result.data->GetCPUMemorySize();
+
+        qInfo() << "CPU mesh data of model" << result.name << "is released." //
+                << "RSS" << rssBefore / (1024 * 1024) << "MB ->" << rssAfter / (1024 * 1024) << "MB";
+    }
+
+    mResidentGPUMemory += result.data->GetGPUMemorySize();
+    mNumberOfResidentModels++;
+
+    if (result.reload)
+    {
+        mNumberOfReloads++;
+        qInfo() << "Model" << result.name << "is reloaded.";
+    } else
+    {
+        if (result.fromCache)
+            mNumberOfCacheHits++;
+        else
+            mNumberOfCacheMisses++;
+
+        mModelsData.insert(result.data->GetName(), result.data);
+
+        qInfo() << "Model" << result.name << "at" << result.path << "is loaded.";
+    }
+
+    emit ModelDataLoaded(result.data);
 }
+
+void Canavar::Engine::ModelDataManager::EvictUnusedModels()
+{
+    if (mGPUMemoryBudget <= 0 || mResidentGPUMemory <= mGPUMemoryBudget)
+        return;
+
+    // Least recently rendered first
+    QVector<ModelData *> candidates;
+
+    for (const auto &data : qAsConst(mModelsData))
+        if (data->IsResident() && data->GetReferenceCount() == 0)
+            candidates << data;
+
+    std::sort(candidates.begin(), candidates.end(), [](ModelData *a, ModelData *b) { return a->GetLastRenderedFrame() < b->GetLastRenderedFrame(); });
+
+    for (const auto &data : qAsConst(candidates))
+    {
+        if (mResidentGPUMemory <= mGPUMemoryBudget)
+            break;
+
+        const qint64 before = mResidentGPUMemory;
+
+        mResidentGPUMemory -= data->GetGPUMemorySize();
+        data->DestroyGPUResources();
+        mRequestedModels.remove(data->GetName());
+
+        // What was built from data goes with it
+        emit ModelDataEvicted(data);
+
+        mNumberOfResidentModels--;
+        mNumberOfEvictions++;
+
+        qInfo() << "Model" << data->GetName() << "is evicted." << (before - mResidentGPUMemory) / (1024 * 1024) << "MB is released.";
+    }
+}
\ No newline at end of file
@@ -12,14 +12,7 @@ void Canavar::Engine::ModelDataNode::AddMeshIndex(int index)
     mMeshIndices << index;
 }
 
-void Canavar::Engine::ModelDataNode::Render(RenderModes modes, Model* model)
+const QVector<int>& Canavar::Engine::ModelDataNode::GetMeshIndices() const
 {
-    auto meshes = mModelData->GetMeshes();
-
-    for (auto index : qAsConst(mMeshIndices))
-        meshes[index]->Render(modes, model);
-
-    for (int i = 0; i < mChildren.size(); i++)
-        if (auto child = dynamic_cast<ModelDataNode*>(mChildren[i]))
-            child->Render(modes, model);
+    return mMeshIndices;
 }
\ No newline at end of file
@@ -0,0 +1,46 @@
+#include "NameRegistry.h"
+
+Canavar::Engine::NameRegistry::NameRegistry() {}
+
+Canavar::Engine::NameRegistry* Canavar::Engine::NameRegistry::Instance()
+{
+    static NameRegistry instance;
+    return &instance;
+}
+
+int Canavar::Engine::NameRegistry::Intern(const QString& name)
+{
+    {
+        QReadLocker locker(&mLock);
+        const auto it = mIDs.constFind(name);
+
+        if (it != mIDs.constEnd())
+            return it.value();
+    }
+
+    QWriteLocker locker(&mLock);
+
+    // Another thread may have interned it in between
+    const auto it = mIDs.constFind(name);
+
+    if (it != mIDs.constEnd())
+        return it.value();
+
+    const int id = mNames.size();
+    mNames << name;
+    mIDs.insert(name, id);
+
+    return id;
+}
+
+int Canavar::Engine::NameRegistry::Find(const QString& name) const
+{
+    QReadLocker locker(&mLock);
+    return mIDs.value(name, INVALID_ID);
+}
+
+QString Canavar::Engine::NameRegistry::GetName(int id) const
+{
+    QReadLocker locker(&mLock);
+    return mNames.value(id);
+}
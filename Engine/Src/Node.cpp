@@ -1,4 +1,5 @@
 #include "Node.h"
+#include "NodeManager.h"
 
 #include <QUuid>
 #include <QtMath>
@@ -8,12 +9,17 @@ Canavar::Engine::Node::Node()
     , mPosition(0, 0, 0)
     , mScale(1, 1, 1)
     , mParent(nullptr)
+    , mWorldTransformationDirty(true)
     , mVisible(true)
     , mSelectable(true)
     , mUUID()
     , mID(-1)
     , mType(NodeType::DummyNode)
     , mExcludeFromExport(false)
+    , mRegistryIndex(-1)
+    , mBucketIndex(-1)
+    , mProxyID(-1)
+    , mBoundsDirtyIndex(-1)
 {
     mAABB.SetMin(QVector3D(-1.0f, -1.0f, -1.0f));
     mAABB.SetMax(QVector3D(1.0f, 1.0f, 1.0f));
@@ -37,38 +43,26 @@ Canavar::Engine::Node* Canavar::Engine::Node::FindChildByNameRecursive(const QSt
     return nullptr;
 }
 
-const QMatrix4x4 Canavar::Engine::Node::WorldTransformation() const
+const QMatrix4x4& Canavar::Engine::Node::WorldTransformation() const
 {
-    // TODO: Scaling issue
-
-    if (mParent)
-    {
-        // Remove scaling
-        auto pos = mParent->WorldPosition();
-        auto rot = mParent->WorldRotation();
+    if (mWorldTransformationDirty)
+        UpdateWorldTransformation();
 
-        QMatrix4x4 tr;
-        tr.rotate(rot);
-        tr.setColumn(3, QVector4D(pos, 1.0f));
-
-        return tr * mTransformation;
-    }
-    else
-        return mTransformation;
+    return mWorldTransformation;
 }
 
 void Canavar::Engine::Node::SetWorldTransformation(const QMatrix4x4& newTransformation)
 {
-    SetWorldPosition(mTransformation.column(3).toVector3D());
-    SetWorldRotation(QQuaternion::fromRotationMatrix(mTransformation.normalMatrix()));
+    SetWorldPosition(newTransformation.column(3).toVector3D());
+    SetWorldRotation(QQuaternion::fromRotationMatrix(newTransformation.normalMatrix()));
 }
 
-QQuaternion Canavar::Engine::Node::WorldRotation() const
+const QQuaternion& Canavar::Engine::Node::WorldRotation() const
 {
-    if (mParent)
-        return mParent->WorldRotation() * mRotation;
-    else
-        return mRotation;
+    if (mWorldTransformationDirty)
+        UpdateWorldTransformation();
+
+    return mWorldRotation;
 }
 
 void Canavar::Engine::Node::SetWorldRotation(const QQuaternion& newWorldRotation)
@@ -93,12 +87,12 @@ void Canavar::Engine::Node::SetRotation(const QQuaternion& newRotation)
     UpdateTransformation();
 }
 
-QVector3D Canavar::Engine::Node::WorldPosition() const
+const QVector3D& Canavar::Engine::Node::WorldPosition() const
 {
-    if (mParent)
-        return mParent->WorldPosition() + mParent->WorldRotation() * mPosition;
-    else
-        return mPosition;
+    if (mWorldTransformationDirty)
+        UpdateWorldTransformation();
+
+    return mWorldPosition;
 }
 
 void Canavar::Engine::Node::SetWorldPosition(const QVector3D& newWorldPosition)
@@ -146,6 +140,8 @@ void Canavar::Engine::Node::SetTransformation(const QMatrix4x4& newTransformatio
 
     mPosition = mTransformation.column(3).toVector3D();
     mRotation = QQuaternion::fromRotationMatrix(mTransformation.normalMatrix());
+
+    MarkWorldTransformationDirty();
 }
 
 void Canavar::Engine::Node::UpdateTransformation()
@@ -154,6 +150,59 @@ void Canavar::Engine::Node::UpdateTransformation()
     mTransformation.scale(mScale);
     mTransformation.rotate(mRotation);
     mTransformation.setColumn(3, QVector4D(mPosition, 1.0f));
+
+    MarkWorldTransformationDirty();
+}
+
+void Canavar::Engine::Node::MarkWorldTransformationDirty()
+{
+    // If this node is already dirty then so is its subtree
+    if (mWorldTransformationDirty)
+        return;
+
+    mWorldTransformationDirty = true;
+    MarkBoundsDirty();
+
+    for (const auto& child : mChildren)
+        child->MarkWorldTransformationDirty();
+}
+
+void Canavar::Engine::Node::MarkBoundsDirty()
+{
+    if (mProxyID == -1 || mBoundsDirtyIndex != -1)
+        return;
+
+    auto& dirtyNodes = NodeManager::Instance()->mBoundsDirtyNodes;
+    mBoundsDirtyIndex = dirtyNodes.size();
+    dirtyNodes << this;
+}
+
+void Canavar::Engine::Node::UpdateWorldTransformation() const
+{
+    // TODO: Scaling issue
+
+    if (mParent)
+    {
+        // Remove scaling
+        const auto& pos = mParent->WorldPosition();
+        const auto& rot = mParent->WorldRotation();
+
+        QMatrix4x4 tr;
+        tr.rotate(rot);
+        tr.setColumn(3, QVector4D(pos, 1.0f));
+
+        mWorldTransformation = tr * mTransformation;
+        mWorldRotation = rot * mRotation;
+        mWorldPosition = pos + rot * mPosition;
+    }
+    else
+    {
+        mWorldTransformation = mTransformation;
+        mWorldRotation = mRotation;
+        mWorldPosition = mPosition;
+    }
+
+    mWorldTransformationDirty = false;
 }
 
 Canavar::Engine::Node* Canavar::Engine::Node::GetParent() const
@@ -181,6 +230,8 @@ void Canavar::Engine::Node::SetParent(Node* newParent)
     }
 
     mParent = newParent;
+
+    MarkWorldTransformationDirty();
 }
 
 void Canavar::Engine::Node::AddChild(Node* node)
@@ -231,6 +282,22 @@ const QList<Canavar::Engine::Node*>& Canavar::Engine::Node::GetChildren() const
     return mChildren;
 }
 
+const QString& Canavar::Engine::Node::GetName() const
+{
+    return mName;
+}
+
+void Canavar::Engine::Node::SetName(const QString& newName)
+{
+    if (mName == newName)
+        return;
+
+    QString oldName = mName;
+    mName = newName;
+
+    emit NameChanged(oldName);
+}
+
 void Canavar::Engine::Node::ToJson(QJsonObject& object)
 {
     QJsonObject rotation;
@@ -293,7 +360,7 @@ void Canavar::Engine::Node::FromJson(const QJsonObject& object)
     }
 
     mVisible = object["visible"].toBool();
-    mName = object["name"].toString();
+    SetName(object["name"].toString());
     mUUID = object["uuid"].toString();
     mSelectable = object["selectable"].toBool();
 }
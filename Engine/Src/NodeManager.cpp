@@ -5,6 +5,7 @@
 #include "DummyNode.h"
 #include "FirecrackerEffect.h"
 #include "FreeCamera.h"
+#include "Frustum.h"
 #include "Haze.h"
 #include "Helper.h"
 #include "LightManager.h"
@@ -21,6 +22,8 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 
+#include <utility>
+
 Canavar::Engine::NodeManager::NodeManager()
     : Manager()
     , mNumberOfNodes(0)
@@ -42,21 +45,10 @@ bool Canavar::Engine::NodeManager::Init()
     mLightManager = LightManager::Instance();
     mModelDataManager = ModelDataManager::Instance();
 
-    mNodes << Sun::Instance();
-    Sun::Instance()->mID = mNumberOfNodes;
-    mNumberOfNodes++;
-
-    mNodes << Sky::Instance();
-    Sky::Instance()->mID = mNumberOfNodes;
-    mNumberOfNodes++;
-
-    mNodes << Haze::Instance();
-    Haze::Instance()->mID = mNumberOfNodes;
-    mNumberOfNodes++;
-
-    mNodes << Terrain::Instance();
-    Terrain::Instance()->mID = mNumberOfNodes;
-    mNumberOfNodes++;
+    RegisterNode(Sun::Instance());
+    RegisterNode(Sky::Instance());
+    RegisterNode(Haze::Instance());
+    RegisterNode(Terrain::Instance());
 
     return true;
 }
@@ -73,6 +65,11 @@ void Canavar::Engine::NodeManager::PostInit()
 
     auto array = doc["nodes"].toArray();
 
+    // Start loading every model of the world before the nodes ask for them one by one
+    for (const auto& e : array)
+        if ((Node::NodeType) e.toObject()["type"].toInt() == Node::NodeType::Model)
+            mModelDataManager->RequestModelData(e.toObject()["model_name"].toString());
+
     QMap<QString, QString> childToParentMap;
 
     for (const auto& e : array)
@@ -83,6 +80,7 @@ void Canavar::Engine::NodeManager::PostInit()
             childToParentMap.insert(object["uuid"].toString(), object["parent"].toString());
 
         Node::NodeType type = (Node::NodeType)object["type"].toInt();
+        Node* node = nullptr;
 
         switch (type)
         {
@@ -93,28 +91,35 @@ void Canavar::Engine::NodeManager::PostInit()
         case Node::NodeType::NozzleEffect:
         case Node::NodeType::FirecrackerEffect:
         case Node::NodeType::PersecutorCamera:
-            CreateNode(type, object["name"].toString())->FromJson(object);
+            node = CreateNode(type, object["name"].toString());
             break;
-
         case Node::NodeType::Model:
-            CreateModel(object["model_name"].toString(), object["name"].toString())->FromJson(object);
+            node = CreateModel(object["model_name"].toString(), object["name"].toString());
             break;
         case Node::NodeType::Sun:
-            Sun::Instance()->FromJson(object);
+            node = Sun::Instance();
             break;
         case Node::NodeType::Sky:
-            Sky::Instance()->FromJson(object);
+            node = Sky::Instance();
             break;
         case Node::NodeType::Haze:
-            Haze::Instance()->FromJson(object);
+            node = Haze::Instance();
             break;
         case Node::NodeType::Terrain:
-            Terrain::Instance()->FromJson(object);
+            node = Terrain::Instance();
             break;
         default:
             qWarning() << Q_FUNC_INFO << "Unknown node type: " << (int)type;
             break;
         }
+
+        if (node)
+        {
+            // FromJson overwrites the UUID
+            mNodesByUUID.remove(node->GetUUID());
+            node->FromJson(object);
+            mNodesByUUID.insert(node->GetUUID(), node);
+        }
     }
 
     // Set parents
@@ -126,6 +131,11 @@ void Canavar::Engine::NodeManager::PostInit()
     }
 }
 
+void Canavar::Engine::NodeManager::Update(float)
+{
+    UpdateBounds();
+}
+
 Canavar::Engine::Node* Canavar::Engine::NodeManager::CreateNode(Node::NodeType type, const QString& name)
 {
     Node* node = nullptr;
@@ -180,9 +190,7 @@ Canavar::Engine::Node* Canavar::Engine::NodeManager::CreateNode(Node::NodeType t
     if (node)
     {
         AssignName(node, name);
-        node->mID = mNumberOfNodes;
-        mNodes << node;
-        mNumberOfNodes++;
+        RegisterNode(node);
 
         emit NodeCreated(node);
     }
@@ -195,9 +203,7 @@ Canavar::Engine::Model* Canavar::Engine::NodeManager::CreateModel(const QString&
     Model* model = new Model(modelName);
 
     AssignName(model, name);
-    model->mID = mNumberOfNodes;
-    mNodes << model;
-    mNumberOfNodes++;
+    RegisterNode(model);
 
     emit NodeCreated(model);
 
@@ -222,7 +228,7 @@ void Canavar::Engine::NodeManager::RemoveNode(Node* node)
         for (auto& child : node->GetChildren())
             child->SetParent(nullptr);
 
-        mNodes.removeAll(node);
+        UnregisterNode(node);
         node->deleteLater();
         break;
     }
@@ -236,7 +242,7 @@ void Canavar::Engine::NodeManager::RemoveNode(Node* node)
             child->SetParent(nullptr);
 
         mCameraManager->RemoveCamera(dynamic_cast<Camera*>(node));
-        mNodes.removeAll(node);
+        UnregisterNode(node);
         node->deleteLater();
         break;
     }
@@ -248,7 +254,7 @@ void Canavar::Engine::NodeManager::RemoveNode(Node* node)
             child->SetParent(nullptr);
 
         mLightManager->RemoveLight(dynamic_cast<Light*>(node));
-        mNodes.removeAll(node);
+        UnregisterNode(node);
         node->deleteLater();
         break;
     }
@@ -261,29 +267,24 @@ void Canavar::Engine::NodeManager::RemoveNode(Node* node)
 
 Canavar::Engine::Node* Canavar::Engine::NodeManager::GetNodeByID(int ID)
 {
-    for (const auto& node : mNodes)
-        if (node->GetID() == ID)
-            return node;
-
-    return nullptr;
+    return mNodesByID.value(ID, nullptr);
 }
 
 Canavar::Engine::Node* Canavar::Engine::NodeManager::GetNodeByUUID(const QString& uuid)
 {
-    for (const auto& node : mNodes)
-        if (node->GetUUID() == uuid)
-            return node;
-
-    return nullptr;
+    return mNodesByUUID.value(uuid, nullptr);
 }
 
 Canavar::Engine::Node* Canavar::Engine::NodeManager::GetNodeByName(const QString& name)
 {
-    for (const auto& node : mNodes)
-        if (node->GetName() == name)
-            return node;
+    // Names are not unique, return the oldest node just like a linear scan would
+    Node* result = nullptr;
+
+    for (auto it = mNodesByName.constFind(name); it != mNodesByName.cend() && it.key() == name; ++it)
+        if (result == nullptr || it.value()->GetID() < result->GetID())
+            result = it.value();
 
-    return nullptr;
+    return result;
 }
 
 Canavar::Engine::NodeManager* Canavar::Engine::NodeManager::Instance()
@@ -297,6 +298,31 @@ const QList<Canavar::Engine::Node*>& Canavar::Engine::NodeManager::GetNodes() co
     return mNodes;
 }
 
+const QList<Canavar::Engine::Model*>& Canavar::Engine::NodeManager::GetModels() const
+{
+    return mModels;
+}
+
+const QList<Canavar::Engine::NozzleEffect*>& Canavar::Engine::NodeManager::GetNozzleEffects() const
+{
+    return mNozzleEffects;
+}
+
+const QList<Canavar::Engine::FirecrackerEffect*>& Canavar::Engine::NodeManager::GetFirecrackerEffects() const
+{
+    return mFirecrackerEffects;
+}
+
+const QList<Canavar::Engine::Light*>& Canavar::Engine::NodeManager::GetLights() const
+{
+    return mLights;
+}
+
+const QList<Canavar::Engine::Camera*>& Canavar::Engine::NodeManager::GetCameras() const
+{
+    return mCameras;
+}
+
 void Canavar::Engine::NodeManager::ToJson(QJsonObject& object)
 {
     QJsonArray array;
@@ -331,6 +357,208 @@ void Canavar::Engine::NodeManager::AssignName(Node* node, const QString& name)
         node->SetName(name);
 }
 
+void Canavar::Engine::NodeManager::RegisterNode(Node* node)
+{
+    node->mID = mNumberOfNodes;
+    node->mRegistryIndex = mNodes.size();
+    mNodes << node;
+    mNumberOfNodes++;
+
+    mNodesByID.insert(node->GetID(), node);
+    mNodesByUUID.insert(node->GetUUID(), node);
+    mNodesByName.insert(node->GetName(), node);
+
+    switch (node->GetType())
+    {
+    case Node::NodeType::Model:
+        AddToBucket(mModels, static_cast<Model*>(node));
+        break;
+    case Node::NodeType::NozzleEffect:
+        AddToBucket(mNozzleEffects, static_cast<NozzleEffect*>(node));
+        break;
+    case Node::NodeType::FirecrackerEffect:
+        AddToBucket(mFirecrackerEffects, static_cast<FirecrackerEffect*>(node));
+        break;
+    case Node::NodeType::Sun:
+    case Node::NodeType::PointLight:
+        AddToBucket(mLights, static_cast<Light*>(node));
+        break;
+    case Node::NodeType::FreeCamera:
+    case Node::NodeType::DummyCamera:
+    case Node::NodeType::PersecutorCamera:
+        AddToBucket(mCameras, static_cast<Camera*>(node));
+        break;
+    default:
+        break;
+    }
+
+    switch (node->GetType())
+    {
+    case Node::NodeType::Sun:
+    case Node::NodeType::Sky:
+    case Node::NodeType::Haze:
+    case Node::NodeType::Terrain:
+        break;
+    default:
+        node->mProxyID = mTree.CreateProxy(node->GetAABB().Transform(node->WorldTransformation()), node);
+        break;
+    }
+
+    connect(node, &Node::NameChanged, this, [=](const QString& oldName) {
+        mNodesByName.remove(oldName, node);
+        mNodesByName.insert(node->GetName(), node);
+    });
+}
+
+void Canavar::Engine::NodeManager::UnregisterNode(Node* node)
+{
+    int index = node->mRegistryIndex;
+
+    if (index < 0 || index >= mNodes.size() || mNodes[index] != node)
+    {
+        qWarning() << Q_FUNC_INFO << "Node is not registered:" << node->GetName();
+        return;
+    }
+
+    // Swap with the last node so that removal is O(1)
+    Node* last = mNodes.last();
+    mNodes[index] = last;
+    last->mRegistryIndex = index;
+    mNodes.removeLast();
+    node->mRegistryIndex = -1;
+
+    mNodesByID.remove(node->GetID());
+    mNodesByUUID.remove(node->GetUUID());
+    mNodesByName.remove(node->GetName(), node);
+
+    disconnect(node, &Node::NameChanged, this, nullptr);
+
+    if (node->mProxyID != -1)
+    {
+        mTree.DestroyProxy(node->mProxyID);
+        node->mProxyID = -1;
+    }
+
+    // Swap with the last dirty node, the order of the list does not matter
+    if (node->mBoundsDirtyIndex != -1)
+    {
+        Node* last = mBoundsDirtyNodes.last();
+        mBoundsDirtyNodes[node->mBoundsDirtyIndex] = last;
+        last->mBoundsDirtyIndex = node->mBoundsDirtyIndex;
+        mBoundsDirtyNodes.removeLast();
+        node->mBoundsDirtyIndex = -1;
+    }
+
+    switch (node->GetType())
+    {
+    case Node::NodeType::Model:
+        RemoveFromBucket(mModels, static_cast<Model*>(node));
+        mMovedModels.remove(static_cast<Model*>(node));
+        break;
+    case Node::NodeType::NozzleEffect:
+        RemoveFromBucket(mNozzleEffects, static_cast<NozzleEffect*>(node));
+        break;
+    case Node::NodeType::FirecrackerEffect:
+        RemoveFromBucket(mFirecrackerEffects, static_cast<FirecrackerEffect*>(node));
+        break;
+    case Node::NodeType::Sun:
+    case Node::NodeType::PointLight:
+        RemoveFromBucket(mLights, static_cast<Light*>(node));
+        break;
+    case Node::NodeType::FreeCamera:
+    case Node::NodeType::DummyCamera:
+    case Node::NodeType::PersecutorCamera:
+        RemoveFromBucket(mCameras, static_cast<Camera*>(node));
+        break;
+    default:
+        break;
+    }
+}
+
+void Canavar::Engine::NodeManager::UpdateBounds()
+{
+    for (const auto& node : qAsConst(mBoundsDirtyNodes))
+    {
+        node->mBoundsDirtyIndex = -1;
+        mTree.MoveProxy(node->mProxyID, node->GetAABB().Transform(node->WorldTransformation()));
+
+        if (node->GetType() == Node::NodeType::Model)
+            mMovedModels.insert(static_cast<Model*>(node));
+    }
+
+    mBoundsDirtyNodes.clear();
+}
+
+QSet<Canavar::Engine::Model*> Canavar::Engine::NodeManager::TakeMovedModels()
+{
+    UpdateBounds();
+
+    return std::exchange(mMovedModels, QSet<Model*>());
+}
+
+QList<Canavar::Engine::Node*> Canavar::Engine::NodeManager::QueryFrustum(const Frustum& frustum)
+{
+    UpdateBounds();
+
+    QList<Node*> result;
+    mTree.QueryFrustum(frustum, result);
+    return result;
+}
+
+QList<Canavar::Engine::Node*> Canavar::Engine::NodeManager::QuerySphere(const QVector3D& center, float radius)
+{
+    UpdateBounds();
+
+    QList<Node*> result;
+    mTree.QuerySphere(center, radius, result);
+    return result;
+}
+
+QList<Canavar::Engine::Node*> Canavar::Engine::NodeManager::QueryBox(const AABB& aabb)
+{
+    UpdateBounds();
+
+    QList<Node*> result;
+    mTree.QueryBox(aabb, result);
+    return result;
+}
+
+QList<Canavar::Engine::Node*> Canavar::Engine::NodeManager::QueryRay(const QVector3D& origin, const QVector3D& direction, float maxDistance)
+{
+    UpdateBounds();
+
+    QList<Node*> result;
+    mTree.QueryRay(origin, direction, maxDistance, result);
+    return result;
+}
+
+const Canavar::Engine::DynamicAABBTree& Canavar::Engine::NodeManager::GetTree() const
+{
+    return mTree;
+}
+
+template<typename T>
+void Canavar::Engine::NodeManager::AddToBucket(QList<T*>& bucket, T* node)
+{
+    static_cast<Node*>(node)->mBucketIndex = bucket.size();
+    bucket << node;
+}
+
+template<typename T>
+void Canavar::Engine::NodeManager::RemoveFromBucket(QList<T*>& bucket, T* node)
+{
+    int index = static_cast<Node*>(node)->mBucketIndex;
+
+    if (index < 0 || index >= bucket.size() || bucket[index] != node)
+        return;
+
+    T* last = bucket.last();
+    bucket[index] = last;
+    static_cast<Node*>(last)->mBucketIndex = index;
+    bucket.removeLast();
+    static_cast<Node*>(node)->mBucketIndex = -1;
+}
+
 Canavar::Engine::Node* Canavar::Engine::NodeManager::GetNodeByScreenPosition(int x, int y)
 {
     auto info = SelectableNodeRenderer::Instance()->GetNodeInfoByScreenPosition(x, y);
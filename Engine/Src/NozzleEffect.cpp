@@ -1,4 +1,5 @@
 #include "NozzleEffect.h"
+#include "GPUMemoryTracker.h"
 
 #include "Helper.h"
 
@@ -15,6 +16,12 @@ Canavar::Engine::NozzleEffect::NozzleEffect()
     mShaderManager = ShaderManager::Instance();
     mCameraManager = CameraManager::Instance();
 
+    mMVPUniform = mShaderManager->GetUniformHandle("MVP");
+    mScaleUniform = mShaderManager->GetUniformHandle("scale");
+    mMaxRadiusUniform = mShaderManager->GetUniformHandle("maxRadius");
+    mMaxDistanceUniform = mShaderManager->GetUniformHandle("maxDistance");
+    mSpeedUniform = mShaderManager->GetUniformHandle("speed");
+
     mType = Node::NodeType::NozzleEffect;
     mName = "Nozzle Effect";
 }
@@ -38,12 +45,17 @@ void Canavar::Engine::NozzleEffect::Create()
     glBindBuffer(GL_ARRAY_BUFFER, mVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(Canavar::Engine::CUBE), Canavar::Engine::CUBE, GL_STATIC_DRAW);
 
+    // The name is assigned after Create(), the UUID is stable
+    const QString owner = "NozzleEffect: " + GetUUID();
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Buffer, mVBO, GPUMemoryTracker::Category::VertexBuffer, owner, sizeof(Canavar::Engine::CUBE));
+
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(QVector3D), (void*)0);
     glEnableVertexAttribArray(0);
 
     glGenBuffers(1, &mPBO);
     glBindBuffer(GL_ARRAY_BUFFER, mPBO);
     glBufferData(GL_ARRAY_BUFFER, mParticles.size() * sizeof(Particle), mParticles.constData(), GL_DYNAMIC_DRAW);
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Buffer, mPBO, GPUMemoryTracker::Category::VertexBuffer, owner, mParticles.size() * sizeof(Particle));
 
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)0);
     glEnableVertexAttribArray(1);
@@ -85,22 +97,42 @@ void Canavar::Engine::NozzleEffect::FromJson(const QJsonObject& object)
     NozzleEffect::mScale = object["scale_nozzle"].toDouble();
 }
 
-void Canavar::Engine::NozzleEffect::Render(float ifps)
+void Canavar::Engine::NozzleEffect::Update(float ifps)
 {
+    float inf = std::numeric_limits<float>::infinity();
+    QVector3D min(inf, inf, inf);
+    QVector3D max(-inf, -inf, -inf);
+
     for (int i = 0; i < mParticles.size(); i++)
     {
         mParticles[i].life += ifps;
 
         if (mParticles[i].life >= mParticles[i].deadAfter)
             mParticles[i] = GenerateParticle();
+
+        // Same as in NozzleEffect.vert
+        const auto position = mSpeed * mParticles[i].direction * mParticles[i].life + mParticles[i].initialPosition;
+        min = QVector3D(qMin(min.x(), position.x()), qMin(min.y(), position.y()), qMin(min.z(), position.z()));
+        max = QVector3D(qMax(max.x(), position.x()), qMax(max.y(), position.y()), qMax(max.z(), position.z()));
     }
 
+    // Used for culling, pad by the particle size
+    if (!mParticles.isEmpty())
+    {
+        mAABB.SetMin(min - QVector3D(mScale, mScale, mScale));
+        mAABB.SetMax(max + QVector3D(mScale, mScale, mScale));
+        MarkBoundsDirty();
+    }
+}
+
+void Canavar::Engine::NozzleEffect::Render()
+{
     mShaderManager->Bind(ShaderType::NozzleEffectShader);
-    mShaderManager->SetUniformValue("MVP", mCameraManager->GetActiveCamera()->GetViewProjectionMatrix() * WorldTransformation());
-    mShaderManager->SetUniformValue("scale", mScale);
-    mShaderManager->SetUniformValue("maxRadius", mMaxRadius);
-    mShaderManager->SetUniformValue("maxDistance", mMaxDistance);
-    mShaderManager->SetUniformValue("speed", mSpeed);
+    mShaderManager->SetUniformValue(mMVPUniform, mCameraManager->GetActiveCamera()->GetViewProjectionMatrix() * WorldTransformation());
+    mShaderManager->SetUniformValue(mScaleUniform, mScale);
+    mShaderManager->SetUniformValue(mMaxRadiusUniform, mMaxRadius);
+    mShaderManager->SetUniformValue(mMaxDistanceUniform, mMaxDistance);
+    mShaderManager->SetUniformValue(mSpeedUniform, mSpeed);
 
     glBindVertexArray(mVAO);
     glBindBuffer(GL_ARRAY_BUFFER, mPBO);
@@ -0,0 +1,382 @@
+#include "OcclusionCulling.h"
+#include "GPUMemoryTracker.h"
+#include "ShaderManager.h"
+
+#include <QtMath>
+
+namespace {
+    // Size of the level read back for the CPU test, the levels below it are built on the CPU
+    constexpr int MAX_READBACK_WIDTH = 256;
+
+    // Camera movement within one frame that counts as a jump, e.g. a teleport or a switch to another camera
+    constexpr float CAMERA_JUMP_DISTANCE = 50.0f;
+    constexpr float CAMERA_JUMP_ANGLE = 30.0f; // In degrees
+} // namespace
+
+Canavar::Engine::OcclusionCulling::OcclusionCulling()
+    : mShaderManager(nullptr)
+    , mWidth(0)
+    , mHeight(0)
+    , mNumberOfLevels(0)
+    , mDepthFramebuffer(0)
+    , mDepthTexture(0)
+    , mDepthFormat(0)
+    , mPyramidTexture(0)
+    , mPyramidValid(false)
+    , mReadbackFramebuffer(0)
+    , mReadbackBuffer(0)
+    , mReadbackFence(nullptr)
+    , mReadbackLevel(0)
+    , mDebugLevel(-1)
+{}
+
+void Canavar::Engine::OcclusionCulling::Init()
+{
+    initializeOpenGLFunctions();
+
+    mShaderManager = ShaderManager::Instance();
+
+    mSourceUniform = mShaderManager->GetUniformHandle("source");
+    mSourceLevelUniform = mShaderManager->GetUniformHandle("sourceLevel");
+    mCopyUniform = mShaderManager->GetUniformHandle("copy");
+    mPyramidUniform = mShaderManager->GetUniformHandle("pyramid");
+    mLevelUniform = mShaderManager->GetUniformHandle("level");
+    mZNearUniform = mShaderManager->GetUniformHandle("zNear");
+    mZFarUniform = mShaderManager->GetUniformHandle("zFar");
+
+    glGenFramebuffers(1, &mDepthFramebuffer);
+    glGenFramebuffers(1, &mReadbackFramebuffer);
+    glGenBuffers(1, &mReadbackBuffer);
+}
+
+void Canavar::Engine::OcclusionCulling::Resize(int width, int height)
+{
+    DeleteResources();
+
+    mWidth = qMax(width, 1);
+    mHeight = qMax(height, 1);
+    mNumberOfLevels = qFloor(std::log2(qMax(mWidth, mHeight))) + 1;
+
+    glGenTextures(1, &mPyramidTexture);
+    glBindTexture(GL_TEXTURE_2D, mPyramidTexture);
+    glTexStorage2D(GL_TEXTURE_2D, mNumberOfLevels, GL_R32F, mWidth, mHeight);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    qint64 bytes = 0;
+
+    for (int level = 0; level < mNumberOfLevels; ++level)
+        bytes += qint64(qMax(1, mWidth >> level)) * qMax(1, mHeight >> level) * sizeof(float);
+
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Texture, mPyramidTexture, GPUMemoryTracker::Category::RenderTarget, "Pass: Hi-Z", bytes);
+
+    // First level that is small enough to be read back every frame
+    mReadbackLevel = 0;
+
+    while ((mWidth >> mReadbackLevel) > MAX_READBACK_WIDTH && mReadbackLevel + 1 < mNumberOfLevels)
+        mReadbackLevel++;
+
+    const qint64 readbackSize = qint64(qMax(1, mWidth >> mReadbackLevel)) * qMax(1, mHeight >> mReadbackLevel) * sizeof(float);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, mReadbackBuffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, readbackSize, nullptr, GL_STREAM_READ);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Buffer, mReadbackBuffer, GPUMemoryTracker::Category::StorageBuffer, "Pass: Hi-Z", readbackSize);
+}
+
+void Canavar::Engine::OcclusionCulling::DeleteResources()
+{
+    auto tracker = GPUMemoryTracker::Instance();
+
+    // The old levels do not match the new size
+    Invalidate();
+
+    if (mDepthTexture)
+    {
+        tracker->Free(GPUMemoryTracker::Resource::Texture, mDepthTexture);
+        glDeleteTextures(1, &mDepthTexture);
+        mDepthTexture = 0;
+    }
+
+    if (mPyramidTexture)
+    {
+        tracker->Free(GPUMemoryTracker::Resource::Texture, mPyramidTexture);
+        glDeleteTextures(1, &mPyramidTexture);
+        mPyramidTexture = 0;
+    }
+}
+
+void Canavar::Engine::OcclusionCulling::Build(GLuint framebuffer, const QMatrix4x4& viewProjection)
+{
+    if (mPyramidTexture == 0)
+        return;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+
+    // A multisampled depth buffer can only be resolved into one of the same format
+    if (mDepthTexture == 0)
+    {
+        GLint type = GL_NONE;
+        GLint name = 0;
+        GLint format = GL_DEPTH_COMPONENT24;
+
+        glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &type);
+        glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &name);
+
+        if (type == GL_RENDERBUFFER)
+        {
+            glBindRenderbuffer(GL_RENDERBUFFER, name);
+            glGetRenderbufferParameteriv(GL_RENDERBUFFER, GL_RENDERBUFFER_INTERNAL_FORMAT, &format);
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        }
+
+        // Unsized formats cannot be used for immutable storage
+        mDepthFormat = format == GL_DEPTH_COMPONENT ? GL_DEPTH_COMPONENT24 : format;
+
+        glGenTextures(1, &mDepthTexture);
+        glBindTexture(GL_TEXTURE_2D, mDepthTexture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, mDepthFormat, mWidth, mHeight);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Texture, mDepthTexture, GPUMemoryTracker::Category::RenderTarget, "Pass: Hi-Z", qint64(mWidth) * mHeight * GPUMemoryTracker::GetBytesPerPixel(mDepthFormat));
+
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mDepthFramebuffer);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, mDepthTexture, 0);
+    }
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mDepthFramebuffer);
+    glBlitFramebuffer(0, 0, mWidth, mHeight, 0, 0, mWidth, mHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+    // Level 0 is a copy of the depth, every other level keeps the farthest depth of the texels below it
+    mShaderManager->Bind(ShaderType::HiZShader);
+
+    for (int level = 0; level < mNumberOfLevels; ++level)
+    {
+        if (level == 0)
+            mShaderManager->SetSampler(mSourceUniform, 0, mDepthTexture);
+        else
+            mShaderManager->SetSampler(mSourceUniform, 0, mPyramidTexture);
+
+        mShaderManager->SetUniformValue(mCopyUniform, level == 0);
+        mShaderManager->SetUniformValue(mSourceLevelUniform, qMax(0, level - 1));
+
+        glBindImageTexture(0, mPyramidTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glDispatchCompute((qMax(1, mWidth >> level) + 7) / 8, (qMax(1, mHeight >> level) + 7) / 8, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+    }
+
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    mShaderManager->Release();
+
+    mPyramidViewProjection = viewProjection;
+    mPyramidValid = true;
+
+    // One read back in flight at a time, a level is skipped if the GPU is behind
+    if (mReadbackFence == nullptr)
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, mReadbackFramebuffer);
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mPyramidTexture, mReadbackLevel);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, mReadbackBuffer);
+        glReadPixels(0, 0, qMax(1, mWidth >> mReadbackLevel), qMax(1, mHeight >> mReadbackLevel), GL_RED, GL_FLOAT, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        mReadbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        mReadbackViewProjection = viewProjection;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void Canavar::Engine::OcclusionCulling::Update(const QVector3D& cameraPosition, const QQuaternion& cameraRotation)
+{
+    // Angle of the relative rotation, the sign of the quaternion does not matter
+    const float angle = qRadiansToDegrees(2.0f * std::acos(qMin(1.0f, qAbs(QQuaternion::dotProduct(mCameraRotation, cameraRotation)))));
+
+    if ((cameraPosition - mCameraPosition).length() > CAMERA_JUMP_DISTANCE || angle > CAMERA_JUMP_ANGLE)
+        Invalidate();
+
+    mCameraPosition = cameraPosition;
+    mCameraRotation = cameraRotation;
+
+    if (mReadbackFence == nullptr)
+        return;
+
+    const GLenum status = glClientWaitSync(mReadbackFence, 0, 0);
+
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        return;
+
+    glDeleteSync(mReadbackFence);
+    mReadbackFence = nullptr;
+
+    const int width = qMax(1, mWidth >> mReadbackLevel);
+    const int height = qMax(1, mHeight >> mReadbackLevel);
+
+    mLevels.resize(1);
+    mLevelSizes.resize(1);
+    mLevels[0].resize(width * height);
+    mLevelSizes[0] = QSize(width, height);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, mReadbackBuffer);
+
+    if (const auto data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, width * height * sizeof(float), GL_MAP_READ_BIT))
+    {
+        memcpy(mLevels[0].data(), data, width * height * sizeof(float));
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    else
+    {
+        mLevels.clear();
+        mLevelSizes.clear();
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    // Same reduction as HiZ.comp, the last row and column of an odd level fold into the last texel
+    while (!mLevels.isEmpty() && (mLevelSizes.last().width() > 1 || mLevelSizes.last().height() > 1))
+    {
+        const QSize source = mLevelSizes.last();
+        const QSize size(qMax(1, source.width() / 2), qMax(1, source.height() / 2));
+        QVector<float> level(size.width() * size.height());
+
+        for (int y = 0; y < size.height(); ++y)
+        {
+            const int lastY = qMin(2 * y + 1 + (y == size.height() - 1 ? source.height() % 2 : 0), source.height() - 1);
+
+            for (int x = 0; x < size.width(); ++x)
+            {
+                const int lastX = qMin(2 * x + 1 + (x == size.width() - 1 ? source.width() % 2 : 0), source.width() - 1);
+                float depth = 0.0f;
+
+                for (int sy = 2 * y; sy <= lastY; ++sy)
+                    for (int sx = 2 * x; sx <= lastX; ++sx)
+                        depth = qMax(depth, mLevels.last()[sy * source.width() + sx]);
+
+                level[y * size.width() + x] = depth;
+            }
+        }
+
+        mLevels << level;
+        mLevelSizes << size;
+    }
+
+    mViewProjection = mReadbackViewProjection;
+}
+
+void Canavar::Engine::OcclusionCulling::Invalidate()
+{
+    if (mReadbackFence)
+    {
+        glDeleteSync(mReadbackFence);
+        mReadbackFence = nullptr;
+    }
+
+    mLevels.clear();
+    mLevelSizes.clear();
+    mPyramidValid = false;
+}
+
+bool Canavar::Engine::OcclusionCulling::IsOccluded(const AABB& localAABB, const QMatrix4x4& transformation) const
+{
+    if (mLevels.isEmpty())
+        return false;
+
+    const QMatrix4x4 MVP = mViewProjection * transformation;
+    const QVector3D& min = localAABB.GetMin();
+    const QVector3D& max = localAABB.GetMax();
+
+    float minX = 1.0f, minY = 1.0f, maxX = -1.0f, maxY = -1.0f, minZ = 1.0f;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        const QVector4D corner(i & 1 ? max.x() : min.x(), i & 2 ? max.y() : min.y(), i & 4 ? max.z() : min.z(), 1.0f);
+        const QVector4D clip = MVP * corner;
+
+        // Reaches behind the camera, the projected rectangle is not bounded
+        if (clip.w() <= 0.0f)
+            return false;
+
+        const QVector3D ndc = clip.toVector3DAffine();
+        minX = qMin(minX, ndc.x());
+        minY = qMin(minY, ndc.y());
+        maxX = qMax(maxX, ndc.x());
+        maxY = qMax(maxY, ndc.y());
+        minZ = qMin(minZ, ndc.z());
+    }
+
+    // Off screen boxes are left to frustum culling
+    if (maxX < -1.0f || maxY < -1.0f || minX > 1.0f || minY > 1.0f)
+        return false;
+
+    const QSize& base = mLevelSizes[0];
+    const auto toTexel = [](float ndc, int size) { return qBound(0, qFloor((0.5f * ndc + 0.5f) * size), size - 1); };
+
+    const int x0 = toTexel(minX, base.width());
+    const int x1 = toTexel(maxX, base.width());
+    const int y0 = toTexel(minY, base.height());
+    const int y1 = toTexel(maxY, base.height());
+
+    // Coarsest level at which the rectangle spans at most 2x2 texels
+    int level = 0;
+
+    while (level + 1 < mLevels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+        level++;
+
+    const QSize& size = mLevelSizes[level];
+    const QVector<float>& depths = mLevels[level];
+    float maxDepth = 0.0f;
+
+    for (int y = qMin(y0 >> level, size.height() - 1); y <= qMin(y1 >> level, size.height() - 1); ++y)
+        for (int x = qMin(x0 >> level, size.width() - 1); x <= qMin(x1 >> level, size.width() - 1); ++x)
+            maxDepth = qMax(maxDepth, depths[y * size.width() + x]);
+
+    return 0.5f * minZ + 0.5f > maxDepth;
+}
+
+bool Canavar::Engine::OcclusionCulling::IsPyramidValid() const
+{
+    return mPyramidValid;
+}
+
+GLuint Canavar::Engine::OcclusionCulling::GetPyramidTexture() const
+{
+    return mPyramidTexture;
+}
+
+const QMatrix4x4& Canavar::Engine::OcclusionCulling::GetPyramidViewProjection() const
+{
+    return mPyramidViewProjection;
+}
+
+int Canavar::Engine::OcclusionCulling::GetNumberOfLevels() const
+{
+    return mNumberOfLevels;
+}
+
+void Canavar::Engine::OcclusionCulling::RenderDebug(GLuint quadVAO, float zNear, float zFar)
+{
+    if (mDebugLevel < 0 || !mPyramidValid)
+        return;
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glViewport(viewport[0], viewport[1], viewport[2] / 3, viewport[3] / 3);
+
+    mShaderManager->Bind(ShaderType::HiZDebugShader);
+    mShaderManager->SetSampler(mPyramidUniform, 0, mPyramidTexture);
+    mShaderManager->SetUniformValue(mLevelUniform, qMin(mDebugLevel, mNumberOfLevels - 1));
+    mShaderManager->SetUniformValue(mZNearUniform, zNear);
+    mShaderManager->SetUniformValue(mZFarUniform, zFar);
+    glBindVertexArray(quadVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glBindVertexArray(0);
+    mShaderManager->Release();
+
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
@@ -1,4 +1,5 @@
 #include "OpenGLFramebuffer.h"
+#include "GPUMemoryTracker.h"
 
 Canavar::Engine::OpenGLFramebuffer::OpenGLFramebuffer()
     : mCreated(false)
@@ -8,9 +9,10 @@ Canavar::Engine::OpenGLFramebuffer::OpenGLFramebuffer()
     , mColorAttachments{ GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 }
 {}
 
-void Canavar::Engine::OpenGLFramebuffer::Init()
+void Canavar::Engine::OpenGLFramebuffer::Init(const QString& owner)
 {
     initializeOpenGLFunctions();
+    mOwner = owner;
 }
 
 void Canavar::Engine::OpenGLFramebuffer::Create(int width, int height)
@@ -30,6 +32,7 @@ void Canavar::Engine::OpenGLFramebuffer::Create(int width, int height)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mTextures[0], 0);
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Texture, mTextures[0], GPUMemoryTracker::Category::RenderTarget, mOwner, qint64(width) * height * GPUMemoryTracker::GetBytesPerPixel(GL_RGBA32I));
 
     glGenTextures(1, &mTextures[1]);
     glBindTexture(GL_TEXTURE_2D, mTextures[1]);
@@ -37,11 +40,13 @@ void Canavar::Engine::OpenGLFramebuffer::Create(int width, int height)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, mTextures[1], 0);
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Texture, mTextures[1], GPUMemoryTracker::Category::RenderTarget, mOwner, qint64(width) * height * GPUMemoryTracker::GetBytesPerPixel(GL_RGBA32I));
 
     glGenRenderbuffers(1, &mRBO);
     glBindRenderbuffer(GL_RENDERBUFFER, mRBO);
     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, mRBO);
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Renderbuffer, mRBO, GPUMemoryTracker::Category::RenderTarget, mOwner, qint64(width) * height * GPUMemoryTracker::GetBytesPerPixel(GL_DEPTH24_STENCIL8));
 
     glDrawBuffers(2, mColorAttachments);
 
@@ -59,6 +64,11 @@ void Canavar::Engine::OpenGLFramebuffer::Destroy()
     if (mFBO)
         glDeleteFramebuffers(1, &mFBO);
 
+    auto tracker = GPUMemoryTracker::Instance();
+    tracker->Free(GPUMemoryTracker::Resource::Texture, mTextures[0]);
+    tracker->Free(GPUMemoryTracker::Resource::Texture, mTextures[1]);
+    tracker->Free(GPUMemoryTracker::Resource::Renderbuffer, mRBO);
+
     if (mTextures[0])
         glDeleteTextures(1, &mTextures[0]);
 
@@ -66,7 +76,7 @@ void Canavar::Engine::OpenGLFramebuffer::Destroy()
         glDeleteTextures(1, &mTextures[1]);
 
     if (mRBO)
-        glDeleteBuffers(1, &mRBO);
+        glDeleteRenderbuffers(1, &mRBO);
 
     mCreated = false;
 }
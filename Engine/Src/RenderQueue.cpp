@@ -0,0 +1,406 @@
+#include "RenderQueue.h"
+#include "GPUMemoryTracker.h"
+#include "GeometryArena.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "Model.h"
+#include "ShaderManager.h"
+
+#include <QOpenGLFunctions_4_3_Core>
+#include <QOpenGLVersionFunctionsFactory>
+
+#include <algorithm>
+
+// Sort key layout, most significant first:
+// pass (4 bits) | shader (6 bits) | material (20 bits) | VAO (16 bits) | depth (18 bits)
+namespace {
+    constexpr int DEPTH_BITS = 18;
+    constexpr int VAO_BITS = 16;
+    constexpr int MATERIAL_BITS = 20;
+    constexpr int SHADER_BITS = 6;
+    constexpr int PASS_BITS = 4;
+
+    constexpr int VAO_SHIFT = DEPTH_BITS;
+    constexpr int MATERIAL_SHIFT = VAO_SHIFT + VAO_BITS;
+    constexpr int SHADER_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+    constexpr int PASS_SHIFT = SHADER_SHIFT + SHADER_BITS;
+
+    constexpr quint64 Mask(int bits)
+    {
+        return (quint64(1) << bits) - 1;
+    }
+} // namespace
+
+Canavar::Engine::RenderQueue::RenderQueue()
+    : mShaderManager(nullptr)
+    , mFunctions43(nullptr)
+    , mPrepared(false)
+    , mIndirectBuffer(0)
+    , mNextCommand(0)
+    , mCurrentShader(ShaderType::None)
+    , mCurrentMaterial(nullptr)
+    , mCurrentVAO(0)
+    , mSortingEnabled(true)
+    , mMaxDepth(1000000.0f)
+    , mNumberOfDrawCalls(0)
+    , mNumberOfShaderSwitches(0)
+    , mNumberOfTextureBinds(0)
+    , mNumberOfVAOBinds(0)
+    , mNumberOfIndirectCommands(0)
+{
+    std::fill(std::begin(mBoundTextures), std::end(mBoundTextures), 0);
+}
+
+void Canavar::Engine::RenderQueue::Init()
+{
+    initializeOpenGLFunctions();
+
+    mShaderManager = ShaderManager::Instance();
+
+    mInstanceOffsetUniform = mShaderManager->GetUniformHandle("instanceOffset");
+    mIndirectUniform = mShaderManager->GetUniformHandle("indirect");
+
+    if (auto context = QOpenGLContext::currentContext(); context && context->format().version() >= qMakePair(4, 3))
+        mFunctions43 = QOpenGLVersionFunctionsFactory::get<QOpenGLFunctions_4_3_Core>(context);
+
+    if (mFunctions43)
+        glGenBuffers(1, &mIndirectBuffer);
+    else
+        qWarning() << Q_FUNC_INFO << "OpenGL 4.3 core functions are not available, indirect drawing is disabled.";
+
+    mUseTextureUniforms[0] = mShaderManager->GetUniformHandle("useTextureAmbient");
+    mUseTextureUniforms[1] = mShaderManager->GetUniformHandle("useTextureDiffuse");
+    mUseTextureUniforms[2] = mShaderManager->GetUniformHandle("useTextureSpecular");
+    mUseTextureUniforms[3] = mShaderManager->GetUniformHandle("useTextureNormal");
+
+    mTextureUniforms[0] = mShaderManager->GetUniformHandle("textureAmbient");
+    mTextureUniforms[1] = mShaderManager->GetUniformHandle("textureDiffuse");
+    mTextureUniforms[2] = mShaderManager->GetUniformHandle("textureSpecular");
+    mTextureUniforms[3] = mShaderManager->GetUniformHandle("textureNormal");
+}
+
+void Canavar::Engine::RenderQueue::Clear()
+{
+    mPackets.clear();
+    mPrepared = false;
+}
+
+void Canavar::Engine::RenderQueue::AddMesh(Mesh* mesh, Model* model, const QMatrix4x4* nodeTransformation, float depth)
+{
+    DrawPacket packet;
+    packet.key = MakeKey(Pass::Opaque, GetShaderType(mesh, false), mesh, mesh->GetVAO()->objectId(), depth);
+    packet.mesh = mesh;
+    packet.model = model;
+    packet.nodeTransformation = nodeTransformation;
+    packet.firstInstance = 0;
+    packet.instanceCount = 1;
+    packet.lod = model->GetLod();
+    packet.indirect = false;
+
+    mPackets << packet;
+}
+
+void Canavar::Engine::RenderQueue::AddInstancedMesh(Mesh* mesh, int lod, int firstInstance, int count, float depth)
+{
+    DrawPacket packet;
+    packet.key = MakeKey(Pass::Opaque, GetShaderType(mesh, true), mesh, mesh->GetVAO()->objectId(), depth);
+    packet.mesh = mesh;
+    packet.model = nullptr;
+    packet.nodeTransformation = nullptr;
+    packet.firstInstance = firstInstance;
+    packet.instanceCount = count;
+    packet.lod = lod;
+    packet.indirect = false;
+
+    mPackets << packet;
+}
+
+void Canavar::Engine::RenderQueue::AddIndirectMesh(Mesh* mesh, int lod, int firstInstance, int count, float depth)
+{
+    const GLuint vao = GeometryArena::Instance()->GetVAO(mesh->GetArenaAllocation().page);
+
+    DrawPacket packet;
+    packet.key = MakeKey(Pass::Opaque, GetShaderType(mesh, true), mesh, vao, depth);
+    packet.mesh = mesh;
+    packet.model = nullptr;
+    packet.nodeTransformation = nullptr;
+    packet.firstInstance = firstInstance;
+    packet.instanceCount = count;
+    packet.lod = lod;
+    packet.indirect = true;
+
+    mPackets << packet;
+}
+
+void Canavar::Engine::RenderQueue::Submit()
+{
+    mNumberOfDrawCalls = 0;
+    mNumberOfShaderSwitches = 0;
+    mNumberOfTextureBinds = 0;
+    mNumberOfVAOBinds = 0;
+
+    if (!mPrepared)
+        Prepare();
+
+    // Other passes bind textures too, nothing is known about the units here
+    std::fill(std::begin(mBoundTextures), std::end(mBoundTextures), 0);
+
+    mCurrentShader = ShaderType::None;
+    mCurrentMaterial = nullptr;
+    mCurrentVAO = 0;
+    mNextCommand = 0;
+
+    if (!mCommands.isEmpty())
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+
+    for (int i = 0; i < mPackets.size();)
+    {
+        const auto& packet = mPackets[i];
+
+        if (!mSortingEnabled)
+        {
+            mCurrentShader = ShaderType::None;
+            mCurrentMaterial = nullptr;
+            mCurrentVAO = 0;
+            std::fill(std::begin(mBoundTextures), std::end(mBoundTextures), 0);
+        }
+
+        BindShader(GetShaderType(packet.mesh, packet.model == nullptr));
+        BindMaterial(packet.mesh->GetMaterial());
+        BindVAO(GetVAO(packet));
+
+        if (packet.indirect)
+        {
+            i += SubmitIndirect(i);
+        }
+        else if (packet.model)
+        {
+            packet.mesh->SetModelUniforms(packet.model, *packet.nodeTransformation);
+            glDrawElements(GL_TRIANGLES, packet.mesh->GetNumberOfIndices(packet.lod), packet.mesh->GetIndexType(), packet.mesh->GetIndexOffset(packet.lod));
+            ++i;
+        }
+        else
+        {
+            packet.mesh->SetVertexFormatUniforms();
+            mShaderManager->SetUniformValue(mIndirectUniform, false);
+            mShaderManager->SetUniformValue(mInstanceOffsetUniform, packet.firstInstance);
+            glDrawElementsInstanced(GL_TRIANGLES, packet.mesh->GetNumberOfIndices(packet.lod), packet.mesh->GetIndexType(), packet.mesh->GetIndexOffset(packet.lod), packet.instanceCount);
+            ++i;
+        }
+
+        mNumberOfDrawCalls++;
+    }
+
+    if (mCurrentVAO)
+        glBindVertexArray(0);
+
+    if (!mCommands.isEmpty())
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    if (mCurrentShader != ShaderType::None)
+        mShaderManager->Release();
+
+    mCurrentShader = ShaderType::None;
+    mCurrentMaterial = nullptr;
+    mCurrentVAO = 0;
+}
+
+void Canavar::Engine::RenderQueue::Prepare()
+{
+    if (mSortingEnabled)
+        std::sort(mPackets.begin(), mPackets.end(), [](const DrawPacket& a, const DrawPacket& b) { return a.key < b.key; });
+
+    UploadIndirectCommands();
+    mPrepared = true;
+}
+
+void Canavar::Engine::RenderQueue::UploadIndirectCommands()
+{
+    // One command per indirect packet, in submission order, so every run of packets maps to a contiguous range
+    mCommands.clear();
+    mCommandMeshes.clear();
+
+    for (const auto& packet : qAsConst(mPackets))
+    {
+        if (!packet.indirect)
+            continue;
+
+        const auto& allocation = packet.mesh->GetArenaAllocation();
+
+        DrawElementsIndirectCommand command;
+        command.count = packet.mesh->GetNumberOfIndices(packet.lod);
+        command.instanceCount = packet.instanceCount;
+        command.firstIndex = allocation.firstIndex + packet.mesh->GetFirstIndex(packet.lod);
+        command.baseVertex = allocation.baseVertex;
+        command.baseInstance = packet.firstInstance;
+        mCommands << command;
+        mCommandMeshes << packet.mesh;
+    }
+
+    mNumberOfIndirectCommands = mCommands.size();
+
+    if (mCommands.isEmpty())
+        return;
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, mCommands.size() * sizeof(DrawElementsIndirectCommand), mCommands.constData(), GL_STREAM_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Buffer, mIndirectBuffer, GPUMemoryTracker::Category::StorageBuffer, "Pass: Models", mCommands.size() * sizeof(DrawElementsIndirectCommand));
+}
+
+int Canavar::Engine::RenderQueue::SubmitIndirect(int first)
+{
+    const DrawPacket& packet = mPackets[first];
+    const ShaderType shader = GetShaderType(packet.mesh, true);
+    const bool textured = shader == ShaderType::ModelTexturedInstancedShader;
+    const GLuint vao = GetVAO(packet);
+
+    int count = 1;
+
+    // Colored meshes share one state, only textured ones are split by material
+    if (mSortingEnabled)
+    {
+        for (int i = first + 1; i < mPackets.size(); ++i, ++count)
+        {
+            const DrawPacket& next = mPackets[i];
+
+            if (!next.indirect || GetShaderType(next.mesh, true) != shader || GetVAO(next) != vao)
+                break;
+
+            if (textured && next.mesh->GetMaterial() != packet.mesh->GetMaterial())
+                break;
+        }
+    }
+
+    packet.mesh->SetVertexFormatUniforms();
+    mShaderManager->SetUniformValue(mIndirectUniform, true);
+    mFunctions43->glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(mNextCommand * sizeof(DrawElementsIndirectCommand)), count, 0);
+    mNextCommand += count;
+
+    return count;
+}
+
+const QVector<Canavar::Engine::RenderQueue::DrawElementsIndirectCommand>& Canavar::Engine::RenderQueue::GetIndirectCommands() const
+{
+    return mCommands;
+}
+
+const QVector<Canavar::Engine::Mesh*>& Canavar::Engine::RenderQueue::GetIndirectMeshes() const
+{
+    return mCommandMeshes;
+}
+
+GLuint Canavar::Engine::RenderQueue::GetIndirectBuffer() const
+{
+    return mIndirectBuffer;
+}
+
+bool Canavar::Engine::RenderQueue::IsIndirectDrawingSupported() const
+{
+    return mFunctions43 != nullptr;
+}
+
+quint64 Canavar::Engine::RenderQueue::MakeKey(Pass pass, ShaderType shader, Mesh* mesh, GLuint vao, float depth)
+{
+    quint64 materialID = 0;
+
+    // Colored meshes share one state, only textured materials need their own ID
+    if (Material* material = mesh->GetMaterial(); material && material->GetNumberOfTextures())
+        materialID = material->GetID();
+
+    const float normalizedDepth = qBound(0.0f, depth / qMax(mMaxDepth, 1.0f), 1.0f);
+    const quint64 quantizedDepth = quint64(normalizedDepth * Mask(DEPTH_BITS));
+
+    quint64 key = 0;
+    key |= (quint64(pass) & Mask(PASS_BITS)) << PASS_SHIFT;
+    key |= (quint64(shader) & Mask(SHADER_BITS)) << SHADER_SHIFT;
+    key |= (materialID & Mask(MATERIAL_BITS)) << MATERIAL_SHIFT;
+    key |= (quint64(vao) & Mask(VAO_BITS)) << VAO_SHIFT;
+    key |= quantizedDepth & Mask(DEPTH_BITS);
+
+    return key;
+}
+
+Canavar::Engine::ShaderType Canavar::Engine::RenderQueue::GetShaderType(Mesh* mesh, bool instanced) const
+{
+    const bool textured = mesh->GetMaterial() && mesh->GetMaterial()->GetNumberOfTextures();
+
+    if (instanced)
+        return textured ? ShaderType::ModelTexturedInstancedShader : ShaderType::ModelColoredInstancedShader;
+    else
+        return textured ? ShaderType::ModelTexturedShader : ShaderType::ModelColoredShader;
+}
+
+void Canavar::Engine::RenderQueue::BindShader(ShaderType shader)
+{
+    if (mCurrentShader == shader)
+        return;
+
+    mShaderManager->Bind(shader);
+    mCurrentShader = shader;
+    mCurrentMaterial = nullptr;
+    mNumberOfShaderSwitches++;
+
+    // Sampler units are fixed, see Mesh::SetTextureUniforms
+    if (shader == ShaderType::ModelTexturedShader || shader == ShaderType::ModelTexturedInstancedShader)
+        for (int unit = 0; unit < 4; ++unit)
+            mShaderManager->SetUniformValue(mTextureUniforms[unit], unit);
+}
+
+void Canavar::Engine::RenderQueue::BindMaterial(Material* material)
+{
+    if (mCurrentMaterial == material)
+        return;
+
+    mCurrentMaterial = material;
+
+    if (material == nullptr || material->GetNumberOfTextures() == 0)
+        return;
+
+    QOpenGLTexture* textures[4];
+    textures[0] = material->Get(Material::TextureType::Ambient);
+    textures[1] = material->Get(Material::TextureType::Diffuse);
+    textures[2] = material->Get(Material::TextureType::Specular);
+    textures[3] = material->Get(Material::TextureType::Normal);
+
+    // Use diffuse texture if there is no ambient texture
+    if (textures[0] == nullptr)
+        textures[0] = textures[1];
+
+    for (int unit = 0; unit < 4; ++unit)
+    {
+        mShaderManager->SetUniformValue(mUseTextureUniforms[unit], textures[unit] != nullptr);
+
+        if (textures[unit])
+            BindTexture(unit, textures[unit]->textureId());
+    }
+}
+
+void Canavar::Engine::RenderQueue::BindTexture(int unit, GLuint id)
+{
+    if (mBoundTextures[unit] == id)
+        return;
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, id);
+    mBoundTextures[unit] = id;
+    mNumberOfTextureBinds++;
+}
+
+GLuint Canavar::Engine::RenderQueue::GetVAO(const DrawPacket& packet) const
+{
+    if (packet.indirect)
+        return GeometryArena::Instance()->GetVAO(packet.mesh->GetArenaAllocation().page);
+    else
+        return packet.mesh->GetVAO()->objectId();
+}
+
+void Canavar::Engine::RenderQueue::BindVAO(GLuint vao)
+{
+    if (mCurrentVAO == vao)
+        return;
+
+    glBindVertexArray(vao);
+    mCurrentVAO = vao;
+    mNumberOfVAOBinds++;
+}
@@ -2,10 +2,13 @@
 #include "CameraManager.h"
 #include "Config.h"
 #include "FirecrackerEffect.h"
+#include "GPUMemoryTracker.h"
+#include "GeometryArena.h"
 #include "Haze.h"
 #include "Helper.h"
 #include "LightManager.h"
 #include "Model.h"
+#include "ModelData.h"
 #include "ModelDataManager.h"
 #include "NodeManager.h"
 #include "NozzleEffect.h"
@@ -16,14 +19,35 @@
 #include "Terrain.h"
 
 #include <QDir>
+#include <QSet>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 Canavar::Engine::RendererManager::RendererManager()
     : Manager()
+    , mInstanceBuffer(0)
+    , mInstanceBufferCapacity(0)
     , mWidth(1600)
     , mHeight(900)
     , mBlurPass(4)
     , mExposure(1.0f)
     , mGamma(1.0f)
+    , mFrustumCullingEnabled(true)
+    , mNumberOfDrawnNodes(0)
+    , mNumberOfCulledNodes(0)
+    , mInstancingEnabled(true)
+    , mNumberOfInstancedDrawCalls(0)
+    , mIndirectDrawingEnabled(false)
+    , mGPUCullingEnabled(false)
+    , mOcclusionCullingEnabled(false)
+    , mNumberOfOcclusionTestedNodes(0)
+    , mNumberOfOccludedNodes(0)
+    , mLodEnabled(true)
+    , mLodPixelError(1.0f)
+    , mImpostorsEnabled(false)
+    , mImpostorDistance(1000.0f)
     , mColorAttachments{ GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 }
 {}
 
@@ -41,6 +65,23 @@ bool Canavar::Engine::RendererManager::Init()
     mLightManager = LightManager::Instance();
     mShaderManager = ShaderManager::Instance();
     mModelDataManager = ModelDataManager::Instance();
+    mTracker = GPUMemoryTracker::Instance();
+
+    connect(mModelDataManager, &ModelDataManager::ModelDataEvicted, this, &RendererManager::OnModelDataEvicted);
+
+    mMVPUniform = mShaderManager->GetUniformHandle("MVP");
+    mVPUniform = mShaderManager->GetUniformHandle("VP");
+    mColorUniform = mShaderManager->GetUniformHandle("color");
+    mScaleUniform = mShaderManager->GetUniformHandle("scale");
+    mSelectedVertexIDUniform = mShaderManager->GetUniformHandle("selectedVertexID");
+    mVertexColorUniform = mShaderManager->GetUniformHandle("vertexColor");
+    mSelectedVertexColorUniform = mShaderManager->GetUniformHandle("selectedVertexColor");
+    mHorizontalUniform = mShaderManager->GetUniformHandle("horizontal");
+    mScreenTextureUniform = mShaderManager->GetUniformHandle("screenTexture");
+    mSceneTextureUniform = mShaderManager->GetUniformHandle("sceneTexture");
+    mBloomBlurTextureUniform = mShaderManager->GetUniformHandle("bloomBlurTexture");
+    mExposureUniform = mShaderManager->GetUniformHandle("exposure");
+    mGammaUniform = mShaderManager->GetUniformHandle("gamma");
 
     mSky = Sky::Instance();
     mSun = Sun::Instance();
@@ -74,6 +115,7 @@ bool Canavar::Engine::RendererManager::Init()
     glGenBuffers(1, &mQuad.mVBO);
     glBindBuffer(GL_ARRAY_BUFFER, mQuad.mVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(Canavar::Engine::QUAD), Canavar::Engine::QUAD, GL_STATIC_DRAW);
+    mTracker->Allocate(GPUMemoryTracker::Resource::Buffer, mQuad.mVBO, GPUMemoryTracker::Category::VertexBuffer, "RendererManager", sizeof(Canavar::Engine::QUAD));
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(QVector2D), (void*)0);
     glEnableVertexAttribArray(1);
@@ -85,6 +127,7 @@ bool Canavar::Engine::RendererManager::Init()
     glGenBuffers(1, &mCube.mVBO);
     glBindBuffer(GL_ARRAY_BUFFER, mCube.mVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(Canavar::Engine::CUBE), CUBE, GL_STATIC_DRAW);
+    mTracker->Allocate(GPUMemoryTracker::Resource::Buffer, mCube.mVBO, GPUMemoryTracker::Category::VertexBuffer, "RendererManager", sizeof(Canavar::Engine::CUBE));
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(QVector3D), (void*)0);
     glEnableVertexAttribArray(0);
 
@@ -94,15 +137,35 @@ bool Canavar::Engine::RendererManager::Init()
     glGenBuffers(1, &mCubeStrip.mVBO);
     glBindBuffer(GL_ARRAY_BUFFER, mCubeStrip.mVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(Canavar::Engine::CUBE_STRIP), CUBE_STRIP, GL_STATIC_DRAW);
+    mTracker->Allocate(GPUMemoryTracker::Resource::Buffer, mCubeStrip.mVBO, GPUMemoryTracker::Category::VertexBuffer, "RendererManager", sizeof(Canavar::Engine::CUBE_STRIP));
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(QVector3D), (void*)0);
     glEnableVertexAttribArray(0);
 
+    // Per-instance data for instanced model rendering
+    glGenBuffers(1, &mInstanceBuffer);
+
+    mRenderQueue.Init();
+    mIndirectDrawingEnabled = mConfig->GetGeometryArenaEnabled() && mRenderQueue.IsIndirectDrawingSupported();
+    mGPUCulling.Init();
+    mOcclusionCulling.Init();
+    mOcclusionCulling.Resize(mWidth, mHeight);
+    mImpostorRenderer.Init();
+
+    // Per-frame data shared by all lit shaders
+    glGenBuffers(1, &mFrameDataBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, mFrameDataBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_DYNAMIC_DRAW);
+    mTracker->Allocate(GPUMemoryTracker::Resource::Buffer, mFrameDataBuffer, GPUMemoryTracker::Category::UniformBuffer, "RendererManager", sizeof(FrameData));
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING_POINT, mFrameDataBuffer);
+
     // Line Strip
     glGenVertexArrays(1, &mLineStripHandle.mVAO);
     glBindVertexArray(mLineStripHandle.mVAO);
     glGenBuffers(1, &mLineStripHandle.mVBO);
     glBindBuffer(GL_ARRAY_BUFFER, mLineStripHandle.mVBO);
     glBufferData(GL_ARRAY_BUFFER, 64 * sizeof(QVector3D), nullptr, GL_DYNAMIC_COPY);
+    mTracker->Allocate(GPUMemoryTracker::Resource::Buffer, mLineStripHandle.mVBO, GPUMemoryTracker::Category::VertexBuffer, "RendererManager", 64 * sizeof(QVector3D));
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(QVector3D), (void*)0);
     glEnableVertexAttribArray(0);
 
@@ -116,61 +179,478 @@ void Canavar::Engine::RendererManager::Resize(int w, int h)
 
     DeleteFramebuffers();
     CreateFramebuffers(mWidth, mHeight);
+
+    mOcclusionCulling.Resize(mWidth, mHeight);
 }
 
-void Canavar::Engine::RendererManager::Render(float ifps)
+void Canavar::Engine::RendererManager::Update(float ifps)
 {
     mCamera = mCameraManager->GetActiveCamera();
-    mClosePointLights = Helper::GetClosePointLights(mLightManager->GetPointLights(), mCamera->WorldPosition(), 8);
 
-    // Common uniforms
-    mShaderManager->Bind(ShaderType::ModelColoredShader);
-    SetCommonUniforms();
-    mShaderManager->Release();
+    // Particles are simulated even when they are not visible
+    for (const auto& effect : mNodeManager->GetNozzleEffects())
+        if (effect->GetVisible())
+            effect->Update(ifps);
 
-    mShaderManager->Bind(ShaderType::ModelTexturedShader);
-    SetCommonUniforms();
-    mShaderManager->Release();
+    for (const auto& effect : mNodeManager->GetFirecrackerEffects())
+        if (effect->GetVisible())
+            effect->Update(ifps);
 
-    mShaderManager->Bind(ShaderType::TerrainShader);
-    SetCommonUniforms();
-    mShaderManager->Release();
+    Cull();
+}
 
-    mFBOs[FramebufferType::Default]->bind();
-    glClearColor(0, 0, 0, 1);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+void Canavar::Engine::RendererManager::Cull()
+{
+    mFrustum.Update(mCamera->GetViewProjectionMatrix());
 
-    // Render Sky
-    mSky->Render();
+    mVisibleModels.clear();
+    mVisibleNozzleEffects.clear();
+    mVisibleFirecrackerEffects.clear();
 
-    // Render terrain
-    mTerrain->Render();
+    const int total = mNodeManager->GetModels().size() + mNodeManager->GetNozzleEffects().size() + mNodeManager->GetFirecrackerEffects().size();
+    const bool gpuCulling = IsGPUCullingActive();
 
-    const auto& nodes = mNodeManager->GetNodes();
+    mNumberOfOcclusionTestedNodes = 0;
+    mNumberOfOccludedNodes = 0;
+
+    // A pyramid left from before the feature was disabled shows an old view
+    if (mOcclusionCullingEnabled)
+        mOcclusionCulling.Update(mCamera->WorldPosition(), mCamera->WorldRotation());
+    else
+        mOcclusionCulling.Invalidate();
+
+    const auto& nodes = mFrustumCullingEnabled ? mNodeManager->QueryFrustum(mFrustum) : mNodeManager->GetNodes();
 
-    // Render Models
     for (const auto& node : nodes)
     {
         if (!node->GetVisible())
             continue;
 
-        if (auto model = dynamic_cast<Model*>(node))
-            model->Render(RenderMode::Default);
+        switch (node->GetType())
+        {
+        case Node::NodeType::Model: {
+            auto model = static_cast<Model*>(node);
+            ModelData* data = model->GetData();
+
+            // The compute pass tests the arena meshes against the pyramid per instance
+            if ((gpuCulling && data && data->IsInArena()) || !IsOccluded(model))
+                mVisibleModels << model;
+            break;
+        }
+        case Node::NodeType::NozzleEffect:
+            mVisibleNozzleEffects << static_cast<NozzleEffect*>(node);
+            break;
+        case Node::NodeType::FirecrackerEffect:
+            mVisibleFirecrackerEffects << static_cast<FirecrackerEffect*>(node);
+            break;
+        default:
+            break;
+        }
     }
 
-    // Render Effects
-    for (const auto& node : nodes)
+    // Hidden nodes are counted as culled too
+    mNumberOfDrawnNodes = mVisibleModels.size() + mVisibleNozzleEffects.size() + mVisibleFirecrackerEffects.size();
+    mNumberOfCulledNodes = total - mNumberOfDrawnNodes;
+}
+
+void Canavar::Engine::RendererManager::RenderModels()
+{
+    mNumberOfInstancedDrawCalls = 0;
+
+    mRenderQueue.Clear();
+    mRenderQueue.SetMaxDepth(mCamera->GetZFar());
+    mInstanceData.clear();
+    mInstanceCandidates.clear();
+    mImpostorRenderer.Clear();
+
+    // Atlases requested last frame, the default framebuffer is bound again afterwards
+    if (mImpostorsEnabled)
+        mImpostorRenderer.Bake(mFBOs[FramebufferType::Default]->handle(), mWidth, mHeight);
+
+    const auto& cameraPosition = mCamera->WorldPosition();
+
+    // Group by shared geometry when instancing or indirect drawing is enabled
+    const bool indirect = mIndirectDrawingEnabled && mRenderQueue.IsIndirectDrawingSupported();
+    const bool gpuCulling = IsGPUCullingActive();
+    QHash<QPair<ModelData*, int>, QVector<Model*>> groups; // By data and level of detail
+    QVector<Model*> placeholders;
+
+    // Pixels per world unit at distance 1, P(1, 1) is the cotangent of half the vertical field of view
+    const float pixelsPerUnit = 0.5f * mHeight * mCamera->GetProjectionMatrix()(1, 1);
+
+    mNumberOfModelsPerLod.fill(0);
+
+    // Off-screen models keep their slots, only the ones that moved since the last frame with GPU culling are refilled
+    if (gpuCulling)
+        for (const auto& model : mNodeManager->TakeMovedModels())
+            if (const auto it = mSlotsByModel.constFind(model); it != mSlotsByModel.constEnd())
+                UpdateInstanceSlots(model, it.value().first, true);
+
+    for (const auto& model : qAsConst(mVisibleModels))
     {
-        if (!node->GetVisible())
+        ModelData* data = model->GetData();
+
+        if (!data)
+        {
+            placeholders << model;
             continue;
+        }
+
+        mModelDataManager->MarkRendered(data);
+
+        if (mImpostorsEnabled && (model->WorldPosition() - cameraPosition).length() > mImpostorDistance && mImpostorRenderer.Add(model))
+            continue;
+
+        SelectLod(model, pixelsPerUnit);
 
-        if (auto effect = dynamic_cast<NozzleEffect*>(node))
-            effect->Render(ifps);
+        if (model->GetLod() >= mNumberOfModelsPerLod.size())
+            mNumberOfModelsPerLod.resize(model->GetLod() + 1);
 
-        if (auto effect = dynamic_cast<FirecrackerEffect*>(node))
-            effect->Render(ifps);
+        mNumberOfModelsPerLod[model->GetLod()]++;
+
+        // Colors and overlays are not tracked, the slots of the visible models are compared instead
+        if (gpuCulling)
+            UpdateInstanceSlots(model, GetInstanceSlots(model), false);
+
+        if (mInstancingEnabled || indirect)
+            groups[qMakePair(data, model->GetLod())] << model;
+        else
+            for (const auto& entry : data->GetDrawList())
+                mRenderQueue.AddMesh(entry.mesh, model, &entry.transformation, (model->WorldPosition() - cameraPosition).length());
     }
 
+    // The instances built below follow the slots in the storage block
+    const int firstFrameInstance = mInstanceSlots.size();
+
+    for (auto it = groups.constBegin(); it != groups.constEnd(); ++it)
+    {
+        ModelData* data = it.key().first;
+        const int lod = it.key().second;
+        const auto& models = it.value();
+        const auto& drawList = data->GetDrawList();
+
+        float nearest = std::numeric_limits<float>::infinity();
+
+        for (const auto& model : models)
+            nearest = qMin(nearest, (model->WorldPosition() - cameraPosition).length());
+
+        QVector<int> firstSlots;
+
+        if (gpuCulling)
+            for (const auto& model : models)
+                firstSlots << mSlotsByModel.value(model).first;
+
+        for (int i = 0; i < drawList.size(); ++i)
+        {
+            const auto& entry = drawList[i];
+            const bool inArena = indirect && entry.mesh->IsInArena();
+
+            // The compute pass keeps the visible ones among the slots, nothing else goes up for them
+            if (inArena && gpuCulling)
+            {
+                const int firstCandidate = mInstanceCandidates.size();
+
+                for (const int firstSlot : qAsConst(firstSlots))
+                    mInstanceCandidates << GLuint(firstSlot + i);
+
+                mRenderQueue.AddIndirectMesh(entry.mesh, lod, firstCandidate, models.size(), nearest);
+                continue;
+            }
+
+            // Not worth an instanced draw, arena meshes are merged into multi-draws regardless
+            if (!inArena && (!mInstancingEnabled || models.size() < 2))
+            {
+                for (const auto& model : models)
+                    mRenderQueue.AddMesh(entry.mesh, model, &entry.transformation, (model->WorldPosition() - cameraPosition).length());
+
+                continue;
+            }
+
+            const int firstInstance = mInstanceData.size();
+            mInstanceData.resize(firstInstance + models.size());
+
+            for (int j = 0; j < models.size(); ++j)
+                FillInstanceData(mInstanceData[firstInstance + j], models[j], entry.mesh, entry.transformation);
+
+            if (inArena)
+            {
+                mRenderQueue.AddIndirectMesh(entry.mesh, lod, firstFrameInstance + firstInstance, models.size(), nearest);
+            }
+            else
+            {
+                mRenderQueue.AddInstancedMesh(entry.mesh, lod, firstFrameInstance + firstInstance, models.size(), nearest);
+                mNumberOfInstancedDrawCalls++;
+            }
+        }
+    }
+
+    UploadInstances();
+
+    // The instance index attribute of the arena pages must cover every instance drawn, GPU culling writes the indices itself
+    if (indirect)
+        GeometryArena::Instance()->ReserveInstances(gpuCulling ? mInstanceCandidates.size() : firstFrameInstance + mInstanceData.size(), !gpuCulling);
+
+    // The indirect commands must be in their final order before the compute pass rewrites them
+    if (gpuCulling && !mInstanceCandidates.isEmpty())
+    {
+        mRenderQueue.Prepare();
+        mGPUCulling.Cull(mFrustum, mRenderQueue, mInstanceBuffer, sizeof(InstanceData), mInstanceCandidates, mOcclusionCullingEnabled ? &mOcclusionCulling : nullptr);
+    }
+
+    mRenderQueue.Submit();
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+
+    mImpostorRenderer.Render(mQuad.mVAO);
+
+    // Models whose data is still loading are shown as their bounding box
+    if (!placeholders.isEmpty())
+    {
+        const auto& VP = mCamera->GetViewProjectionMatrix();
+
+        mShaderManager->Bind(ShaderType::BasicShader);
+        mShaderManager->SetUniformValue(mColorUniform, QVector4D(0.5f, 0.5f, 0.5f, 1.0f));
+        glBindVertexArray(mCubeStrip.mVAO);
+
+        for (const auto& model : placeholders)
+        {
+            mShaderManager->SetUniformValue(mMVPUniform, VP * model->WorldTransformation() * model->GetAABB().GetTransformation());
+            glDrawArrays(GL_LINE_STRIP, 0, 17);
+        }
+
+        glBindVertexArray(0);
+        mShaderManager->Release();
+    }
+}
+
+void Canavar::Engine::RendererManager::SelectLod(Model* model, float pixelsPerUnit)
+{
+    ModelData* data = model->GetData();
+    const int numberOfLods = data->GetNumberOfLods();
+
+    if (!mLodEnabled || numberOfLods == 1)
+    {
+        model->SetLod(0);
+        return;
+    }
+
+    const AABB& aabb = model->GetAABB();
+    const QMatrix4x4& world = model->WorldTransformation();
+    const float diagonal = (aabb.GetMax() - aabb.GetMin()).length();
+
+    if (qFuzzyIsNull(diagonal))
+    {
+        model->SetLod(0);
+        return;
+    }
+
+    float scale = 0.0f;
+
+    for (int column = 0; column < 3; ++column)
+        scale = qMax(scale, world.column(column).toVector3D().length());
+
+    // Projected size of the bounding box in pixels, the errors are relative to its model space size
+    const float distance = qMax((world.map(aabb.GetCenter()) - mCamera->WorldPosition()).length(), mCamera->GetZNear());
+    const float projectedSize = scale * diagonal * pixelsPerUnit / distance;
+    const float threshold = mLodPixelError * std::exp2(model->GetLodBias());
+
+    const auto pixelError = [=](int lod) { return data->GetLodError(lod) / diagonal * projectedSize; };
+
+    // Refine once the current level is clearly too coarse, coarsen once the next one is clearly fine enough
+    int lod = qBound(0, model->GetLod(), numberOfLods - 1);
+
+    while (lod > 0 && pixelError(lod) > threshold * LOD_HYSTERESIS)
+        lod--;
+
+    while (lod + 1 < numberOfLods && pixelError(lod + 1) < threshold / LOD_HYSTERESIS)
+        lod++;
+
+    model->SetLod(lod);
+}
+
+bool Canavar::Engine::RendererManager::IsOccluded(Model* model)
+{
+    if (!mOcclusionCullingEnabled)
+        return false;
+
+    mNumberOfOcclusionTestedNodes++;
+
+    if (!mOcclusionCulling.IsOccluded(model->GetAABB(), model->WorldTransformation()))
+        return false;
+
+    mNumberOfOccludedNodes++;
+    return true;
+}
+
+void Canavar::Engine::RendererManager::FillInstanceData(InstanceData& data, Model* model, Mesh* mesh, const QMatrix4x4& nodeTransformation)
+{
+    static_assert(sizeof(InstanceData) == 208, "InstanceData must match the std430 layout of Instance");
+
+    const auto& meshOverride = model->GetMeshOverride(mesh->GetID());
+    const QMatrix4x4 M = model->WorldTransformation() * nodeTransformation * meshOverride.transformation;
+    const QMatrix3x3 N = M.normalMatrix();
+
+    // QMatrix4x4 carries a flag word, copy the raw column-major floats only
+    memcpy(data.M, M.constData(), sizeof(data.M));
+
+    for (int column = 0; column < 4; ++column)
+        for (int row = 0; row < 4; ++row)
+            data.N[4 * column + row] = (column < 3 && row < 3) ? N(row, column) : (column == row ? 1.0f : 0.0f);
+
+    FillInstanceMaterial(data, model, mesh);
+}
+
+void Canavar::Engine::RendererManager::FillInstanceMaterial(InstanceData& data, Model* model, Mesh* mesh)
+{
+    const auto& meshOverride = model->GetMeshOverride(mesh->GetID());
+
+    data.color = model->GetColor();
+    data.overlayColor = model->GetOverlayColor();
+    data.meshOverlayColor = meshOverride.overlayColor;
+    data.overlayColorFactor = model->GetOverlayColorFactor();
+    data.meshOverlayColorFactor = meshOverride.overlayColorFactor;
+    data.ambient = model->GetAmbient();
+    data.diffuse = model->GetDiffuse();
+    data.specular = model->GetSpecular();
+    data.shininess = model->GetShininess();
+}
+
+int Canavar::Engine::RendererManager::GetInstanceSlots(Model* model)
+{
+    if (const auto it = mSlotsByModel.constFind(model); it != mSlotsByModel.constEnd())
+        return it.value().first;
+
+    const int numberOfSlots = model->GetData()->GetDrawList().size();
+    int firstSlot;
+
+    // Models sharing data have the same number of slots and reuse each other's ranges
+    if (const auto it = mFreeSlots.find(numberOfSlots); it != mFreeSlots.end())
+    {
+        firstSlot = it.value();
+        mFreeSlots.erase(it);
+    }
+    else
+    {
+        firstSlot = mInstanceSlots.size();
+        mInstanceSlots.resize(firstSlot + numberOfSlots);
+    }
+
+    mSlotsByModel.insert(model, qMakePair(firstSlot, numberOfSlots));
+    connect(model, &QObject::destroyed, this, &RendererManager::OnInstancedModelDestroyed);
+
+    UpdateInstanceSlots(model, firstSlot, true);
+
+    return firstSlot;
+}
+
+void Canavar::Engine::RendererManager::UpdateInstanceSlots(Model* model, int firstSlot, bool transformation)
+{
+    const auto& drawList = model->GetData()->GetDrawList();
+
+    for (int i = 0; i < drawList.size(); ++i)
+    {
+        InstanceData& slot = mInstanceSlots[firstSlot + i];
+
+        if (transformation)
+        {
+            FillInstanceData(slot, model, drawList[i].mesh, drawList[i].transformation);
+        }
+        else
+        {
+            InstanceData material = slot;
+            FillInstanceMaterial(material, model, drawList[i].mesh);
+
+            if (memcmp(&material, &slot, sizeof(InstanceData)) == 0)
+                continue;
+
+            slot = material;
+        }
+
+        mDirtySlots << firstSlot + i;
+    }
+}
+
+void Canavar::Engine::RendererManager::UploadInstances()
+{
+    const int numberOfInstances = mInstanceSlots.size() + mInstanceData.size();
+
+    if (numberOfInstances == 0)
+        return;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mInstanceBuffer);
+
+    // Growing respecifies the storage, all slots go up again
+    if (numberOfInstances > mInstanceBufferCapacity)
+    {
+        int capacity = qMax(mInstanceBufferCapacity, 64);
+
+        while (capacity < numberOfInstances)
+            capacity *= 2;
+
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW);
+        mTracker->Allocate(GPUMemoryTracker::Resource::Buffer, mInstanceBuffer, GPUMemoryTracker::Category::StorageBuffer, "Pass: Models", capacity * sizeof(InstanceData));
+        mInstanceBufferCapacity = capacity;
+
+        if (!mInstanceSlots.isEmpty())
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, mInstanceSlots.size() * sizeof(InstanceData), mInstanceSlots.constData());
+
+        mDirtySlots.clear();
+    }
+
+    // One upload per run of consecutive dirty slots
+    std::sort(mDirtySlots.begin(), mDirtySlots.end());
+    mDirtySlots.erase(std::unique(mDirtySlots.begin(), mDirtySlots.end()), mDirtySlots.end());
+
+    for (int i = 0; i < mDirtySlots.size();)
+    {
+        int j = i + 1;
+
+        while (j < mDirtySlots.size() && mDirtySlots[j] == mDirtySlots[j - 1] + 1)
+            j++;
+
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, mDirtySlots[i] * sizeof(InstanceData), (j - i) * sizeof(InstanceData), mInstanceSlots.constData() + mDirtySlots[i]);
+        i = j;
+    }
+
+    mDirtySlots.clear();
+
+    if (!mInstanceData.isEmpty())
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, mInstanceSlots.size() * sizeof(InstanceData), mInstanceData.size() * sizeof(InstanceData), mInstanceData.constData());
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mInstanceBuffer);
+}
+
+void Canavar::Engine::RendererManager::Render(float)
+{
+    mClosePointLights = Helper::GetClosePointLights(mLightManager->GetPointLights(), mCamera->WorldPosition(), 8);
+
+    // Common uniforms
+    UpdateFrameData();
+
+    mFBOs[FramebufferType::Default]->bind();
+    glClearColor(0, 0, 0, 1);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Render Sky
+    mSky->Render();
+
+    // Render terrain
+    mTerrain->Render();
+
+    // Render Models
+    RenderModels();
+
+    // Only the sky, the terrain and the models occlude, the pyramid is used by the next frame
+    if (mOcclusionCullingEnabled)
+        mOcclusionCulling.Build(mFBOs[FramebufferType::Default]->handle(), mCamera->GetViewProjectionMatrix());
+
+    // Render Effects
+    for (const auto& effect : mVisibleNozzleEffects)
+        effect->Render();
+
+    for (const auto& effect : mVisibleFirecrackerEffects)
+        effect->Render();
+
     // Selectables
     if (mConfig->GetNodeSelectionEnabled())
     {
@@ -182,9 +662,9 @@ void Canavar::Engine::RendererManager::Render(float ifps)
 
         for (const auto& node : nodes)
         {
-            mShaderManager->SetUniformValue("MVP", VP * node->WorldTransformation() * node->GetAABB().GetTransformation());
+            mShaderManager->SetUniformValue(mMVPUniform, VP * node->WorldTransformation() * node->GetAABB().GetTransformation());
 
-            mShaderManager->SetUniformValue("color", mSelectableNodes.value(node, QVector4D(1, 1, 1, 1)));
+            mShaderManager->SetUniformValue(mColorUniform, mSelectableNodes.value(node, QVector4D(1, 1, 1, 1)));
             glBindVertexArray(mCubeStrip.mVAO);
             glDrawArrays(GL_LINE_STRIP, 0, 17);
         }
@@ -192,9 +672,8 @@ void Canavar::Engine::RendererManager::Render(float ifps)
         for (const auto& model : models)
         {
             const auto& parameters = mSelectedMeshes.value(model);
-            const auto& meshTransformation = model->GetMeshTransformation(parameters.mMesh->GetName());
-            mShaderManager->SetUniformValue("MVP", VP * model->WorldTransformation() * meshTransformation * parameters.mMesh->GetAABB().GetTransformation());
-            mShaderManager->SetUniformValue("color", parameters.mMeshStripColor);
+            mShaderManager->SetUniformValue(mMVPUniform, VP * model->GetMeshWorldTransformation(parameters.mMesh) * parameters.mMesh->GetAABB().GetTransformation());
+            mShaderManager->SetUniformValue(mColorUniform, parameters.mMeshStripColor);
             glBindVertexArray(mCubeStrip.mVAO);
             glDrawArrays(GL_LINE_STRIP, 0, 17);
         }
@@ -210,11 +689,11 @@ void Canavar::Engine::RendererManager::Render(float ifps)
 
             if (parameters.mRenderVertices)
             {
-                mShaderManager->SetUniformValue("MVP", VP * model->WorldTransformation() * model->GetMeshTransformation(parameters.mMesh->GetName()));
-                mShaderManager->SetUniformValue("scale", parameters.mScale);
-                mShaderManager->SetUniformValue("selectedVertexID", parameters.mSelectedVertexID);
-                mShaderManager->SetUniformValue("vertexColor", parameters.mVertexColor);
-                mShaderManager->SetUniformValue("selectedVertexColor", parameters.mSelectedVertexColor);
+                mShaderManager->SetUniformValue(mMVPUniform, VP * model->GetMeshWorldTransformation(parameters.mMesh));
+                mShaderManager->SetUniformValue(mScaleUniform, parameters.mScale);
+                mShaderManager->SetUniformValue(mSelectedVertexIDUniform, parameters.mSelectedVertexID);
+                mShaderManager->SetUniformValue(mVertexColorUniform, parameters.mVertexColor);
+                mShaderManager->SetUniformValue(mSelectedVertexColorUniform, parameters.mSelectedVertexColor);
 
                 parameters.mMesh->GetVerticesVAO()->bind();
                 glDrawArraysInstanced(GL_TRIANGLES, 0, 36, parameters.mMesh->GetNumberOfVertices());
@@ -228,14 +707,14 @@ void Canavar::Engine::RendererManager::Render(float ifps)
     // Line Strip
     {
         mShaderManager->Bind(ShaderType::LineStripShader);
-        mShaderManager->SetUniformValue("VP", mCamera->GetViewProjectionMatrix());
+        mShaderManager->SetUniformValue(mVPUniform, mCamera->GetViewProjectionMatrix());
         glBindVertexArray(mLineStripHandle.mVAO);
         glBindBuffer(GL_ARRAY_BUFFER, mLineStripHandle.mVBO);
 
         for (const auto& lineStrip : mLineStrips)
         {
             glBufferSubData(GL_ARRAY_BUFFER, 0, lineStrip->GetPoints().size() * sizeof(QVector3D), lineStrip->GetPoints().constData());
-            mShaderManager->SetUniformValue("color", lineStrip->GetColor());
+            mShaderManager->SetUniformValue(mColorUniform, lineStrip->GetColor());
             glDrawArrays(GL_LINE_STRIP, 0, lineStrip->GetPoints().size());
         }
 
@@ -259,8 +738,8 @@ void Canavar::Engine::RendererManager::Render(float ifps)
     {
         mFBOs[i % 2 == 0 ? FramebufferType::Pong : FramebufferType::Ping]->bind();
         mShaderManager->Bind(ShaderType::BlurShader);
-        mShaderManager->SetUniformValue("horizontal", i % 2 == 0);
-        mShaderManager->SetSampler("screenTexture", 0, mFBOs[i % 2 == 0 ? FramebufferType::Ping : FramebufferType::Pong]->texture());
+        mShaderManager->SetUniformValue(mHorizontalUniform, i % 2 == 0);
+        mShaderManager->SetSampler(mScreenTextureUniform, 0, mFBOs[i % 2 == 0 ? FramebufferType::Ping : FramebufferType::Pong]->texture());
         glBindVertexArray(mQuad.mVAO);
         glDrawArrays(GL_TRIANGLES, 0, 6);
         mShaderManager->Release();
@@ -274,44 +753,74 @@ void Canavar::Engine::RendererManager::Render(float ifps)
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     mShaderManager->Bind(ShaderType::PostProcessShader);
-    mShaderManager->SetSampler("sceneTexture", 0, mFBOs[FramebufferType::Temporary]->texture());
-    mShaderManager->SetSampler("bloomBlurTexture", 1, mFBOs[qMax(0, mBlurPass) % 2 == 0 ? FramebufferType::Ping : FramebufferType::Pong]->texture());
-    mShaderManager->SetUniformValue("exposure", mExposure);
-    mShaderManager->SetUniformValue("gamma", mGamma);
+    mShaderManager->SetSampler(mSceneTextureUniform, 0, mFBOs[FramebufferType::Temporary]->texture());
+    mShaderManager->SetSampler(mBloomBlurTextureUniform, 1, mFBOs[qMax(0, mBlurPass) % 2 == 0 ? FramebufferType::Ping : FramebufferType::Pong]->texture());
+    mShaderManager->SetUniformValue(mExposureUniform, mExposure);
+    mShaderManager->SetUniformValue(mGammaUniform, mGamma);
     glBindVertexArray(mQuad.mVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
     mShaderManager->Release();
+
+    if (mOcclusionCullingEnabled)
+        mOcclusionCulling.RenderDebug(mQuad.mVAO, mCamera->GetZNear(), mCamera->GetZFar());
 }
 
-void Canavar::Engine::RendererManager::SetCommonUniforms()
+void Canavar::Engine::RendererManager::UpdateFrameData()
 {
-    mShaderManager->SetUniformValue("cameraPos", mCamera->WorldPosition());
-    mShaderManager->SetUniformValue("VP", mCamera->GetViewProjectionMatrix());
+    static_assert(sizeof(FrameData) == 688, "FrameData must match the std140 layout in Common.glsl");
+
+    const auto VP = mCamera->GetViewProjectionMatrix();
+    const auto& cameraPos = mCamera->WorldPosition();
+    const auto sunDirection = -mSun->GetDirection().normalized();
+    const auto& sunColor = mSun->GetColor();
+    const auto& hazeColor = mHaze->GetColor();
 
-    mShaderManager->SetUniformValue("sun.direction", -mSun->GetDirection().normalized());
-    mShaderManager->SetUniformValue("sun.color", mSun->GetColor());
-    mShaderManager->SetUniformValue("sun.ambient", mSun->GetAmbient());
-    mShaderManager->SetUniformValue("sun.diffuse", mSun->GetDiffuse());
-    mShaderManager->SetUniformValue("sun.specular", mSun->GetSpecular());
+    memcpy(mFrameData.VP, VP.constData(), sizeof(mFrameData.VP));
 
-    mShaderManager->SetUniformValue("haze.enabled", mHaze->GetEnabled());
-    mShaderManager->SetUniformValue("haze.color", mHaze->GetColor());
-    mShaderManager->SetUniformValue("haze.density", mHaze->GetDensity());
-    mShaderManager->SetUniformValue("haze.gradient", mHaze->GetGradient());
+    for (int i = 0; i < 3; ++i)
+    {
+        mFrameData.cameraPos[i] = cameraPos[i];
+        mFrameData.sun.direction[i] = sunDirection[i];
+        mFrameData.haze.color[i] = hazeColor[i];
+    }
 
-    mShaderManager->SetUniformValue("numberOfPointLights", (int)mClosePointLights.size());
+    for (int i = 0; i < 4; ++i)
+        mFrameData.sun.color[i] = sunColor[i];
 
-    for (int i = 0; i < mClosePointLights.size(); i++)
+    mFrameData.sun.ambient = mSun->GetAmbient();
+    mFrameData.sun.diffuse = mSun->GetDiffuse();
+    mFrameData.sun.specular = mSun->GetSpecular();
+
+    mFrameData.haze.enabled = mHaze->GetEnabled();
+    mFrameData.haze.density = mHaze->GetDensity();
+    mFrameData.haze.gradient = mHaze->GetGradient();
+
+    mFrameData.numberOfPointLights = qMin((int)mClosePointLights.size(), 8);
+
+    for (int i = 0; i < mFrameData.numberOfPointLights; i++)
     {
-        mShaderManager->SetUniformValue("pointLights[" + QString::number(i) + "].color", mClosePointLights[i]->GetColor());
-        mShaderManager->SetUniformValue("pointLights[" + QString::number(i) + "].position", mClosePointLights[i]->WorldPosition());
-        mShaderManager->SetUniformValue("pointLights[" + QString::number(i) + "].ambient", mClosePointLights[i]->GetAmbient());
-        mShaderManager->SetUniformValue("pointLights[" + QString::number(i) + "].diffuse", mClosePointLights[i]->GetDiffuse());
-        mShaderManager->SetUniformValue("pointLights[" + QString::number(i) + "].specular", mClosePointLights[i]->GetSpecular());
-        mShaderManager->SetUniformValue("pointLights[" + QString::number(i) + "].constant", mClosePointLights[i]->GetConstant());
-        mShaderManager->SetUniformValue("pointLights[" + QString::number(i) + "].linear", mClosePointLights[i]->GetLinear());
-        mShaderManager->SetUniformValue("pointLights[" + QString::number(i) + "].quadratic", mClosePointLights[i]->GetQuadratic());
+        const auto& light = mClosePointLights[i];
+        const auto& color = light->GetColor();
+        const auto& position = light->WorldPosition();
+        auto& data = mFrameData.pointLights[i];
+
+        for (int j = 0; j < 4; ++j)
+            data.color[j] = color[j];
+
+        for (int j = 0; j < 3; ++j)
+            data.position[j] = position[j];
+
+        data.ambient = light->GetAmbient();
+        data.diffuse = light->GetDiffuse();
+        data.specular = light->GetSpecular();
+        data.constant = light->GetConstant();
+        data.linear = light->GetLinear();
+        data.quadratic = light->GetQuadratic();
     }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, mFrameDataBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &mFrameData);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
 void Canavar::Engine::RendererManager::DeleteFramebuffers()
@@ -320,7 +829,10 @@ void Canavar::Engine::RendererManager::DeleteFramebuffers()
 
     for (auto type : keys)
         if (mFBOs[type])
+        {
+            mTracker->Free(GPUMemoryTracker::Resource::Framebuffer, mFBOs[type]->handle());
             delete mFBOs[type];
+        }
 }
 
 void Canavar::Engine::RendererManager::CreateFramebuffers(int width, int height)
@@ -339,6 +851,12 @@ void Canavar::Engine::RendererManager::CreateFramebuffers(int width, int height)
             glDrawBuffers(2, mColorAttachments);
             mFBOs[FramebufferType::Default]->release();
         }
+
+        mTracker->Allocate(GPUMemoryTracker::Resource::Framebuffer,
+                           mFBOs[type]->handle(),
+                           GPUMemoryTracker::Category::RenderTarget,
+                           FRAMEBUFFER_OWNERS[int(type)],
+                           GPUMemoryTracker::CalculateFramebufferSize(mFBOs[type]));
     }
 }
 
@@ -357,6 +875,17 @@ void Canavar::Engine::RendererManager::OnLineStripDestroyed(QObject* lineStrip)
     mLineStrips.removeAll(static_cast<LineStrip*>(lineStrip));
 }
 
+void Canavar::Engine::RendererManager::OnInstancedModelDestroyed(QObject* model)
+{
+    const auto range = mSlotsByModel.take(static_cast<Model*>(model));
+    mFreeSlots.insert(range.second, range.first);
+}
+
+void Canavar::Engine::RendererManager::OnModelDataEvicted(ModelData* data)
+{
+    mImpostorRenderer.Release(data);
+}
+
 void Canavar::Engine::RendererManager::AddSelectableNode(Node* node, QVector4D color)
 {
     if (node && node->GetSelectable())
@@ -424,4 +953,44 @@ Canavar::Engine::SelectedMeshParameters& Canavar::Engine::RendererManager::GetSe
 const QMap<Canavar::Engine::Model*, Canavar::Engine::SelectedMeshParameters>& Canavar::Engine::RendererManager::GetSelectedMeshes() const
 {
     return mSelectedMeshes;
+}
+
+const Canavar::Engine::Frustum& Canavar::Engine::RendererManager::GetFrustum() const
+{
+    return mFrustum;
+}
+
+const QList<Canavar::Engine::Model*>& Canavar::Engine::RendererManager::GetVisibleModels() const
+{
+    return mVisibleModels;
+}
+
+Canavar::Engine::RenderQueue& Canavar::Engine::RendererManager::GetRenderQueue()
+{
+    return mRenderQueue;
+}
+
+Canavar::Engine::GPUCulling& Canavar::Engine::RendererManager::GetGPUCulling()
+{
+    return mGPUCulling;
+}
+
+Canavar::Engine::OcclusionCulling& Canavar::Engine::RendererManager::GetOcclusionCulling()
+{
+    return mOcclusionCulling;
+}
+
+Canavar::Engine::ImpostorRenderer& Canavar::Engine::RendererManager::GetImpostorRenderer()
+{
+    return mImpostorRenderer;
+}
+
+const QVector<int>& Canavar::Engine::RendererManager::GetNumberOfModelsPerLod() const
+{
+    return mNumberOfModelsPerLod;
+}
+
+bool Canavar::Engine::RendererManager::IsGPUCullingActive() const
+{
+    return mGPUCullingEnabled && mFrustumCullingEnabled && mIndirectDrawingEnabled && mRenderQueue.IsIndirectDrawingSupported();
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "CameraManager.h"
 #include "Config.h"
+#include "GPUMemoryTracker.h"
 #include "Mesh.h"
 #include "Model.h"
 #include "NodeManager.h"
@@ -25,8 +26,14 @@ bool Canavar::Engine::SelectableNodeRenderer::Init()
     mCameraManager = CameraManager::Instance();
     mRendererManager = RendererManager::Instance();
 
+    mMVPUniform = mShaderManager->GetUniformHandle("MVP");
+    mScaleUniform = mShaderManager->GetUniformHandle("scale");
+    mNodeIDUniform = mShaderManager->GetUniformHandle("nodeID");
+    mMeshIDUniform = mShaderManager->GetUniformHandle("meshID");
+    mFillVertexInfoUniform = mShaderManager->GetUniformHandle("fillVertexInfo");
+
     initializeOpenGLFunctions();
-    mNodeInfoFBO.Init();
+    mNodeInfoFBO.Init("Pass: Node Info");
     mNodeInfoFBO.Create(mWidth, mHeight);
 
     glGenVertexArrays(1, &mCube.mVAO);
@@ -34,6 +41,7 @@ bool Canavar::Engine::SelectableNodeRenderer::Init()
     glGenBuffers(1, &mCube.mVBO);
     glBindBuffer(GL_ARRAY_BUFFER, mCube.mVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(Canavar::Engine::CUBE), CUBE, GL_STATIC_DRAW);
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Buffer, mCube.mVBO, GPUMemoryTracker::Category::VertexBuffer, "Pass: Node Info", sizeof(Canavar::Engine::CUBE));
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
@@ -102,42 +110,50 @@ void Canavar::Engine::SelectableNodeRenderer::Render(float)
 
         const auto& VP = mCameraManager->GetActiveCamera()->GetViewProjectionMatrix();
 
-        for (const auto& node : mNodeManager->GetNodes())
+        // Models, already culled by RendererManager
+        for (const auto& model : mRendererManager->GetVisibleModels())
         {
-            if (!node->GetVisible() || !node->GetSelectable())
+            if (!model->GetSelectable())
                 continue;
 
-            if (auto model = dynamic_cast<Model*>(node))
-            {
-                model->Render(RenderMode::NodeInfo);
-
-                const auto& params = mRendererManager->GetSelectedMeshParameters(model);
-
-                if (params.mRenderVertices)
-                {
-                    mShaderManager->Bind(ShaderType::VertexInfoShader);
-                    mShaderManager->SetUniformValue("MVP", VP * model->WorldTransformation() * model->GetMeshTransformation(params.mMesh->GetName()));
-                    mShaderManager->SetUniformValue("scale", params.mScale);
-                    mShaderManager->SetUniformValue("nodeID", node->GetID());
-                    mShaderManager->SetUniformValue("meshID", params.mMesh->GetID());
-                    mShaderManager->SetUniformValue("fillVertexInfo", true);
-                    params.mMesh->GetVerticesVAO()->bind();
-                    glDrawArraysInstanced(GL_TRIANGLES, 0, 36, params.mMesh->GetNumberOfVertices());
-                    params.mMesh->GetVerticesVAO()->release();
-                }
-            }
-            else
+            model->Render(RenderMode::NodeInfo);
+
+            const auto& params = mRendererManager->GetSelectedMeshParameters(model);
+
+            if (params.mRenderVertices)
             {
-                mShaderManager->Bind(ShaderType::NodeInfoShader);
-                mShaderManager->SetUniformValue("MVP", VP * node->WorldTransformation() * node->GetAABB().GetTransformation());
-                mShaderManager->SetUniformValue("nodeID", node->GetID());
-                mShaderManager->SetUniformValue("meshID", 0);
-                mShaderManager->SetUniformValue("fillVertexInfo", false);
-                glBindVertexArray(mCube.mVAO);
-                glDrawArrays(GL_TRIANGLES, 0, 36);
-                mShaderManager->Release();
+                mShaderManager->Bind(ShaderType::VertexInfoShader);
+                mShaderManager->SetUniformValue(mMVPUniform, VP * model->GetMeshWorldTransformation(params.mMesh));
+                mShaderManager->SetUniformValue(mScaleUniform, params.mScale);
+                mShaderManager->SetUniformValue(mNodeIDUniform, model->GetID());
+                mShaderManager->SetUniformValue(mMeshIDUniform, params.mMesh->GetID());
+                mShaderManager->SetUniformValue(mFillVertexInfoUniform, true);
+                params.mMesh->GetVerticesVAO()->bind();
+                glDrawArraysInstanced(GL_TRIANGLES, 0, 36, params.mMesh->GetNumberOfVertices());
+                params.mMesh->GetVerticesVAO()->release();
             }
         }
+
+        // Other nodes are picked by their AABB
+        const auto& nodes = mRendererManager->GetFrustumCullingEnabled() ? mNodeManager->QueryFrustum(mRendererManager->GetFrustum()) : mNodeManager->GetNodes();
+
+        for (const auto& node : nodes)
+        {
+            if (node->GetType() == Node::NodeType::Model)
+                continue;
+
+            if (!node->GetVisible() || !node->GetSelectable())
+                continue;
+
+            mShaderManager->Bind(ShaderType::NodeInfoShader);
+            mShaderManager->SetUniformValue(mMVPUniform, VP * node->WorldTransformation() * node->GetAABB().GetTransformation());
+            mShaderManager->SetUniformValue(mNodeIDUniform, node->GetID());
+            mShaderManager->SetUniformValue(mMeshIDUniform, 0);
+            mShaderManager->SetUniformValue(mFillVertexInfoUniform, false);
+            glBindVertexArray(mCube.mVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+            mShaderManager->Release();
+        }
     }
 }
 
@@ -2,6 +2,7 @@
 #include "Helper.h"
 
 #include <QDebug>
+#include <QRegularExpression>
 
 Canavar::Engine::Shader::Shader(ShaderType type)
     : QObject()
@@ -12,7 +13,9 @@ bool Canavar::Engine::Shader::Init()
 {
     initializeOpenGLFunctions();
 
-    mShaderName = mPaths.value(QOpenGLShader::Vertex).sliced(mPaths.value(QOpenGLShader::Vertex).lastIndexOf("/") + 1);
+    // Compute programs have no vertex stage
+    const QString path = mPaths.value(QOpenGLShader::Vertex, mPaths.first());
+    mShaderName = path.sliced(path.lastIndexOf("/") + 1);
 
     qInfo() << mShaderName << "is initializing... ";
 
@@ -22,7 +25,7 @@ bool Canavar::Engine::Shader::Init()
 
     for (auto type : qAsConst(types))
     {
-        if (!mProgram->addShaderFromSourceCode(type, Helper::GetBytes(mPaths[type])))
+        if (!mProgram->addShaderFromSourceCode(type, GetSource(mPaths[type])))
         {
             qWarning() << Q_FUNC_INFO << "Could not load" << GetShaderTypeString(type);
             mProgram->deleteLater();
@@ -37,6 +40,14 @@ bool Canavar::Engine::Shader::Init()
         return false;
     }
 
+    ReflectUniforms();
+
+    // Shaders including Common.glsl read per-frame data from this block
+    GLuint frameDataIndex = glGetUniformBlockIndex(mProgram->programId(), "FrameData");
+
+    if (frameDataIndex != GL_INVALID_INDEX)
+        glUniformBlockBinding(mProgram->programId(), frameDataIndex, FRAME_DATA_BINDING_POINT);
+
     if (!mProgram->bind())
     {
         qWarning() << Q_FUNC_INFO << "Could not bind shader program.";
@@ -68,42 +79,42 @@ void Canavar::Engine::Shader::AddPath(QOpenGLShader::ShaderTypeBit type, const Q
 
 void Canavar::Engine::Shader::SetUniformValue(const QString& name, int value)
 {
-    mProgram->setUniformValue(mProgram->uniformLocation(name), value);
+    mProgram->setUniformValue(GetUniformLocation(name), value);
 }
 
 void Canavar::Engine::Shader::SetUniformValue(const QString& name, unsigned int value)
 {
-    mProgram->setUniformValue(mProgram->uniformLocation(name), value);
+    mProgram->setUniformValue(GetUniformLocation(name), value);
 }
 
 void Canavar::Engine::Shader::SetUniformValue(const QString& name, float value)
 {
-    mProgram->setUniformValue(mProgram->uniformLocation(name), value);
+    mProgram->setUniformValue(GetUniformLocation(name), value);
 }
 
 void Canavar::Engine::Shader::SetUniformValue(const QString& name, const QVector3D& value)
 {
-    mProgram->setUniformValue(mProgram->uniformLocation(name), value);
+    mProgram->setUniformValue(GetUniformLocation(name), value);
 }
 
 void Canavar::Engine::Shader::SetUniformValue(const QString& name, const QVector4D& value)
 {
-    mProgram->setUniformValue(mProgram->uniformLocation(name), value);
+    mProgram->setUniformValue(GetUniformLocation(name), value);
 }
 
 void Canavar::Engine::Shader::SetUniformValue(const QString& name, const QMatrix4x4& value)
 {
-    mProgram->setUniformValue(mProgram->uniformLocation(name), value);
+    mProgram->setUniformValue(GetUniformLocation(name), value);
 }
 
 void Canavar::Engine::Shader::SetUniformValue(const QString& name, const QMatrix3x3& value)
 {
-    mProgram->setUniformValue(mProgram->uniformLocation(name), value);
+    mProgram->setUniformValue(GetUniformLocation(name), value);
 }
 
 void Canavar::Engine::Shader::SetUniformValueArray(const QString& name, const QVector<QVector3D>& values)
 {
-    mProgram->setUniformValueArray(mProgram->uniformLocation(name), values.constData(), values.size());
+    mProgram->setUniformValueArray(GetUniformLocation(name), values.constData(), values.size());
 }
 
 void Canavar::Engine::Shader::SetSampler(const QString& name, unsigned int unit, unsigned int id, GLenum target)
@@ -113,11 +124,149 @@ void Canavar::Engine::Shader::SetSampler(const QString& name, unsigned int unit,
     SetUniformValue(name, unit);
 }
 
+void Canavar::Engine::Shader::SetUniformValue(UniformHandle handle, int value)
+{
+    mProgram->setUniformValue(GetUniformLocation(handle), value);
+}
+
+void Canavar::Engine::Shader::SetUniformValue(UniformHandle handle, unsigned int value)
+{
+    mProgram->setUniformValue(GetUniformLocation(handle), value);
+}
+
+void Canavar::Engine::Shader::SetUniformValue(UniformHandle handle, float value)
+{
+    mProgram->setUniformValue(GetUniformLocation(handle), value);
+}
+
+void Canavar::Engine::Shader::SetUniformValue(UniformHandle handle, const QVector3D& value)
+{
+    mProgram->setUniformValue(GetUniformLocation(handle), value);
+}
+
+void Canavar::Engine::Shader::SetUniformValue(UniformHandle handle, const QVector4D& value)
+{
+    mProgram->setUniformValue(GetUniformLocation(handle), value);
+}
+
+void Canavar::Engine::Shader::SetUniformValue(UniformHandle handle, const QMatrix4x4& value)
+{
+    mProgram->setUniformValue(GetUniformLocation(handle), value);
+}
+
+void Canavar::Engine::Shader::SetUniformValue(UniformHandle handle, const QMatrix3x3& value)
+{
+    mProgram->setUniformValue(GetUniformLocation(handle), value);
+}
+
+void Canavar::Engine::Shader::SetSampler(UniformHandle handle, unsigned int unit, unsigned int id, GLenum target)
+{
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(target, id);
+    SetUniformValue(handle, unit);
+}
+
+void Canavar::Engine::Shader::ResolveHandle(int id, const QString& name)
+{
+    if (mHandleLocations.size() <= id)
+        mHandleLocations.resize(id + 1, -1);
+
+    mHandleLocations[id] = GetUniformLocation(name);
+}
+
+int Canavar::Engine::Shader::GetUniformLocation(const QString& name) const
+{
+    return mUniformLocations.value(name, -1);
+}
+
+int Canavar::Engine::Shader::GetUniformLocation(UniformHandle handle) const
+{
+    if (0 <= handle.id && handle.id < mHandleLocations.size())
+        return mHandleLocations[handle.id];
+
+    return -1;
+}
+
 Canavar::Engine::ShaderType Canavar::Engine::Shader::GetType() const
 {
     return mType;
 }
 
+QByteArray Canavar::Engine::Shader::GetSource(const QString& path, int depth)
+{
+    // Resolves #include "File" directives relative to the including file
+    static const QRegularExpression includeRegex("^\\s*#include\\s+\"([^\"]+)\"\\s*$");
+
+    if (depth > 8)
+    {
+        qWarning() << Q_FUNC_INFO << "Include depth exceeded while loading" << path;
+        return QByteArray();
+    }
+
+    const QString directory = path.left(path.lastIndexOf("/") + 1);
+    const QList<QByteArray> lines = Helper::GetBytes(path).split('\n');
+
+    QByteArray source;
+
+    for (const auto& line : lines)
+    {
+        const auto match = includeRegex.match(QString::fromUtf8(line));
+
+        if (match.hasMatch())
+            source += GetSource(directory + match.captured(1), depth + 1);
+        else
+            source += line;
+
+        source += '\n';
+    }
+
+    return source;
+}
+
+void Canavar::Engine::Shader::ReflectUniforms()
+{
+    mUniformLocations.clear();
+
+    const GLuint programId = mProgram->programId();
+
+    GLint numberOfUniforms = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(programId, GL_ACTIVE_UNIFORMS, &numberOfUniforms);
+    glGetProgramiv(programId, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    QByteArray buffer(qMax(maxNameLength, 1), '\0');
+
+    for (GLint i = 0; i < numberOfUniforms; ++i)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(programId, i, buffer.size(), &length, &size, &type, buffer.data());
+
+        const QString name = QString::fromLatin1(buffer.constData(), length);
+        const GLint location = glGetUniformLocation(programId, buffer.constData());
+
+        // Members of uniform blocks have no location
+        if (location < 0)
+            continue;
+
+        mUniformLocations.insert(name, location);
+
+        // Arrays are reported once as "name[0]"
+        if (name.endsWith("[0]"))
+        {
+            const QString base = name.chopped(3);
+            mUniformLocations.insert(base, location);
+
+            for (int j = 1; j < size; ++j)
+            {
+                const QString element = base + "[" + QString::number(j) + "]";
+                mUniformLocations.insert(element, glGetUniformLocation(programId, element.toLatin1().constData()));
+            }
+        }
+    }
+}
+
 QString Canavar::Engine::Shader::GetShaderTypeString(QOpenGLShader::ShaderTypeBit type)
 {
     switch (type)
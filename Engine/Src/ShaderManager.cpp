@@ -3,7 +3,9 @@
 
 Canavar::Engine::ShaderManager::ShaderManager()
     : Manager()
-    , mActiveShader(ShaderType::None)
+    , mActiveShader(nullptr)
+    , mUniformLookups(0)
+    , mNumberOfUniformLookups(0)
 {}
 
 Canavar::Engine::Shader* Canavar::Engine::ShaderManager::GetShader(ShaderType shader)
@@ -37,6 +39,30 @@ bool Canavar::Engine::ShaderManager::Init()
             return false;
     }
 
+    // Model Colored Instanced Shader
+    {
+        Shader* shader = new Shader(ShaderType::ModelColoredInstancedShader);
+        mShaders.insert(shader->GetType(), shader);
+
+        shader->AddPath(QOpenGLShader::Vertex, ":/Resources/Shaders/ModelColoredInstanced.vert");
+        shader->AddPath(QOpenGLShader::Fragment, ":/Resources/Shaders/ModelColoredInstanced.frag");
+
+        if (!shader->Init())
+            return false;
+    }
+
+    // Model Textured Instanced Shader
+    {
+        Shader* shader = new Shader(ShaderType::ModelTexturedInstancedShader);
+        mShaders.insert(shader->GetType(), shader);
+
+        shader->AddPath(QOpenGLShader::Vertex, ":/Resources/Shaders/ModelTexturedInstanced.vert");
+        shader->AddPath(QOpenGLShader::Fragment, ":/Resources/Shaders/ModelTexturedInstanced.frag");
+
+        if (!shader->Init())
+            return false;
+    }
+
     // Sky Shader
     {
         Shader* shader = new Shader(ShaderType::SkyShader);
@@ -195,63 +221,199 @@ bool Canavar::Engine::ShaderManager::Init()
             return false;
     }
 
+    // GPU Culling Shader
+    {
+        Shader* shader = new Shader(ShaderType::GPUCullingShader);
+        mShaders.insert(shader->GetType(), shader);
+
+        shader->AddPath(QOpenGLShader::Compute, ":/Resources/Shaders/GPUCulling.comp");
+
+        if (!shader->Init())
+            return false;
+    }
+
+    // Hi-Z Shader
+    {
+        Shader* shader = new Shader(ShaderType::HiZShader);
+        mShaders.insert(shader->GetType(), shader);
+
+        shader->AddPath(QOpenGLShader::Compute, ":/Resources/Shaders/HiZ.comp");
+
+        if (!shader->Init())
+            return false;
+    }
+
+    // Hi-Z Debug Shader
+    {
+        Shader* shader = new Shader(ShaderType::HiZDebugShader);
+        mShaders.insert(shader->GetType(), shader);
+
+        shader->AddPath(QOpenGLShader::Vertex, ":/Resources/Shaders/Screen.vert");
+        shader->AddPath(QOpenGLShader::Fragment, ":/Resources/Shaders/HiZDebug.frag");
+
+        if (!shader->Init())
+            return false;
+    }
+
+    // Impostor Bake Shader
+    {
+        Shader* shader = new Shader(ShaderType::ImpostorBakeShader);
+        mShaders.insert(shader->GetType(), shader);
+
+        shader->AddPath(QOpenGLShader::Vertex, ":/Resources/Shaders/ImpostorBake.vert");
+        shader->AddPath(QOpenGLShader::Fragment, ":/Resources/Shaders/ImpostorBake.frag");
+
+        if (!shader->Init())
+            return false;
+    }
+
+    // Impostor Shader
+    {
+        Shader* shader = new Shader(ShaderType::ImpostorShader);
+        mShaders.insert(shader->GetType(), shader);
+
+        shader->AddPath(QOpenGLShader::Vertex, ":/Resources/Shaders/Impostor.vert");
+        shader->AddPath(QOpenGLShader::Fragment, ":/Resources/Shaders/Impostor.frag");
+
+        if (!shader->Init())
+            return false;
+    }
+
+    // Resolve handles requested before the shaders were linked
+    for (const auto& shader : qAsConst(mShaders))
+        for (int i = 0; i < mUniformNames.size(); ++i)
+            shader->ResolveHandle(i, mUniformNames[i]);
+
     return true;
 }
 
+void Canavar::Engine::ShaderManager::Update(float)
+{
+    mNumberOfUniformLookups = mUniformLookups;
+    mUniformLookups = 0;
+}
+
 bool Canavar::Engine::ShaderManager::Bind(ShaderType shader)
 {
-    mActiveShader = shader;
-    return mShaders.value(mActiveShader)->Bind();
+    mActiveShader = mShaders.value(shader);
+    return mActiveShader->Bind();
 }
 
 void Canavar::Engine::ShaderManager::Release()
 {
-    mShaders.value(mActiveShader)->Release();
+    mActiveShader->Release();
 }
 
 void Canavar::Engine::ShaderManager::SetUniformValue(const QString& name, int value)
 {
-    mShaders.value(mActiveShader)->SetUniformValue(name, value);
+    mUniformLookups++;
+    mActiveShader->SetUniformValue(name, value);
 }
 
 void Canavar::Engine::ShaderManager::SetUniformValue(const QString& name, unsigned int value)
 {
-    mShaders.value(mActiveShader)->SetUniformValue(name, value);
+    mUniformLookups++;
+    mActiveShader->SetUniformValue(name, value);
 }
 
 void Canavar::Engine::ShaderManager::SetUniformValue(const QString& name, float value)
 {
-    mShaders.value(mActiveShader)->SetUniformValue(name, value);
+    mUniformLookups++;
+    mActiveShader->SetUniformValue(name, value);
 }
 
 void Canavar::Engine::ShaderManager::SetUniformValue(const QString& name, const QVector3D& value)
 {
-    mShaders.value(mActiveShader)->SetUniformValue(name, value);
+    mUniformLookups++;
+    mActiveShader->SetUniformValue(name, value);
 }
 
 void Canavar::Engine::ShaderManager::SetUniformValue(const QString& name, const QVector4D& value)
 {
-    mShaders.value(mActiveShader)->SetUniformValue(name, value);
+    mUniformLookups++;
+    mActiveShader->SetUniformValue(name, value);
 }
 
 void Canavar::Engine::ShaderManager::SetUniformValue(const QString& name, const QMatrix4x4& value)
 {
-    mShaders.value(mActiveShader)->SetUniformValue(name, value);
+    mUniformLookups++;
+    mActiveShader->SetUniformValue(name, value);
 }
 
 void Canavar::Engine::ShaderManager::SetUniformValue(const QString& name, const QMatrix3x3& value)
 {
-    mShaders.value(mActiveShader)->SetUniformValue(name, value);
+    mUniformLookups++;
+    mActiveShader->SetUniformValue(name, value);
 }
 
 void Canavar::Engine::ShaderManager::SetUniformValueArray(const QString& name, const QVector<QVector3D>& values)
 {
-    mShaders.value(mActiveShader)->SetUniformValueArray(name, values);
+    mUniformLookups++;
+    mActiveShader->SetUniformValueArray(name, values);
 }
 
 void Canavar::Engine::ShaderManager::SetSampler(const QString& name, unsigned int unit, unsigned int id, GLenum target)
 {
-    mShaders.value(mActiveShader)->SetSampler(name, unit, id, target);
+    mUniformLookups++;
+    mActiveShader->SetSampler(name, unit, id, target);
+}
+
+Canavar::Engine::UniformHandle Canavar::Engine::ShaderManager::GetUniformHandle(const QString& name)
+{
+    UniformHandle handle;
+    handle.id = mUniformHandles.value(name, -1);
+
+    if (handle.id == -1)
+    {
+        handle.id = mUniformNames.size();
+        mUniformNames << name;
+        mUniformHandles.insert(name, handle.id);
+
+        for (const auto& shader : qAsConst(mShaders))
+            shader->ResolveHandle(handle.id, name);
+    }
+
+    return handle;
+}
+
+void Canavar::Engine::ShaderManager::SetUniformValue(UniformHandle handle, int value)
+{
+    mActiveShader->SetUniformValue(handle, value);
+}
+
+void Canavar::Engine::ShaderManager::SetUniformValue(UniformHandle handle, unsigned int value)
+{
+    mActiveShader->SetUniformValue(handle, value);
+}
+
+void Canavar::Engine::ShaderManager::SetUniformValue(UniformHandle handle, float value)
+{
+    mActiveShader->SetUniformValue(handle, value);
+}
+
+void Canavar::Engine::ShaderManager::SetUniformValue(UniformHandle handle, const QVector3D& value)
+{
+    mActiveShader->SetUniformValue(handle, value);
+}
+
+void Canavar::Engine::ShaderManager::SetUniformValue(UniformHandle handle, const QVector4D& value)
+{
+    mActiveShader->SetUniformValue(handle, value);
+}
+
+void Canavar::Engine::ShaderManager::SetUniformValue(UniformHandle handle, const QMatrix4x4& value)
+{
+    mActiveShader->SetUniformValue(handle, value);
+}
+
+void Canavar::Engine::ShaderManager::SetUniformValue(UniformHandle handle, const QMatrix3x3& value)
+{
+    mActiveShader->SetUniformValue(handle, value);
+}
+
+void Canavar::Engine::ShaderManager::SetSampler(UniformHandle handle, unsigned int unit, unsigned int id, GLenum target)
+{
+    mActiveShader->SetSampler(handle, unit, id, target);
 }
 
 Canavar::Engine::ShaderManager* Canavar::Engine::ShaderManager::Instance()
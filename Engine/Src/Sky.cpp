@@ -1,4 +1,5 @@
 #include "Sky.h"
+#include "GPUMemoryTracker.h"
 #include "Sun.h"
 
 #include <QFile>
@@ -20,6 +21,20 @@ Canavar::Engine::Sky::Sky()
     mCameraManager = Canavar::Engine::CameraManager::Instance();
     mLightManager = Canavar::Engine::LightManager::Instance();
 
+    mIVPUniform = mShaderManager->GetUniformHandle("IVP");
+    mSkyYOffsetUniform = mShaderManager->GetUniformHandle("skyYOffset");
+    mSunDirUniform = mShaderManager->GetUniformHandle("sunDir");
+    mAUniform = mShaderManager->GetUniformHandle("A");
+    mBUniform = mShaderManager->GetUniformHandle("B");
+    mCUniform = mShaderManager->GetUniformHandle("C");
+    mDUniform = mShaderManager->GetUniformHandle("D");
+    mEUniform = mShaderManager->GetUniformHandle("E");
+    mFUniform = mShaderManager->GetUniformHandle("F");
+    mGUniform = mShaderManager->GetUniformHandle("G");
+    mHUniform = mShaderManager->GetUniformHandle("H");
+    mIUniform = mShaderManager->GetUniformHandle("I");
+    mZUniform = mShaderManager->GetUniformHandle("Z");
+
     initializeOpenGLFunctions();
 
     glGenVertexArrays(1, &mVAO);
@@ -27,6 +42,7 @@ Canavar::Engine::Sky::Sky()
     glGenBuffers(1, &mVBO);
     glBindBuffer(GL_ARRAY_BUFFER, mVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(Canavar::Engine::QUAD), Canavar::Engine::QUAD, GL_STATIC_DRAW);
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Buffer, mVBO, GPUMemoryTracker::Category::VertexBuffer, "Sky", sizeof(Canavar::Engine::QUAD));
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(QVector2D), (void*)0);
 
@@ -135,19 +151,19 @@ void Canavar::Engine::Sky::Render()
     glDisable(GL_DEPTH_TEST);
 
     mShaderManager->Bind(ShaderType::SkyShader);
-    mShaderManager->SetUniformValue("IVP", mCameraManager->GetActiveCamera()->GetRotationMatrix().inverted() * mCameraManager->GetActiveCamera()->GetProjectionMatrix().inverted());
-    mShaderManager->SetUniformValue("skyYOffset", mCameraManager->GetActiveCamera()->CalculateSkyYOffset(30000.0f));
-    mShaderManager->SetUniformValue("sunDir", sunDir);
-    mShaderManager->SetUniformValue("A", A);
-    mShaderManager->SetUniformValue("B", B);
-    mShaderManager->SetUniformValue("C", C);
-    mShaderManager->SetUniformValue("D", D);
-    mShaderManager->SetUniformValue("E", E);
-    mShaderManager->SetUniformValue("F", F);
-    mShaderManager->SetUniformValue("G", G);
-    mShaderManager->SetUniformValue("H", H);
-    mShaderManager->SetUniformValue("I", I);
-    mShaderManager->SetUniformValue("Z", Z);
+    mShaderManager->SetUniformValue(mIVPUniform, mCameraManager->GetActiveCamera()->GetRotationMatrix().inverted() * mCameraManager->GetActiveCamera()->GetProjectionMatrix().inverted());
+    mShaderManager->SetUniformValue(mSkyYOffsetUniform, mCameraManager->GetActiveCamera()->CalculateSkyYOffset(30000.0f));
+    mShaderManager->SetUniformValue(mSunDirUniform, sunDir);
+    mShaderManager->SetUniformValue(mAUniform, A);
+    mShaderManager->SetUniformValue(mBUniform, B);
+    mShaderManager->SetUniformValue(mCUniform, C);
+    mShaderManager->SetUniformValue(mDUniform, D);
+    mShaderManager->SetUniformValue(mEUniform, E);
+    mShaderManager->SetUniformValue(mFUniform, F);
+    mShaderManager->SetUniformValue(mGUniform, G);
+    mShaderManager->SetUniformValue(mHUniform, H);
+    mShaderManager->SetUniformValue(mIUniform, I);
+    mShaderManager->SetUniformValue(mZUniform, Z);
 
     glBindVertexArray(mVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -19,16 +19,36 @@ Canavar::Engine::Terrain::Terrain()
     mShaderManager = ShaderManager::Instance();
     mCameraManager = CameraManager::Instance();
 
+    mMUniform = mShaderManager->GetUniformHandle("M");
+    mAmplitudeUniform = mShaderManager->GetUniformHandle("terrain.amplitude");
+    mSeedUniform = mShaderManager->GetUniformHandle("terrain.seed");
+    mOctavesUniform = mShaderManager->GetUniformHandle("terrain.octaves");
+    mFrequencyUniform = mShaderManager->GetUniformHandle("terrain.frequency");
+    mTessellationMultiplierUniform = mShaderManager->GetUniformHandle("terrain.tessellationMultiplier");
+    mPowerUniform = mShaderManager->GetUniformHandle("terrain.power");
+    mGrassCoverageUniform = mShaderManager->GetUniformHandle("terrain.grassCoverage");
+    mAmbientUniform = mShaderManager->GetUniformHandle("terrain.ambient");
+    mDiffuseUniform = mShaderManager->GetUniformHandle("terrain.diffuse");
+    mShininessUniform = mShaderManager->GetUniformHandle("terrain.shininess");
+    mSpecularUniform = mShaderManager->GetUniformHandle("terrain.specular");
+    mWaterHeightUniform = mShaderManager->GetUniformHandle("waterHeight");
+    mSandUniform = mShaderManager->GetUniformHandle("sand");
+    mGrassUniform = mShaderManager->GetUniformHandle("grass");
+    mTerrainTextureUniform = mShaderManager->GetUniformHandle("terrainTexture");
+    mSnowUniform = mShaderManager->GetUniformHandle("snow");
+    mRockUniform = mShaderManager->GetUniformHandle("rock");
+    mRockNormalUniform = mShaderManager->GetUniformHandle("rockNormal");
+
     Reset();
 
     mTileGenerator = new TileGenerator(3, 128, 1024.0f);
 
-    mTextures.insert("Sand", Helper::CreateTexture("Resources/Terrain/sand.jpg"));
-    mTextures.insert("Grass", Helper::CreateTexture("Resources/Terrain/grass0.jpg"));
-    mTextures.insert("Snow", Helper::CreateTexture("Resources/Terrain/snow0.jpg"));
-    mTextures.insert("RockDiffuse", Helper::CreateTexture("Resources/Terrain/rock0.jpg"));
-    mTextures.insert("RockNormal", Helper::CreateTexture("Resources/Terrain/rnormal.jpg"));
-    mTextures.insert("Terrain", Helper::CreateTexture("Resources/Terrain/terrain.jpg"));
+    mTextures[Sand] = Helper::CreateTexture("Resources/Terrain/sand.jpg", "Terrain");
+    mTextures[Grass] = Helper::CreateTexture("Resources/Terrain/grass0.jpg", "Terrain");
+    mTextures[Snow] = Helper::CreateTexture("Resources/Terrain/snow0.jpg", "Terrain");
+    mTextures[RockDiffuse] = Helper::CreateTexture("Resources/Terrain/rock0.jpg", "Terrain");
+    mTextures[RockNormal] = Helper::CreateTexture("Resources/Terrain/rnormal.jpg", "Terrain");
+    mTextures[TerrainTexture] = Helper::CreateTexture("Resources/Terrain/terrain.jpg", "Terrain");
 
     SetScale(QVector3D(1, 0, 1));
 }
@@ -47,25 +67,25 @@ void Canavar::Engine::Terrain::Render()
     }
 
     mShaderManager->Bind(ShaderType::TerrainShader);
-    mShaderManager->SetUniformValue("M", WorldTransformation());
-    mShaderManager->SetUniformValue("terrain.amplitude", mAmplitude);
-    mShaderManager->SetUniformValue("terrain.seed", mSeed);
-    mShaderManager->SetUniformValue("terrain.octaves", mOctaves);
-    mShaderManager->SetUniformValue("terrain.frequency", mFrequency);
-    mShaderManager->SetUniformValue("terrain.tessellationMultiplier", mTessellationMultiplier);
-    mShaderManager->SetUniformValue("terrain.power", mPower);
-    mShaderManager->SetUniformValue("terrain.grassCoverage", mGrassCoverage);
-    mShaderManager->SetUniformValue("terrain.ambient", mAmbient);
-    mShaderManager->SetUniformValue("terrain.diffuse", mDiffuse);
-    mShaderManager->SetUniformValue("terrain.shininess", mShininess);
-    mShaderManager->SetUniformValue("terrain.specular", mSpecular);
-    mShaderManager->SetUniformValue("waterHeight", -1000.0f);
-    mShaderManager->SetSampler("sand", 1, mTextures.value("Sand")->textureId());
-    mShaderManager->SetSampler("grass", 2, mTextures.value("Grass")->textureId());
-    mShaderManager->SetSampler("terrainTexture", 3, mTextures.value("Terrain")->textureId());
-    mShaderManager->SetSampler("snow", 4, mTextures.value("Snow")->textureId());
-    mShaderManager->SetSampler("rock", 5, mTextures.value("RockDiffuse")->textureId());
-    mShaderManager->SetSampler("rockNormal", 6, mTextures.value("RockNormal")->textureId());
+    mShaderManager->SetUniformValue(mMUniform, WorldTransformation());
+    mShaderManager->SetUniformValue(mAmplitudeUniform, mAmplitude);
+    mShaderManager->SetUniformValue(mSeedUniform, mSeed);
+    mShaderManager->SetUniformValue(mOctavesUniform, mOctaves);
+    mShaderManager->SetUniformValue(mFrequencyUniform, mFrequency);
+    mShaderManager->SetUniformValue(mTessellationMultiplierUniform, mTessellationMultiplier);
+    mShaderManager->SetUniformValue(mPowerUniform, mPower);
+    mShaderManager->SetUniformValue(mGrassCoverageUniform, mGrassCoverage);
+    mShaderManager->SetUniformValue(mAmbientUniform, mAmbient);
+    mShaderManager->SetUniformValue(mDiffuseUniform, mDiffuse);
+    mShaderManager->SetUniformValue(mShininessUniform, mShininess);
+    mShaderManager->SetUniformValue(mSpecularUniform, mSpecular);
+    mShaderManager->SetUniformValue(mWaterHeightUniform, -1000.0f);
+    mShaderManager->SetSampler(mSandUniform, 1, mTextures[Sand]->textureId());
+    mShaderManager->SetSampler(mGrassUniform, 2, mTextures[Grass]->textureId());
+    mShaderManager->SetSampler(mTerrainTextureUniform, 3, mTextures[TerrainTexture]->textureId());
+    mShaderManager->SetSampler(mSnowUniform, 4, mTextures[Snow]->textureId());
+    mShaderManager->SetSampler(mRockUniform, 5, mTextures[RockDiffuse]->textureId());
+    mShaderManager->SetSampler(mRockNormalUniform, 6, mTextures[RockNormal]->textureId());
 
     mTileGenerator->Render(GL_PATCHES);
     mShaderManager->Release();
@@ -1,4 +1,5 @@
 #include "TileGenerator.h"
+#include "GPUMemoryTracker.h"
 
 Canavar::Engine::TileGenerator::TileGenerator(int resolution, int tiles, float width)
     : QObject()
@@ -61,6 +62,7 @@ Canavar::Engine::TileGenerator::TileGenerator(int resolution, int tiles, float w
     glGenBuffers(1, &mPBO);
     glBindBuffer(GL_ARRAY_BUFFER, mPBO);
     glBufferData(GL_ARRAY_BUFFER, mTilePositions.size() * sizeof(QVector2D), mTilePositions.constData(), GL_DYNAMIC_DRAW);
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Buffer, mPBO, GPUMemoryTracker::Category::VertexBuffer, "Terrain", mTilePositions.size() * sizeof(QVector2D));
 
     glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(QVector2D), (void*)0);
     glEnableVertexAttribArray(3);
@@ -69,6 +71,7 @@ Canavar::Engine::TileGenerator::TileGenerator(int resolution, int tiles, float w
     glGenBuffers(1, &mVBO);
     glBindBuffer(GL_ARRAY_BUFFER, mVBO);
     glBufferData(GL_ARRAY_BUFFER, mVertices.size() * sizeof(Vertex), mVertices.constData(), GL_STATIC_DRAW);
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Buffer, mVBO, GPUMemoryTracker::Category::VertexBuffer, "Terrain", mVertices.size() * sizeof(Vertex));
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
     glEnableVertexAttribArray(0);
@@ -82,6 +85,7 @@ Canavar::Engine::TileGenerator::TileGenerator(int resolution, int tiles, float w
     glGenBuffers(1, &mEBO);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, mIndices.size() * sizeof(unsigned int), mIndices.constData(), GL_STATIC_DRAW);
+    GPUMemoryTracker::Instance()->Allocate(GPUMemoryTracker::Resource::Buffer, mEBO, GPUMemoryTracker::Category::IndexBuffer, "Terrain", mIndices.size() * sizeof(unsigned int));
 
     glBindVertexArray(0);
 }
@@ -56,5 +56,12 @@ private:
 
     bool mAutoPilotEnabled;
 
+    // Interned names of the control surface meshes of the jet
+    int mRudderMeshID;
+    int mLeftElevatorMeshID;
+    int mRightElevatorMeshID;
+    int mLeftAileronMeshID;
+    int mRightAileronMeshID;
+
     float mTimeElapsed;
 };
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "AircraftController.h"
 
+#include <NameRegistry.h>
+
 AircraftController::AircraftController(Aircraft* aircraft, QObject* parent)
     : QObject(parent)
     , mAircraft(aircraft)
@@ -12,6 +14,13 @@ AircraftController::AircraftController(Aircraft* aircraft, QObject* parent)
     , mAutoPilotEnabled(false)
     , mTimeElapsed(0.0f)
 {
+    auto registry = Canavar::Engine::NameRegistry::Instance();
+    mRudderMeshID = registry->Intern("Object_40");
+    mLeftElevatorMeshID = registry->Intern("Object_36");
+    mRightElevatorMeshID = registry->Intern("Object_18");
+    mLeftAileronMeshID = registry->Intern("Object_22");
+    mRightAileronMeshID = registry->Intern("Object_20");
+
     connect(this, &AircraftController::Command, mAircraft, &Aircraft::OnCommand, Qt::QueuedConnection);
     connect(&mTimer, &QTimer::timeout, this, &AircraftController::Tick);
     connect(mAircraft, &Aircraft::PfdChanged, this, [=](Aircraft::PrimaryFlightData pfd) { mPfd = pfd; }, Qt::QueuedConnection);
@@ -133,7 +142,7 @@ void AircraftController::Update(float ifps)
         t0.translate(-p0);
         t1.rotate(QQuaternion::fromAxisAndAngle(axis, mPfd.rudderPos));
         t2.translate(p0);
-        mJet->SetMeshTransformation("Object_40", t2 * t1 * t0);
+        mJet->SetMeshTransformation(mRudderMeshID, t2 * t1 * t0);
     }
 
     // Left elevator
@@ -146,7 +155,7 @@ void AircraftController::Update(float ifps)
         t0.translate(-p0);
         t1.rotate(QQuaternion::fromAxisAndAngle(axis, -mPfd.elevatorPos));
         t2.translate(p0);
-        mJet->SetMeshTransformation("Object_36", t2 * t1 * t0);
+        mJet->SetMeshTransformation(mLeftElevatorMeshID, t2 * t1 * t0);
     }
 
     // Right elevator
@@ -159,7 +168,7 @@ void AircraftController::Update(float ifps)
         t0.translate(-p0);
         t1.rotate(QQuaternion::fromAxisAndAngle(axis, mPfd.elevatorPos));
         t2.translate(p0);
-        mJet->SetMeshTransformation("Object_18", t2 * t1 * t0);
+        mJet->SetMeshTransformation(mRightElevatorMeshID, t2 * t1 * t0);
     }
 
     // Left aileron
@@ -172,7 +181,7 @@ void AircraftController::Update(float ifps)
         t0.translate(-p0);
         t1.rotate(QQuaternion::fromAxisAndAngle(axis, -mPfd.leftAileronPos));
         t2.translate(p0);
-        mJet->SetMeshTransformation("Object_22", t2 * t1 * t0);
+        mJet->SetMeshTransformation(mLeftAileronMeshID, t2 * t1 * t0);
     }
 
     // Right aileron
@@ -185,7 +194,7 @@ void AircraftController::Update(float ifps)
         t0.translate(-p0);
         t1.rotate(QQuaternion::fromAxisAndAngle(axis, mPfd.rightAileronPos));
         t2.translate(p0);
-        mJet->SetMeshTransformation("Object_20", t2 * t1 * t0);
+        mJet->SetMeshTransformation(mRightAileronMeshID, t2 * t1 * t0);
     }
 }
 